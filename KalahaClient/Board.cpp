@@ -2,8 +2,9 @@
 
 #include <sstream>
 #include <algorithm>
+#include <string.h>
 
-void Board::SetNrOfSeeds(unsigned char amboIndex, unsigned char playerIndex, unsigned char nrOfSeeds) throw(...)
+template<class Rules> void BasicBoard<Rules>::SetNrOfSeeds(unsigned char amboIndex, unsigned char playerIndex, unsigned char nrOfSeeds) throw(...)
 {
 	if(amboIndex > AMBO_PLAYER_COUNT)
 	{
@@ -15,10 +16,112 @@ void Board::SetNrOfSeeds(unsigned char amboIndex, unsigned char playerIndex, uns
 	}
 	// amboIndex = where to start.
 	// player index * the number of ambos (per player) + the number of kalah (1) = player offset.
-	this->ambos[playerIndex * AMBO_PLAYER_COUNT + playerIndex + amboIndex] = nrOfSeeds;
+	unsigned char index = playerIndex * AMBO_PLAYER_COUNT + playerIndex + amboIndex;
+	if(amboIndex < AMBO_PLAYER_COUNT)
+	{
+		this->state.nrOfSeedsInAmbos[playerIndex] += nrOfSeeds - this->ambos[index];
+		this->ambos[index] = nrOfSeeds;
+		this->UpdateAmbo(index);
+		this->UpdateStealableSeeds();
+	}
+	else
+	{
+		this->ambos[index] = nrOfSeeds;
+	}
+}
+
+template<class Rules> void BasicBoard<Rules>::UpdateAmbo(unsigned char index)
+{
+	// Range [0, AMBO_PLAYER_COUNT - 1] of index				= max (Max, 0).
+	// Range [AMBO_PLAYER_COUNT + 1, AMBO_COUNT - 1] of index	= min (Min, 1).
+	unsigned char playerIndex = index > AMBO_PLAYER_COUNT;
+	unsigned char amboIndex = index - playerIndex * (AMBO_PLAYER_COUNT + 1);
+	unsigned char bit = 1 << amboIndex;
+	unsigned char nrOfSeeds = this->ambos[index];
+
+	if(nrOfSeeds == 0)
+	{
+		this->state.emptyAmbos[playerIndex] |= bit;
+		this->state.extraTurnAmbos[playerIndex] &= ~bit;
+	}
+	else
+	{
+		this->state.emptyAmbos[playerIndex] &= ~bit;
+		// The opponent's kalah is skipped, so a full lap is AMBO_COUNT - 1 steps.
+		// AMBO_PLAYER_COUNT - amboIndex = the number of steps from the ambo to the player's kalah.
+		if(nrOfSeeds % (AMBO_COUNT - 1) == AMBO_PLAYER_COUNT - amboIndex)
+		{
+			this->state.extraTurnAmbos[playerIndex] |= bit;
+		}
+		else
+		{
+			this->state.extraTurnAmbos[playerIndex] &= ~bit;
+		}
+	}
+}
+
+template<class Rules> void BasicBoard<Rules>::UpdateStealableSeeds()
+{
+	for(unsigned char playerIndex = 0; playerIndex < 2; playerIndex++)
+	{
+		unsigned char playerOffset = playerIndex * AMBO_PLAYER_COUNT + playerIndex;
+		unsigned char opponentOffset = !playerIndex * AMBO_PLAYER_COUNT + !playerIndex;
+		unsigned char maxNrOfSeeds = 0;
+		unsigned char nonEmptyAmbos = ~this->state.emptyAmbos[playerIndex];
+		for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+		{
+			if(!(nonEmptyAmbos & (1 << i)))
+			{
+				continue;
+			}
+			unsigned char nrOfSeeds = this->ambos[playerOffset + i];
+			if(nrOfSeeds > AMBO_COUNT - 1)
+			{
+				continue; // The last seed lands in an ambo which got a seed during the first lap.
+			}
+			// Position relative to the player: [0, AMBO_PLAYER_COUNT - 1] = own ambos, AMBO_PLAYER_COUNT = own kalah, 
+			// the rest are the opponent's ambos (the opponent's kalah is skipped).
+			unsigned char lastSeedIndex = i + nrOfSeeds;
+			bool passedOpponentSide = lastSeedIndex >= AMBO_COUNT - 1;
+			if(passedOpponentSide)
+			{
+				lastSeedIndex -= AMBO_COUNT - 1;
+			}
+			// The last seed has to land in an own ambo which is empty. An ambo emptied by the move itself counts as empty.
+			if(lastSeedIndex >= AMBO_PLAYER_COUNT || (!(this->state.emptyAmbos[playerIndex] & (1 << lastSeedIndex)) && lastSeedIndex != i))
+			{
+				continue;
+			}
+			// The mirror ambo gets a seed too if the move passed the opponent's side.
+			unsigned char mirrorSeeds = this->ambos[opponentOffset + AMBO_PLAYER_COUNT - 1 - lastSeedIndex] + passedOpponentSide;
+			if(Rules::Capture::Captures(mirrorSeeds))
+			{
+				// Don't forget to add the seed that made the capture possible.
+				maxNrOfSeeds = max(maxNrOfSeeds, (unsigned char)(mirrorSeeds + 1));
+			}
+		}
+		this->state.stealableSeeds[playerIndex] = maxNrOfSeeds;
+	}
+}
+
+template<class Rules> void BasicBoard<Rules>::UpdateState()
+{
+	for(unsigned char playerIndex = 0; playerIndex < 2; playerIndex++)
+	{
+		unsigned char playerOffset = playerIndex * AMBO_PLAYER_COUNT + playerIndex;
+		this->state.nrOfSeedsInAmbos[playerIndex] = 0;
+		this->state.emptyAmbos[playerIndex] = 0;
+		this->state.extraTurnAmbos[playerIndex] = 0;
+		for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+		{
+			this->state.nrOfSeedsInAmbos[playerIndex] += this->ambos[playerOffset + i];
+			this->UpdateAmbo(playerOffset + i);
+		}
+	}
+	this->UpdateStealableSeeds();
 }
 
-Board::Board()
+template<class Rules> BasicBoard<Rules>::BasicBoard()
 {
 	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
 	{
@@ -30,26 +133,21 @@ Board::Board()
 		this->ambos[i] = AMBO_SEED_COUNT;
 	}
 	this->ambos[AMBO_COUNT - 1] = 0;
+	this->UpdateState();
 }
-Board::Board(const Board& copy)
-{
-	for(unsigned char i = 0; i < AMBO_COUNT; i++)
-	{
-		this->ambos[i] = copy.ambos[i];
-	}
-}
-Board::Board(unsigned char ambos[AMBO_COUNT])
+template<class Rules> BasicBoard<Rules>::BasicBoard(unsigned char ambos[AMBO_COUNT])
 {
 	for(unsigned char i = 0; i < AMBO_COUNT; i++)
 	{
 		this->ambos[i] = ambos[i];
 	}
+	this->UpdateState();
 }
-Board::~Board()
+template<class Rules> bool BasicBoard<Rules>::operator==(const BasicBoard& other) const
 {
-
+	return memcmp(this->ambos, other.ambos, AMBO_COUNT) == 0;
 }
-void Board::Swap()
+template<class Rules> void BasicBoard<Rules>::Swap()
 {
 	for(unsigned char i = 0; i < AMBO_COUNT / 2; i++)
 	{
@@ -58,8 +156,12 @@ void Board::Swap()
 		this->ambos[i] = this->ambos[index];
 		this->ambos[index] = tmpChar;
 	}
+	swap(this->state.nrOfSeedsInAmbos[0], this->state.nrOfSeedsInAmbos[1]);
+	swap(this->state.emptyAmbos[0], this->state.emptyAmbos[1]);
+	swap(this->state.extraTurnAmbos[0], this->state.extraTurnAmbos[1]);
+	swap(this->state.stealableSeeds[0], this->state.stealableSeeds[1]);
 }
-unsigned char Board::GetNrOfSeeds(unsigned char amboIndex, unsigned char playerIndex) const throw(...)
+template<class Rules> unsigned char BasicBoard<Rules>::GetNrOfSeeds(unsigned char amboIndex, unsigned char playerIndex) const throw(...)
 {
 	if(amboIndex > AMBO_PLAYER_COUNT)
 	{
@@ -74,217 +176,158 @@ unsigned char Board::GetNrOfSeeds(unsigned char amboIndex, unsigned char playerI
 	return this->ambos[amboIndex + playerIndex * AMBO_PLAYER_COUNT + playerIndex];
 }
 
-unsigned char Board::GetNrOfSeedsInKalah(unsigned char playerIndex) const
+template<class Rules> unsigned char BasicBoard<Rules>::GetNrOfSeedsInKalah(unsigned char playerIndex) const
 {
 	return this->GetNrOfSeeds(AMBO_PLAYER_COUNT, playerIndex);
 }
 
-char Board::IsTerminalState() const
+template<class Rules> MoveOutcome BasicBoard<Rules>::MoveSeeds(unsigned char amboIndex, unsigned char playerIndex)
 {
-	// First check if Max has any seeds left.
-	bool maxHasNoSeeds = true;
-	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
-	{
-		if(this->GetNrOfSeeds(i, 0) > 0)
-		{
-			maxHasNoSeeds = false;
-			break;
-		}
-	}
-	if(maxHasNoSeeds) // If Max has no seeds...
-	{
-		return 1; // ...return 1.
-	}
-	else // Else check if Min has any seeds left and...
-	{
-		for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
-		{
-			if(this->GetNrOfSeeds(i, 1) > 0)
-			{
-				return -1; // ...return -1 if Min (both!) has seeds.
-			}
-		}
-	}
-
-	return 0; // Else return 0 (only Max has seeds left).
+	MoveUndo undo;
+	return this->MoveSeeds(amboIndex, playerIndex, undo);
 }
-bool Board::MoveSeeds(unsigned char amboIndex, unsigned char playerIndex)
+
+template<class Rules> MoveOutcome BasicBoard<Rules>::MoveSeeds(unsigned char amboIndex, unsigned char playerIndex, MoveUndo& undo)
 {
+	MoveOutcome outcome = { -1, false, 0, false };
 	// Save the number of seeds in the selected ambo.
 	unsigned char nrOfSeeds = GetNrOfSeeds(amboIndex, playerIndex);
 	if(nrOfSeeds > 0)
 	{
 		// Empty the selected ambo
-		this->SetNrOfSeeds(amboIndex, playerIndex, 0); 
-		unsigned char index = 0;
+		unsigned char index = playerIndex * AMBO_PLAYER_COUNT + playerIndex + amboIndex;
+		undo.state = this->state;
+		undo.index = index;
+		undo.nrOfSeeds = nrOfSeeds;
+		undo.captured = false;
+		undo.nrOfMirrorSeeds = 0;
+		undo.sweptPlayerIndex = -1;
+		this->ambos[index] = 0;
+		this->state.nrOfSeedsInAmbos[playerIndex] -= nrOfSeeds;
+		this->UpdateAmbo(index);
 		unsigned char indexOfOpponentAmbo = AMBO_PLAYER_COUNT + !playerIndex * AMBO_PLAYER_COUNT + !playerIndex;
+		unsigned char kalahIndex = AMBO_PLAYER_COUNT + playerIndex * AMBO_PLAYER_COUNT + playerIndex;
 
 		// Increment the seed count in the following ambos.
-		for(unsigned char i = 1; i <= nrOfSeeds; i++)
+		while(nrOfSeeds > 0)
 		{
-			index = (playerIndex * AMBO_PLAYER_COUNT + playerIndex + amboIndex + i) % AMBO_COUNT;
+			index++;
+			if(index == AMBO_COUNT)
+			{
+				index = 0;
+			}
 			// Special case: Skip opponents Kalah.
-			if(index != indexOfOpponentAmbo)
+			if(index == indexOfOpponentAmbo)
 			{
-				this->ambos[index]++;
+				continue;
 			}
-			else // Since we skipped the opponents kalah, we need to take one extra step.
+			this->ambos[index]++;
+			if(index != kalahIndex)
 			{
-				nrOfSeeds++; 
+				this->state.nrOfSeedsInAmbos[index > AMBO_PLAYER_COUNT]++;
+				this->UpdateAmbo(index);
 			}
+			nrOfSeeds--;
 		}
 
+		outcome.lastAmboIndex = index;
+		undo.lastIndex = index;
+		outcome.extraTurn = index == kalahIndex;
+
 		// Check if the last seed lands in an empty, owned ambo.
-		unsigned char mirrorIndex = 0;
 		// 'index' is now the index of the ambo where the last seed landed.
 		// Range [0, AMBO_PLAYER_COUNT - 1] of index				= max (Max, 0).
 		// Range [AMBO_PLAYER_COUNT + 1, AMBO_COUNT - 1] of index	= min (Min, 1).
-		nrOfSeeds = this->ambos[index];
-		if(nrOfSeeds == 1) // If only the last seed is in the ambo...
+		bool ownAmbo = index != kalahIndex && (index > AMBO_PLAYER_COUNT) == (playerIndex == 1);
+		if(ownAmbo && this->ambos[index] == 1) // If only the last seed is in the ambo...
 		{
 			// ... check mirror (opponent) ambo.
-			nrOfSeeds = 0; // Reset nrOfSeeds.
-			if(index > AMBO_PLAYER_COUNT && index < AMBO_COUNT - 1 && playerIndex == 1) 
-			{
-				// AMBO_COUNT - 1 = index-end of min's (opponent) row of ambos.
-				// -index = the number of steps to make.
-				// Note that the last '-1' is the kalah.
-				mirrorIndex = AMBO_COUNT - 1 - index - 1; // Range [AMBO_PLAYER_COUNT + 1, AMBO_COUNT - 1].
-				nrOfSeeds = this->ambos[mirrorIndex];
-			}
-			else if(index < AMBO_PLAYER_COUNT && playerIndex == 0)
-			{
-				// AMBO_PLAYER_COUNT = max's (us) kalah.
-				// AMBO_PLAYER_COUNT - index = the number of steps to go from the kalah.
-				mirrorIndex = AMBO_PLAYER_COUNT + (AMBO_PLAYER_COUNT - index); // Range [0, AMBO_PLAYER_COUNT - 1].
-				nrOfSeeds = this->ambos[mirrorIndex];
-			}
-			// If mirror ambo is not empty...
-			if(nrOfSeeds > 0) 
+			// AMBO_COUNT - 2 - index maps an ambo to the ambo on the opposite side for both players.
+			unsigned char mirrorIndex = AMBO_COUNT - 2 - index;
+			nrOfSeeds = this->ambos[mirrorIndex];
+			// If the rules allow it (by default if the mirror ambo is not empty)...
+			if(Rules::Capture::Captures(nrOfSeeds)) 
 			{
 				// ... then steal the seeds and put them and the last seed in the player's kalah.
-				unsigned char kalahIndex = AMBO_PLAYER_COUNT + playerIndex * AMBO_PLAYER_COUNT + playerIndex;
 				this->ambos[mirrorIndex] = 0;
 				this->ambos[index] = 0;
 				this->ambos[kalahIndex] += nrOfSeeds + 1; 
+				outcome.nrOfCapturedSeeds = nrOfSeeds + 1;
+				undo.captured = true;
+				undo.nrOfMirrorSeeds = nrOfSeeds;
+				this->state.nrOfSeedsInAmbos[playerIndex]--;
+				this->state.nrOfSeedsInAmbos[!playerIndex] -= nrOfSeeds;
+				this->UpdateAmbo(mirrorIndex);
+				this->UpdateAmbo(index);
 			}
 		}
 
 		// Check if board state has become a terminal state.
 		char isTerminalState = this->IsTerminalState();
-		if(isTerminalState != -1) // If one side is empty...
+		if(isTerminalState != -1 && Rules::Sweep::SWEEP) // If one side is empty...
 		{
 			// ... move the other side's seeds into the kalah.
-			for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
-			{
-				// Kalaha += seeds in ambo.
-				this->ambos[AMBO_PLAYER_COUNT + isTerminalState * AMBO_PLAYER_COUNT + isTerminalState] += this->ambos[i + isTerminalState * AMBO_PLAYER_COUNT + isTerminalState];
-				// Ambo = 0.
-				this->ambos[i + isTerminalState * AMBO_PLAYER_COUNT + isTerminalState] = 0;
-			}
+			unsigned char playerOffset = isTerminalState * AMBO_PLAYER_COUNT + isTerminalState;
+			this->ambos[AMBO_PLAYER_COUNT + playerOffset] += this->state.nrOfSeedsInAmbos[isTerminalState];
+			undo.sweptPlayerIndex = isTerminalState;
+			memcpy(undo.sweptAmbos, this->ambos + playerOffset, AMBO_PLAYER_COUNT);
+			memset(this->ambos + playerOffset, 0, AMBO_PLAYER_COUNT);
+			this->state.nrOfSeedsInAmbos[isTerminalState] = 0;
+			this->state.emptyAmbos[isTerminalState] = (1 << AMBO_PLAYER_COUNT) - 1;
+			this->state.extraTurnAmbos[isTerminalState] = 0;
 		}
-		return true;
+		outcome.terminal = isTerminalState != -1;
+		this->UpdateStealableSeeds();
 	}
 
-	return false;
+	return outcome;
 }
 
-
-char Board::CanGetExtraTurn(unsigned char playerIndex) const 
+template<class Rules> void BasicBoard<Rules>::UndoMove(const MoveUndo& undo)
 {
-	unsigned char nrOfSeeds = 0;
-	unsigned char lastSeedIndex = 0;
-	unsigned char kalahIndex = 0;
-
-	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+	// Take the steps of MoveSeeds(...) back in reverse order.
+	unsigned char playerIndex = undo.index > AMBO_PLAYER_COUNT;
+	unsigned char indexOfOpponentAmbo = AMBO_PLAYER_COUNT + !playerIndex * AMBO_PLAYER_COUNT + !playerIndex;
+	unsigned char kalahIndex = AMBO_PLAYER_COUNT + playerIndex * AMBO_PLAYER_COUNT + playerIndex;
+	if(undo.sweptPlayerIndex != -1)
 	{
-		nrOfSeeds = this->GetNrOfSeeds(i, playerIndex);
-		// i = start.
-		// nrOfSeeds = steps to increment (end).
-		// playerIndex * AMBO_PLAYER_COUNT + playerIndex = player-offset.
-		lastSeedIndex = (i + nrOfSeeds + playerIndex * AMBO_PLAYER_COUNT + playerIndex) % AMBO_COUNT;
-		kalahIndex = AMBO_PLAYER_COUNT + playerIndex * AMBO_PLAYER_COUNT + playerIndex;
-
-		// The opponents kalah shall be stepped over, so check how many times we iterate over it.
-		
-		// i = start index.
-		// i + nrOfSeeds = end index.
-		// Range [0, AMBO_COUNT-1] of (i + nrOfSeeds), therefore to get correct number of iterations,
-		// subtract 1 from AMBO_COUNT and do integer division.
-		lastSeedIndex += (i + nrOfSeeds) / (AMBO_COUNT - 1);
-		
-
-
-		// lastSeedIndex now has the correct index of the ambo the last seed is put in.
-		if(lastSeedIndex == kalahIndex) // If last seed can be put in own kalah...
+		unsigned char playerOffset = undo.sweptPlayerIndex * AMBO_PLAYER_COUNT + undo.sweptPlayerIndex;
+		for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
 		{
-			return 1 + (playerIndex * -2); // ...return 1 for Max and -1 for Min.
+			this->ambos[i + playerOffset] = undo.sweptAmbos[i];
+			this->ambos[AMBO_PLAYER_COUNT + playerOffset] -= undo.sweptAmbos[i];
 		}
 	}
+	if(undo.captured)
+	{
+		// The last seed and the mirror ambo's seeds were put in the kalah.
+		this->ambos[undo.lastIndex] = 1;
+		this->ambos[AMBO_COUNT - 2 - undo.lastIndex] = undo.nrOfMirrorSeeds;
+		this->ambos[kalahIndex] -= undo.nrOfMirrorSeeds + 1;
+	}
 
-	return 0;
-}
-
-
-char Board::CanGetOpponentSeeds(unsigned char playerIndex) const
-{
-	unsigned char nrOfSeeds = 0;
-	unsigned char lastSeedIndex = 0;
-	unsigned char mirrorIndex = 0;
-	unsigned char maxNrOfSeeds = 0;
-	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+	// Take a seed back from each sown ambo.
+	unsigned char index = undo.index;
+	unsigned char nrOfSeeds = undo.nrOfSeeds;
+	while(nrOfSeeds > 0)
 	{
-		nrOfSeeds = this->GetNrOfSeeds(i, playerIndex);
-		if(nrOfSeeds > 0)
+		index++;
+		if(index == AMBO_COUNT)
 		{
-			// playerIndex * AMBO_PLAYER_COUNT + playerIndex = where to start, depending on the player.
-			// i = where to start (ambo Index).
-			// nrOfSeeds = how many steps to increment.
-			lastSeedIndex = (playerIndex * AMBO_PLAYER_COUNT + playerIndex + i + nrOfSeeds) % AMBO_COUNT; // Range [0, AMBO_COUNT-1].
-			// First check if last seed lands in an owned, empty ambo.
-			nrOfSeeds = this->ambos[lastSeedIndex];
-			if(nrOfSeeds == 0) 
-			{
-				// Range [0, AMBO_PLAYER_COUNT - 1] of lastSeedIndex = max (us, 0).
-				// Range [AMBO_PLAYER_COUNT + 1, AMBO_COUNT - 1] of lastSeedIndex = min (opponent, 1).
-				if(lastSeedIndex > AMBO_PLAYER_COUNT && lastSeedIndex < AMBO_COUNT - 1 && playerIndex == 1) 
-				{
-					// ... check mirror (opponent) ambo.
-					// AMBO_COUNT - 1 = index-end of min's (opponent) row of ambos.
-					// Note that the last "-1" is the kalah.
-					mirrorIndex = AMBO_COUNT - 1 - lastSeedIndex - 1; // Range [AMBO_PLAYER_COUNT + 1, AMBO_COUNT - 1].
-					nrOfSeeds = this->ambos[mirrorIndex];
-				}
-				else if(lastSeedIndex < AMBO_PLAYER_COUNT && playerIndex == 0)
-				{
-					// ... check mirror (opponent) ambo.
-					// AMBO_PLAYER_COUNT = max's (us) kalah.
-					// AMBO_PLAYER_COUNT - lastSeedIndex = the number of steps to go from the kalah.
-					mirrorIndex = AMBO_PLAYER_COUNT + (AMBO_PLAYER_COUNT - lastSeedIndex); // Range [0, AMBO_PLAYER_COUNT - 1].
-					nrOfSeeds = this->ambos[mirrorIndex];
-				}
-				// If not empty...
-				if(nrOfSeeds > 0)
-				{
-					// ... then save the number of seeds in that ambo.
-					// Do this for all to determine the maximum amount of seeds that can be stolen.
-					maxNrOfSeeds = max(maxNrOfSeeds, nrOfSeeds); 
-				}
-			}
+			index = 0;
 		}
+		if(index == indexOfOpponentAmbo)
+		{
+			continue;
+		}
+		this->ambos[index]--;
+		nrOfSeeds--;
 	}
-	// The maximum amount of seeds that can be stolen is now determined.
-	// Don't forget to add the seed that made the capture possible.
-	if(maxNrOfSeeds > 0)
-	{
-		maxNrOfSeeds++;
-	}
-
-	// Return the amount of seeds that can be stolen. Negative if Min is the one who can steal seeds.
-	return maxNrOfSeeds + (playerIndex * maxNrOfSeeds * -2);
+	this->ambos[undo.index] = undo.nrOfSeeds;
+	this->state = undo.state;
 }
 
-string Board::ToString() const
+template<class Rules> string BasicBoard<Rules>::ToString() const
 {
 	stringstream ss;
 	ss << "  ";
@@ -303,4 +346,10 @@ string Board::ToString() const
 	ss << endl;
 
 	return ss.str();
-}
\ No newline at end of file
+}
+
+// The rule variants the board is compiled for.
+template class BasicBoard<StandardRules>;
+template class BasicBoard<EmptyCaptureRules>;
+template class BasicBoard<NoSweepRules>;
+template class BasicBoard<EmptyCaptureNoSweepRules>;
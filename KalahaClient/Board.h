@@ -1,6 +1,8 @@
 #pragma once
 
+#include "Rules.h"
 #include <string> 
+#include <type_traits>
 using namespace std; 
 
 
@@ -8,20 +10,81 @@ static const char AMBO_SEED_COUNT = 6; // The number of (start-)seeds in an ambo
 static const char AMBO_PLAYER_COUNT = 6; // The number of ambos per player, excluding the kalah.
 static const char AMBO_COUNT = (AMBO_PLAYER_COUNT + 1) * 2; // The total number of ambos, including the kalahs.
 
-class Board
+/*
+	The outcome of a move, computed once while sowing.
+*/
+struct MoveOutcome
+{
+	char			lastAmboIndex;		// Index in the ambos array of the ambo where the last seed landed. -1 if the move was not possible.
+	bool			extraTurn;			// True if the last seed landed in the player's kalah, i.e. the player moves again.
+	unsigned char	nrOfCapturedSeeds;	// The number of seeds put in the kalah by a capture, including the last seed. 0 if nothing was captured.
+	bool			terminal;			// True if the move ended the game.
+
+	bool IsValid() const { return this->lastAmboIndex != -1; }
+};
+
+/*
+	The state of a board that is kept up to date by MoveSeeds(...), so that the evaluation never has to rescan the ambos.
+*/
+struct BoardState
+{
+	unsigned char nrOfSeedsInAmbos[2];	// The number of seeds on each side, excluding the kalahs.
+	unsigned char emptyAmbos[2];		// Bit i is set if ambo i of the player is empty.
+	unsigned char extraTurnAmbos[2];	// Bit i is set if moving ambo i of the player puts the last seed in the player's kalah.
+	unsigned char stealableSeeds[2];	// The largest number of seeds (+ the last seed placed) the player can steal with one move.
+};
+
+/*
+	What MoveSeeds(...) changed, so that UndoMove(...) can take the move back. 
+	The sown ambos are restored by taking the seeds back, only the captured and swept ambos are saved.
+*/
+struct MoveUndo
+{
+	BoardState		state;
+	unsigned char	index;						// Index in the ambos array of the moved ambo.
+	unsigned char	nrOfSeeds;					// The number of seeds sown.
+	unsigned char	lastIndex;					// Index in the ambos array of the ambo where the last seed landed.
+	bool			captured;					// True if the last seed (and the mirror ambo's seeds) were put in the kalah.
+	unsigned char	nrOfMirrorSeeds;			// The number of seeds captured from the mirror ambo.
+	char			sweptPlayerIndex;			// The player whose seeds were put in the kalah when the game ended, -1 if it didn't.
+	unsigned char	sweptAmbos[AMBO_PLAYER_COUNT];	// The ambos of the swept player before the sweep.
+};
+
+/*
+	A value type: trivially copyable (no virtual functions, no owned memory), so copying a board is a plain memory copy.
+	Rules = The KalahRules the moves are made by (see Rules.h), the client uses Board (KALAHA_RULES).
+*/
+template<class Rules>
+class alignas(16) BasicBoard
 {
 	private:
 		unsigned char ambos[AMBO_COUNT]; // Contains the number of seeds in each ambo/house/store/Kalah. Range[0,AMBO_PLAYER_COUNT] = player 1. Range[AMBO_PLAYER_COUNT + 1,AMBO_COUNT-1] = player 2.
+		BoardState state;
 
 	private:
 		void SetNrOfSeeds(unsigned char amboIndex, unsigned char playerIndex, unsigned char nrOfSeeds) throw(...);
+		/*
+			Updates the empty- and extra-turn bits of the ambo at the given index of the ambos array.
+			The index must not be a kalah.
+		*/
+		void UpdateAmbo(unsigned char index);
+		/*
+			Updates the number of stealable seeds of both players. Relies on the empty bits being up to date.
+		*/
+		void UpdateStealableSeeds();
+		/*
+			Recalculates all incrementally kept state from the ambos.
+		*/
+		void UpdateState();
 
 	public:
-		Board();
-		Board(const Board& copy);
-		Board(unsigned char ambos[AMBO_COUNT]);
-		virtual~Board();
+		BasicBoard();
+		BasicBoard(unsigned char ambos[AMBO_COUNT]);
 
+		/*
+			Returns true if both boards have the same number of seeds in every ambo.
+		*/
+		bool operator==(const BasicBoard& other) const;
 		/*
 			Swaps the sides of the board with each other.
 		*/
@@ -32,31 +95,57 @@ class Board
 		*/
 		unsigned char GetNrOfSeeds(unsigned char amboIndex, unsigned char playerIndex) const throw(...);
 		unsigned char GetNrOfSeedsInKalah(unsigned char playerIndex) const;
+		/*
+			Returns the ambos array (AMBO_COUNT seed counts, see Board::ambos) without bounds checking.
+		*/
+		const unsigned char* GetAmbos() const { return this->ambos; }
 		/*
 			Checks if current board state is a terminal state.
 			Returns 0 if only max has seeds left.
 			Returns 1 if only min has seeds left.
 			Returns -1 if current board state is NOT a terminal state.
 		*/
-		char IsTerminalState() const;
+		char IsTerminalState() const { return this->state.nrOfSeedsInAmbos[0] == 0 ? 1 : (this->state.nrOfSeedsInAmbos[1] == 0 ? 0 : -1); }
 		/*	
 			Moves seeds from the given ambo and increments the seed count in the following ambos (and player-owned kalah).
-			Returns false if the selected ambo is empty. */
-		bool MoveSeeds(unsigned char amboIndex, unsigned char playerIndex);
+			Returns the outcome of the move. The outcome is not valid if the selected ambo is empty. */
+		MoveOutcome MoveSeeds(unsigned char amboIndex, unsigned char playerIndex);
+		/*
+			Same as above, and fills in undo so that the move can be taken back with UndoMove(...).
+			Lets a search walk one board in place instead of copying it for every move.
+		*/
+		MoveOutcome MoveSeeds(unsigned char amboIndex, unsigned char playerIndex, MoveUndo& undo);
+		/*
+			Takes back the latest (valid) move made with MoveSeeds(..., undo). Moves must be taken back in reverse order.
+		*/
+		void UndoMove(const MoveUndo& undo);
 		/*
 			Check whether or not an extra turn can be gained by moving seeds so that the last seed lands in the player's kalah.
 			Returns 1 if max (us) or -1 if min (opponent) can gain an extra turn.
 			Returns 0 if no extra turn can be gained.
 		*/
-		char CanGetExtraTurn(unsigned char playerIndex) const;
+		char CanGetExtraTurn(unsigned char playerIndex) const { return this->state.extraTurnAmbos[playerIndex] ? 1 + (playerIndex * -2) : 0; }
 		/*
 			Checks whether or not seeds can be stolen.
 			Returns the maximum number of seeds (+ the last seed placed) that can be stolen. 
 			Note that this number is negative if min (the opponent) can steal from max (us).
 		*/
-		char CanGetOpponentSeeds(unsigned char playerIndex) const;
+		char CanGetOpponentSeeds(unsigned char playerIndex) const { return this->state.stealableSeeds[playerIndex] + (playerIndex * this->state.stealableSeeds[playerIndex] * -2); }
+		/*
+			Returns the number of seeds left on the player's side, excluding the kalah.
+		*/
+		unsigned char GetNrOfSeedsInAmbos(unsigned char playerIndex) const { return this->state.nrOfSeedsInAmbos[playerIndex]; }
+		/*
+			Returns the ambos of the player as bits: bit i is set if ambo i is empty / if moving ambo i gives an extra turn.
+		*/
+		unsigned char GetEmptyAmbos(unsigned char playerIndex) const { return this->state.emptyAmbos[playerIndex]; }
+		unsigned char GetExtraTurnAmbos(unsigned char playerIndex) const { return this->state.extraTurnAmbos[playerIndex]; }
 		/*
 			Returns a string representing/visualizing the board. 
 		*/
 		string ToString() const;
 };
+
+typedef BasicBoard<KALAHA_RULES> Board;
+
+static_assert(std::is_trivially_copyable<Board>::value, "Board is copied as plain memory.");
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Evaluation.h"
+#include <string>
+
+using namespace std;
+
+enum ENGINE_TYPE
+{
+	ENGINE_MINIMAX	= 0,
+	ENGINE_MCTS		= 1  // Monte Carlo tree search.
+};
+
+/*
+	Settings of the client, read from Config.cfg.
+*/
+struct Config
+{
+	int port;
+	string address;
+	unsigned char startDepth;
+	unsigned int sleepTime;
+	unsigned short int timeLimit; // In milliseconds.
+	unsigned int gameTime; // Time for all our moves of a game in milliseconds, 0 = timeLimit for every move.
+	unsigned int nrOfGames;
+	bool expandExtraTurns; // Extra-turn chains are searched as one move.
+	unsigned char quiescenceDepth; // Tactical moves searched beyond the depth limit, 0 = disabled.
+	unsigned int transpositionTableSize; // In megabytes, 0 = disabled.
+	bool ponder; // Search on the opponent's time.
+	unsigned int nrOfConnections; // Games played at the same time, each on its own connection.
+	unsigned int nrOfSearchThreads; // Threads searching for the games (or of the Monte Carlo tree search of a single game), 0 = one per core.
+	unsigned char engine; // One of ENGINE_TYPE.
+	unsigned char playoutPolicy; // One of MCTS_PLAYOUT_POLICY.
+	bool recordGames; // Write the games to Games.kgr.
+	unsigned int solverTableSize; // Of the endgame solver in megabytes, 0 = disabled.
+	unsigned char selectiveSearch; // The SELECTIVE_SEARCH techniques of Minimax, or-ed together.
+	string weightsFile; // The evaluation weights, written by the tuner.
+	EvaluationWeights evaluationWeights; // Loaded from weightsFile, the defaults if it doesn't exist.
+	unsigned short metricsPort; // Of the local metrics endpoint, 0 = disabled.
+	bool traceSpans; // Record trace spans of the client, written to Trace.json when it stops.
+	unsigned int memoryBudget; // Of the search trees and tables in megabytes, shared by the engines, 0 = unlimited.
+};
@@ -0,0 +1,346 @@
+#include "DistributedAnalysis.h"
+
+#include <winsock.h>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+AnalysisCoordinator::AnalysisCoordinator(const Config& config) : config(config)
+{
+	this->minimax.SetExpandExtraTurns(config.expandExtraTurns);
+	this->minimax.SetQuiescenceDepth(config.quiescenceDepth);
+	this->minimax.SetEvaluationWeights(config.evaluationWeights);
+	this->nrOfJobs = 0;
+	this->nrOfJobsDone = 0;
+	this->nrOfRetries = 0;
+}
+
+AnalysisCoordinator::~AnalysisCoordinator()
+{
+	for(unsigned int i = 0; i < this->workers.size(); i++)
+	{
+		closesocket(this->workers[i].connection->GetSocket());
+		delete this->workers[i].connection;
+	}
+}
+
+void AnalysisCoordinator::Split(const Board& board, unsigned char depth)
+{
+	this->nodes.clear();
+	this->queue.clear();
+	this->nrOfJobs = 0;
+	this->nrOfJobsDone = 0;
+	this->nrOfRetries = 0;
+
+	AnalysisNode root;
+	memset(&root, 0, sizeof(root));
+	root.board = board;
+	root.depth = depth;
+	this->nodes.push_back(root);
+	std::vector<unsigned char> plies(1, 0); // Moves from the root to each position.
+
+	// Breadth first, so that the children of a position are stored next to each other.
+	for(unsigned int n = 0; n < this->nodes.size(); n++)
+	{
+		AnalysisNode node = this->nodes[n];
+		if(node.depth == 0 || node.board.IsTerminalState() != -1)
+		{
+			this->nodes[n].utility = this->minimax.Analyze(node.board, node.minTurn, 0);
+			continue;
+		}
+		if(plies[n] == ANALYSIS_SPLIT_PLIES)
+		{
+			this->nodes[n].state = ANALYSIS_JOB_QUEUED;
+			this->nrOfJobs++;
+			continue;
+		}
+
+		unsigned int firstChild = (unsigned int)this->nodes.size();
+		for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+		{
+			AnalysisNode child = node;
+			MoveOutcome outcome = child.board.MoveSeeds(i, node.minTurn);
+			if(!outcome.IsValid())
+			{
+				continue;
+			}
+			bool extraTurn = outcome.extraTurn && !outcome.terminal;
+			child.minTurn = extraTurn ? node.minTurn : !node.minTurn;
+			child.depth = this->minimax.ChildDepth(node.depth, extraTurn);
+			child.amboIndex = i;
+			this->nodes.push_back(child);
+			plies.push_back(plies[n] + 1);
+		}
+		this->nodes[n].firstChild = firstChild;
+		this->nodes[n].nrOfChildren = (unsigned char)(this->nodes.size() - firstChild);
+	}
+
+	// The queue is taken from the back, so the jobs are handed out in the order of the tree.
+	for(unsigned int n = (unsigned int)this->nodes.size(); n-- > 0;)
+	{
+		if(this->nodes[n].state == ANALYSIS_JOB_QUEUED)
+		{
+			this->queue.push_back(n);
+		}
+	}
+}
+
+bool AnalysisCoordinator::SendJobs(AnalysisWorker& worker)
+{
+	bool queued = false;
+	while(worker.jobs.size() < ANALYSIS_JOBS_PER_WORKER && !this->queue.empty())
+	{
+		unsigned int id = this->queue.back();
+		AnalysisNode& node = this->nodes[id];
+		const unsigned char* ambos = node.board.GetAmbos();
+		char command[PROTOCOL_BUFFER_SIZE / ANALYSIS_JOBS_PER_WORKER];
+		int length = sprintf(command, "JOB %u %d %d ", id, node.minTurn ? 1 : 0, node.depth);
+		for(unsigned char i = 0; i < AMBO_COUNT; i++)
+		{
+			length += sprintf(command + length, i + 1 < AMBO_COUNT ? "%d," : "%d\n", ambos[i]);
+		}
+		if(!worker.connection->Queue(command))
+		{
+			break;
+		}
+		this->queue.pop_back();
+		node.state = ANALYSIS_JOB_SENT;
+		node.nrOfAttempts++;
+		worker.jobs.push_back(id);
+		queued = true;
+	}
+	return !queued || worker.connection->Flush();
+}
+
+bool AnalysisCoordinator::HandleResult(AnalysisWorker& worker, const char* line)
+{
+	// The results come in the order the jobs were sent.
+	unsigned int id = 0;
+	int utility = 0;
+	unsigned int nrOfNodes = 0;
+	if(sscanf(line, "RESULT %u %d %u", &id, &utility, &nrOfNodes) != 3 || worker.jobs.empty() || worker.jobs.front() != id)
+	{
+		return false;
+	}
+	worker.jobs.erase(worker.jobs.begin());
+	AnalysisNode& node = this->nodes[id];
+	node.utility = (char)utility;
+	node.nrOfNodes = nrOfNodes;
+	node.state = ANALYSIS_JOB_DONE;
+	this->nrOfJobsDone++;
+	worker.nrOfJobsDone++;
+	worker.nrOfNodes += nrOfNodes;
+	return true;
+}
+
+bool AnalysisCoordinator::DropWorker(unsigned int workerIndex)
+{
+	AnalysisWorker& worker = this->workers[workerIndex];
+	closesocket(worker.connection->GetSocket());
+	delete worker.connection;
+	bool retry = true;
+	for(unsigned int i = 0; i < worker.jobs.size(); i++)
+	{
+		AnalysisNode& node = this->nodes[worker.jobs[i]];
+		if(node.nrOfAttempts >= ANALYSIS_MAX_ATTEMPTS)
+		{
+			retry = false;
+		}
+		node.state = ANALYSIS_JOB_QUEUED;
+		this->queue.push_back(worker.jobs[i]);
+		this->nrOfRetries++;
+	}
+	this->workers.erase(this->workers.begin() + workerIndex);
+	return retry;
+}
+
+bool AnalysisCoordinator::Analyze(const Board& board, unsigned char depth, unsigned short port, std::ostream& out)
+{
+	this->Split(board, depth);
+	out << "Split depth " << (int)depth << " into " << this->nrOfJobs << " jobs of depth " << (int)max((int)depth - ANALYSIS_SPLIT_PLIES, 0) << " or more." << endl;
+
+	int listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	int reuseAddress = 1;
+	setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuseAddress, sizeof(reuseAddress));
+	if(bind(listenSocket, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listenSocket, SOMAXCONN) != 0)
+	{
+		out << "Failed to listen on port " << port << "." << endl;
+		closesocket(listenSocket);
+		return false;
+	}
+	out << "Waiting for workers on port " << port << "." << endl;
+
+	// Workers may connect at any time, the jobs are handed out as soon as there is one.
+	DWORD startTime = 0;
+	bool failed = false;
+	while(this->nrOfJobsDone < this->nrOfJobs && !failed)
+	{
+		fd_set readSet;
+		FD_ZERO(&readSet);
+		FD_SET(listenSocket, &readSet);
+		int maxSocket = listenSocket;
+		for(unsigned int i = 0; i < this->workers.size(); i++)
+		{
+			FD_SET(this->workers[i].connection->GetSocket(), &readSet);
+			maxSocket = max(maxSocket, this->workers[i].connection->GetSocket());
+		}
+		if(select(maxSocket + 1, &readSet, nullptr, nullptr, nullptr) <= 0)
+		{
+			break;
+		}
+
+		if(FD_ISSET(listenSocket, &readSet))
+		{
+			int workerSocket = accept(listenSocket, nullptr, nullptr);
+			if(workerSocket >= 0)
+			{
+				if(this->workers.empty() && startTime == 0)
+				{
+					startTime = timeGetTime();
+				}
+				AnalysisWorker worker;
+				worker.connection = new ServerConnection(workerSocket);
+				worker.nrOfJobsDone = 0;
+				worker.nrOfNodes = 0;
+				this->workers.push_back(worker);
+			}
+		}
+
+		for(unsigned int i = 0; i < this->workers.size(); i++)
+		{
+			AnalysisWorker& worker = this->workers[i];
+			if(!FD_ISSET(worker.connection->GetSocket(), &readSet))
+			{
+				continue;
+			}
+			bool connected = worker.connection->ReceiveAvailable();
+			unsigned short length = 0;
+			const char* line = nullptr;
+			while(connected && (line = worker.connection->NextReceived(length)) != nullptr)
+			{
+				connected = this->HandleResult(worker, line);
+			}
+			if(!connected)
+			{
+				out << "Lost a worker, " << worker.jobs.size() << " jobs are sent to another worker." << endl;
+				failed = !this->DropWorker(i--);
+			}
+		}
+
+		// Keep every worker busy, including with the jobs of dropped workers.
+		for(unsigned int i = 0; i < this->workers.size() && !failed; i++)
+		{
+			if(!this->SendJobs(this->workers[i]))
+			{
+				failed = !this->DropWorker(i--);
+			}
+		}
+	}
+	DWORD time = max(timeGetTime() - startTime, (DWORD)1);
+
+	for(unsigned int i = 0; i < this->workers.size(); i++)
+	{
+		this->workers[i].connection->Queue("QUIT\n");
+		this->workers[i].connection->Flush();
+	}
+	closesocket(listenSocket);
+	if(failed || this->nrOfJobsDone < this->nrOfJobs)
+	{
+		out << "The analysis failed, a job failed on " << (int)ANALYSIS_MAX_ATTEMPTS << " workers." << endl;
+		return false;
+	}
+
+	// Minimax of the split tree, the children come after their parents.
+	unsigned long long nrOfNodes = 0;
+	for(unsigned int n = (unsigned int)this->nodes.size(); n-- > 0;)
+	{
+		AnalysisNode& node = this->nodes[n];
+		nrOfNodes += node.nrOfNodes;
+		for(unsigned int i = node.firstChild; i < node.firstChild + node.nrOfChildren; i++)
+		{
+			char utility = this->nodes[i].utility;
+			if(i == node.firstChild || (node.minTurn ? utility < node.utility : utility > node.utility))
+			{
+				node.utility = utility;
+			}
+		}
+	}
+
+	const AnalysisNode& root = this->nodes[0];
+	char bestMove = -1;
+	for(unsigned int i = root.firstChild; i < root.firstChild + root.nrOfChildren; i++)
+	{
+		const AnalysisNode& child = this->nodes[i];
+		out << "Move " << child.amboIndex + 1 << ": " << (int)child.utility << endl;
+		if(bestMove == -1 && child.utility == root.utility)
+		{
+			bestMove = child.amboIndex;
+		}
+	}
+	out << "Best move " << bestMove + 1 << ", score " << (int)root.utility << "." << endl;
+	out << this->nrOfJobs << " jobs (" << this->nrOfRetries << " retried), " << nrOfNodes << " nodes in " << time << " ms, "
+		<< nrOfNodes * 1000 / time << " nodes/s." << endl;
+	for(unsigned int i = 0; i < this->workers.size(); i++)
+	{
+		out << "Worker " << i + 1 << ": " << this->workers[i].nrOfJobsDone << " jobs, " << this->workers[i].nrOfNodes << " nodes." << endl;
+	}
+	return true;
+}
+
+unsigned int RunAnalysisWorker(const Config& config, const char* address, unsigned short port)
+{
+	struct sockaddr_in peer;
+	peer.sin_family = AF_INET;
+	peer.sin_port = htons(port);
+	peer.sin_addr.s_addr = inet_addr(address);
+	int mySocket = socket(AF_INET, SOCK_STREAM, 0);
+	if(connect(mySocket, (struct sockaddr*)&peer, sizeof(peer)) != 0)
+	{
+		cout << "Failed to connect to the coordinator." << endl;
+		closesocket(mySocket);
+		return 0;
+	}
+
+	// The tree and the transposition table are kept between the jobs, neighbouring jobs share many positions.
+	Minimax minimax;
+	ConfigureMinimax(minimax, config);
+	LineReader reader;
+	unsigned int nrOfJobs = 0;
+	while(true)
+	{
+		unsigned short length = 0;
+		const char* line = ReceiveLine(mySocket, reader, length);
+		if(!line || strncmp(line, "JOB ", 4) != 0)
+		{
+			break; // QUIT, or the coordinator is gone.
+		}
+
+		char* next = nullptr;
+		unsigned long id = strtoul(line + 4, &next, 10);
+		bool minTurn = strtol(next, &next, 10) != 0;
+		unsigned char depth = (unsigned char)strtol(next, &next, 10);
+		unsigned char ambos[AMBO_COUNT];
+		for(unsigned char i = 0; i < AMBO_COUNT; i++)
+		{
+			ambos[i] = (unsigned char)strtol(next + (i > 0 ? 1 : 0), &next, 10);
+		}
+
+		minimax.ResetNrOfNodes();
+		char utility = minimax.Analyze(Board(ambos), minTurn, depth);
+		char result[PROTOCOL_BUFFER_SIZE];
+		int resultLength = sprintf(result, "RESULT %lu %d %u\n", id, utility, minimax.GetNrOfNodes());
+		if(send(mySocket, result, resultLength, 0) != resultLength)
+		{
+			break;
+		}
+		nrOfJobs++;
+	}
+	closesocket(mySocket);
+	return nrOfJobs;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Config.h"
+#include "Minimax.h"
+#include "Protocol.h"
+#include <ostream>
+#include <vector>
+
+static const unsigned short ANALYSIS_DEFAULT_PORT = 9200;
+static const unsigned char ANALYSIS_SPLIT_PLIES = 3; // Moves from the root that are played out by the coordinator, the positions after them are the jobs.
+static const unsigned char ANALYSIS_JOBS_PER_WORKER = 2; // Jobs sent ahead to a worker, so that it doesn't wait for the next one.
+static const unsigned char ANALYSIS_MAX_ATTEMPTS = 3; // A job is given up after this many workers have failed on it.
+
+enum ANALYSIS_JOB_STATE
+{
+	ANALYSIS_JOB_NONE		= 0, // Not a job, the position is split further or evaluated by the coordinator.
+	ANALYSIS_JOB_QUEUED		= 1,
+	ANALYSIS_JOB_SENT		= 2,
+	ANALYSIS_JOB_DONE		= 3
+};
+
+/*
+	A position of the split tree. The children of a position are stored next to each other.
+*/
+struct AnalysisNode
+{
+	Board board;
+	bool minTurn;
+	unsigned char depth; // The depth left to search.
+	unsigned char amboIndex; // The move leading to the position.
+	unsigned char nrOfChildren;
+	unsigned int firstChild;
+	char utility;
+	unsigned char state; // One of ANALYSIS_JOB_STATE.
+	unsigned char nrOfAttempts;
+	unsigned int nrOfNodes; // Searched by the worker.
+};
+
+/*
+	A worker process connected to the coordinator.
+*/
+struct AnalysisWorker
+{
+	ServerConnection* connection;
+	std::vector<unsigned int> jobs; // Sent and not yet answered, in the order they were sent.
+	unsigned int nrOfJobsDone;
+	unsigned long long nrOfNodes;
+};
+
+/*
+	Searches one position to a fixed depth with several worker processes, for offline analysis.
+	The coordinator plays out the first moves of the tree itself, hands the positions after them to the workers over TCP
+	and takes the minimax of their results. A worker searches each job with its own Minimax, so the workers scale
+	with the number of processes (on one or several machines), at the cost of the cutoffs between jobs that a single search would get.
+	Jobs of a worker that disconnects are sent to another worker.
+
+	Protocol, one line per message:
+	coordinator: "JOB <id> <minTurn 0/1> <depth> <14 ambos, separated by ','>" and "QUIT" when done.
+	worker: "RESULT <id> <utility> <nodes>".
+*/
+class AnalysisCoordinator
+{
+	private:
+		const Config& config;
+		Minimax minimax; // Evaluates the positions of the split tree that are not searched by a worker.
+		std::vector<AnalysisNode> nodes; // The split tree, the root first. A child comes after its parent.
+		std::vector<unsigned int> queue; // Jobs waiting for a worker.
+		std::vector<AnalysisWorker> workers;
+		unsigned int nrOfJobs;
+		unsigned int nrOfJobsDone;
+		unsigned int nrOfRetries;
+
+		/*
+			Builds the split tree of the board and queues its jobs.
+		*/
+		void Split(const Board& board, unsigned char depth);
+		/*
+			Sends queued jobs to the worker until it has ANALYSIS_JOBS_PER_WORKER. Returns false if the connection failed.
+		*/
+		bool SendJobs(AnalysisWorker& worker);
+		/*
+			Stores the result of a job. Returns false if the line is not a result of a job sent to the worker.
+		*/
+		bool HandleResult(AnalysisWorker& worker, const char* line);
+		/*
+			Closes the connection to the worker and queues its unanswered jobs again.
+			Returns false if a job has failed too many times.
+		*/
+		bool DropWorker(unsigned int workerIndex);
+
+	public:
+		AnalysisCoordinator(const Config& config);
+		virtual ~AnalysisCoordinator();
+
+		/*
+			Searches the board (max to move) to the given depth with the workers connecting to the port
+			and writes the score of every move and the statistics to out. Workers may connect at any time.
+			Returns false if the analysis could not be completed.
+		*/
+		bool Analyze(const Board& board, unsigned char depth, unsigned short port, std::ostream& out);
+};
+
+/*
+	Connects to a coordinator and searches its jobs until it is told to quit or the connection is closed.
+	Returns the number of jobs searched.
+*/
+unsigned int RunAnalysisWorker(const Config& config, const char* address, unsigned short port);
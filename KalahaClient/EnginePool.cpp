@@ -0,0 +1,119 @@
+#include "EnginePool.h"
+#include "SpanTrace.h"
+
+EnginePool::EnginePool(const Config& config)
+{
+	this->stopping = false;
+	this->startDepth = config.startDepth;
+	this->metrics = nullptr;
+	unsigned int nrOfWorkers = config.nrOfSearchThreads;
+	if(nrOfWorkers == 0)
+	{
+		nrOfWorkers = max(std::thread::hardware_concurrency(), 1U);
+	}
+	for(unsigned int i = 0; i < nrOfWorkers; i++)
+	{
+		if(config.engine == ENGINE_MCTS)
+		{
+			Mcts* mcts = new Mcts();
+			mcts->SetNrOfThreads(1);
+			mcts->SetPlayoutPolicy((MCTS_PLAYOUT_POLICY)config.playoutPolicy);
+			this->mctsEngines.push_back(mcts);
+			continue;
+		}
+		Minimax* minimax = new Minimax();
+		minimax->SetTimeLimit(config.timeLimit);
+		minimax->SetSolverTableSize(config.solverTableSize);
+		ConfigureMinimax(*minimax, config, nrOfWorkers);
+		this->engines.push_back(minimax);
+	}
+	for(unsigned int i = 0; i < nrOfWorkers; i++)
+	{
+		this->workers.push_back(std::thread(&EnginePool::Work, this, i));
+	}
+}
+
+EnginePool::~EnginePool()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->jobsMutex);
+		this->stopping = true;
+	}
+	this->jobsCondition.notify_all();
+	for(unsigned int i = 0; i < this->workers.size(); i++)
+	{
+		this->workers[i].join();
+	}
+	for(unsigned int i = 0; i < this->engines.size(); i++)
+	{
+		delete this->engines[i];
+	}
+	for(unsigned int i = 0; i < this->mctsEngines.size(); i++)
+	{
+		delete this->mctsEngines[i];
+	}
+}
+
+void EnginePool::Submit(SearchJob* job)
+{
+	job->done = false;
+	{
+		std::lock_guard<std::mutex> lock(this->jobsMutex);
+		this->jobs.push_back(job);
+	}
+	this->jobsCondition.notify_one();
+}
+
+void EnginePool::Work(unsigned int workerIndex)
+{
+	Minimax* engine = this->engines.empty() ? nullptr : this->engines[workerIndex];
+	Mcts* mcts = this->mctsEngines.empty() ? nullptr : this->mctsEngines[workerIndex];
+	SpanTracer::NameThread(("Engine " + to_string(workerIndex)).c_str());
+	while(true)
+	{
+		SearchJob* job = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(this->jobsMutex);
+			while(this->jobs.empty() && !this->stopping)
+			{
+				this->jobsCondition.wait(lock);
+			}
+			if(this->stopping)
+			{
+				return;
+			}
+			job = this->jobs.front();
+			this->jobs.pop_front();
+		}
+
+		DWORD searchStartTime = timeGetTime();
+		if(mcts)
+		{
+			job->move = job->timeManager ? mcts->Search(job->board, *job->timeManager) : mcts->Search(job->board);
+			job->searchTime = timeGetTime() - searchStartTime;
+			job->depth = mcts->GetTreeDepth();
+			job->nrOfNodes = mcts->GetNrOfPlayouts();
+			if(this->metrics)
+			{
+				const TimeManager& timeManager = job->timeManager ? *job->timeManager : mcts->GetTimeManager();
+				this->metrics->RecordMove(job->searchTime, timeManager.GetHardLimit(), job->nrOfNodes, job->depth);
+				this->metrics->SetEngineMemory(workerIndex, mcts->GetMemoryUsage());
+			}
+			job->done = true;
+			continue;
+		}
+		job->move = job->timeManager ? engine->Search(job->board, this->startDepth, *job->timeManager) : engine->Search(job->board, this->startDepth);
+		job->searchTime = timeGetTime() - searchStartTime;
+		job->depth = engine->GetSearchDepth();
+		job->nrOfNodes = engine->GetNrOfNodes();
+		// Free the rest of the tree. The subtree is reused if the next position of the game is searched by this engine.
+		engine->KeepSubtree(job->move);
+		if(this->metrics)
+		{
+			const TimeManager& timeManager = job->timeManager ? *job->timeManager : engine->GetTimeManager();
+			this->metrics->RecordMove(job->searchTime, timeManager.GetHardLimit(), job->nrOfNodes, job->depth);
+			this->metrics->SetEngineMemory(workerIndex, engine->GetPeakMemoryUsage());
+		}
+		job->done = true;
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Minimax.h"
+#include "Mcts.h"
+#include "Config.h"
+#include "Metrics.h"
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+/*
+	A position to search for, and the result of the search.
+*/
+struct SearchJob
+{
+	Board board; // With the player to move as max (player 1).
+	TimeManager* timeManager; // The time manager of the game.
+	char move; // Index of the best ambo, valid when done is set.
+	unsigned char depth; // Depth of the last completed iteration.
+	unsigned int nrOfNodes;
+	unsigned int searchTime; // In milliseconds.
+	std::atomic<bool> done;
+
+	SearchJob() : timeManager(nullptr), move(-1), depth(0), nrOfNodes(0), searchTime(0), done(false) {}
+};
+
+/*
+	Worker threads, each with its own engine, that search the positions of many games.
+	Jobs are handled in the order they are submitted, so that every game gets the same share of the threads. 
+	The time of each search is decided by the time manager of its game.
+	The engines (and their transposition tables) are shared by all games, instead of one engine per game.
+	With the Monte Carlo tree search, each worker runs a single-threaded search.
+*/
+class EnginePool
+{
+	private:
+		std::vector<Minimax*> engines;
+		std::vector<Mcts*> mctsEngines; // Used instead of engines if the engine type is ENGINE_MCTS.
+		std::vector<std::thread> workers;
+		std::deque<SearchJob*> jobs;
+		std::mutex jobsMutex;
+		std::condition_variable jobsCondition;
+		bool stopping;
+		unsigned char startDepth;
+		Metrics* metrics; // Told about every search, nullptr = none.
+
+		void Work(unsigned int workerIndex);
+
+	public:
+		/*
+			Starts config.nrOfSearchThreads workers, 0 = one per core. The Minimax engines share the memory budget equally.
+		*/
+		EnginePool(const Config& config);
+		virtual ~EnginePool();
+
+		/*
+			Queues the job. Its done flag is set when the move has been found. 
+			The job must stay alive until then.
+		*/
+		void Submit(SearchJob* job);
+		/*
+			Sets the metrics the workers record their searches in. Call before submitting jobs.
+		*/
+		void SetMetrics(Metrics* metrics) { this->metrics = metrics; }
+		unsigned int GetNrOfWorkers() const { return (unsigned int)this->workers.size(); }
+};
@@ -0,0 +1,71 @@
+#include "Evaluation.h"
+
+#include <fstream>
+#include <sstream>
+#include <string.h>
+
+EvaluationWeights::EvaluationWeights()
+{
+	for(unsigned char i = 0; i < EVALUATION_NR_OF_FEATURES; i++)
+	{
+		this->weights[i] = 0;
+	}
+	this->weights[FEATURE_KALAH_DIFFERENCE] = EVALUATION_WEIGHT_SCALE;
+	this->weights[FEATURE_STEALABLE_SEEDS] = EVALUATION_WEIGHT_SCALE;
+	this->weights[FEATURE_EXTRA_TURN] = 6 * EVALUATION_WEIGHT_SCALE;
+}
+
+bool EvaluationWeights::Load(const char* fileName)
+{
+	ifstream in(fileName);
+	if(!in)
+	{
+		return false;
+	}
+
+	// Only change the weights if the whole file is valid.
+	short loaded[EVALUATION_NR_OF_FEATURES];
+	memcpy(loaded, this->weights, sizeof(loaded));
+	string line;
+	while(getline(in, line))
+	{
+		if(line.empty() || line[0] == '#' || line[0] == '\r')
+		{
+			continue;
+		}
+		istringstream stream(line);
+		string name;
+		int weight;
+		if(!(stream >> name >> weight) || weight < SHRT_MIN || weight > SHRT_MAX)
+		{
+			return false;
+		}
+		unsigned char feature = 0;
+		while(feature < EVALUATION_NR_OF_FEATURES && name != EVALUATION_FEATURE_NAMES[feature])
+		{
+			feature++;
+		}
+		if(feature == EVALUATION_NR_OF_FEATURES)
+		{
+			return false;
+		}
+		loaded[feature] = (short)weight;
+	}
+	memcpy(this->weights, loaded, sizeof(loaded));
+	return true;
+}
+
+bool EvaluationWeights::Save(const char* fileName) const
+{
+	ofstream out(fileName);
+	if(!out)
+	{
+		return false;
+	}
+	out << "# Evaluation weights in 1/" << EVALUATION_WEIGHT_SCALE << " seeds, see EVALUATION_FEATURE in Evaluation.h." << endl;
+	for(unsigned char i = 0; i < EVALUATION_NR_OF_FEATURES; i++)
+	{
+		out << EVALUATION_FEATURE_NAMES[i] << " " << this->weights[i] << endl;
+	}
+	return (bool)out;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Board.h"
+#include <limits.h>
+
+static const short EVALUATION_WEIGHT_SCALE = 16; // The weights are in 1/16 seeds.
+static const char* const EVALUATION_WEIGHTS_FILE_NAME = "Weights.txt";
+
+/*
+	The features of a position used by the evaluation, all counted for max (negative when they favour min).
+*/
+enum EVALUATION_FEATURE
+{
+	FEATURE_KALAH_DIFFERENCE		= 0, // Seeds in max's kalah - seeds in min's kalah.
+	FEATURE_STEALABLE_SEEDS			= 1, // The most seeds the player to move can capture (+ the last seed placed).
+	FEATURE_EXTRA_TURN				= 2, // 1 if the player to move can get an extra turn but can't capture.
+	FEATURE_AMBO_SEED_DIFFERENCE	= 3, // Seeds on max's side - seeds on min's side.
+	FEATURE_EXTRA_TURN_AMBOS		= 4, // Ambos giving an extra turn, max's - min's.
+	FEATURE_THREATENED_SEEDS		= 5, // The most seeds the player not to move could capture on its next turn.
+	EVALUATION_NR_OF_FEATURES		= 6
+};
+
+// The names of the features in the weights file.
+static const char* const EVALUATION_FEATURE_NAMES[EVALUATION_NR_OF_FEATURES] =
+{
+	"KalahDifference", "StealableSeeds", "ExtraTurn", "AmboSeedDifference", "ExtraTurnAmbos", "ThreatenedSeeds"
+};
+
+inline short CountBits(unsigned char bits)
+{
+	short count = 0;
+	for(; bits != 0; bits &= bits - 1)
+	{
+		count++;
+	}
+	return count;
+}
+
+/*
+	Writes the features of the board, with min to move if minTurn is set, to features.
+*/
+inline void ExtractFeatures(const Board& board, bool minTurn, short features[EVALUATION_NR_OF_FEATURES])
+{
+	features[FEATURE_KALAH_DIFFERENCE] = (short)board.GetNrOfSeedsInKalah(0) - board.GetNrOfSeedsInKalah(1);
+	features[FEATURE_STEALABLE_SEEDS] = board.CanGetOpponentSeeds(minTurn);
+	// An extra turn only counts when no seeds can be stolen, the player takes the better of the two.
+	features[FEATURE_EXTRA_TURN] = features[FEATURE_STEALABLE_SEEDS] == 0 ? board.CanGetExtraTurn(minTurn) : 0;
+	features[FEATURE_AMBO_SEED_DIFFERENCE] = (short)board.GetNrOfSeedsInAmbos(0) - board.GetNrOfSeedsInAmbos(1);
+	features[FEATURE_EXTRA_TURN_AMBOS] = CountBits(board.GetExtraTurnAmbos(0)) - CountBits(board.GetExtraTurnAmbos(1));
+	features[FEATURE_THREATENED_SEEDS] = board.CanGetOpponentSeeds(!minTurn);
+}
+
+/*
+	The weights of the evaluation features, in 1/EVALUATION_WEIGHT_SCALE seeds.
+	The defaults are the hand-made evaluation: the kalah difference plus the seeds the player to move can steal,
+	or else 6 seeds for an extra turn.
+*/
+struct EvaluationWeights
+{
+	short weights[EVALUATION_NR_OF_FEATURES];
+
+	EvaluationWeights();
+
+	/*
+		Returns the evaluation of the features in seeds, kept inside the range of the utility values.
+	*/
+	char Evaluate(const short features[EVALUATION_NR_OF_FEATURES]) const
+	{
+		int sum = 0;
+		for(unsigned char i = 0; i < EVALUATION_NR_OF_FEATURES; i++)
+		{
+			sum += this->weights[i] * features[i];
+		}
+		sum /= EVALUATION_WEIGHT_SCALE;
+		return (char)max(SCHAR_MIN + 1, min(sum, SCHAR_MAX - 1));
+	}
+	/*
+		Reads the weights from a text file of "<feature name> <weight>" lines, '#' starts a comment.
+		Features missing from the file keep their weights. Returns false if the file could not be read or is corrupt.
+	*/
+	bool Load(const char* fileName);
+	bool Save(const char* fileName) const;
+};
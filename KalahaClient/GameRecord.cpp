@@ -0,0 +1,224 @@
+#include "GameRecord.h"
+
+#include <fstream>
+#include <string.h>
+
+string makeBoardStr(const unsigned char ambos[AMBO_COUNT]) 
+{
+	//Generate a nice output of the board.
+	string out = "\n[2]";
+
+	for(int i = AMBO_COUNT - 2; i > AMBO_PLAYER_COUNT; i--)
+	{
+		out += makeSpaces(to_string(ambos[i]));
+	}
+
+	out += "\n" + makeSpaces(to_string(ambos[AMBO_COUNT - 1])) + "                  " + makeSpaces(to_string(ambos[AMBO_PLAYER_COUNT])) + "\n" + "[1]";
+
+	for(int i = 0; i < AMBO_PLAYER_COUNT; i++)
+	{
+		out += makeSpaces(to_string(ambos[i]));
+	}
+
+	return out;
+}
+
+string makeSpaces(string str) 
+{
+	string res = "";
+
+	//Formats a number (0-99) to a nice string.
+	if(str.length() == 2) 
+	{
+		res = " " + str;
+	}
+	else if(str.length() == 1) 
+	{
+		res = "  " + str;
+	}
+	else 
+	{
+		res = str;
+	}
+
+	return res;
+}
+
+// Reads the rest of a record, after its type.
+static bool ReadRecord(ifstream& in, void* record, unsigned int size)
+{
+	in.read((char*)record + 1, size - 1);
+	return in.gcount() == (streamsize)(size - 1);
+}
+
+bool DecodeGameRecords(const char* fileName, ostream& out)
+{
+	ifstream in(fileName, ios::in | ios::binary);
+	if(!in)
+	{
+		out << "Failed to open " << fileName << endl;
+		return false;
+	}
+
+	unsigned int nrOfGames = 0;
+	unsigned int nrOfMoves = 0;
+	char type = 0;
+	while(in.get(type))
+	{
+		switch(type)
+		{
+			case GAME_RECORD_FILE:
+			{
+				GameRecordFile record;
+				if(!ReadRecord(in, &record, sizeof(record)) || memcmp(record.magic, GAME_RECORD_MAGIC, sizeof(GAME_RECORD_MAGIC)) != 0)
+				{
+					out << "Corrupt file header." << endl;
+					return false;
+				}
+				if(record.version != GAME_RECORD_VERSION)
+				{
+					out << "Unsupported version " << (int)record.version << "." << endl;
+					return false;
+				}
+				out << "Session started at " << record.time << " (seconds since 1970)." << endl;
+			}
+			break;
+			case GAME_RECORD_START:
+			{
+				GameRecordStart record;
+				if(!ReadRecord(in, &record, sizeof(record)))
+				{
+					out << "Truncated game start record." << endl;
+					return false;
+				}
+				nrOfGames++;
+				out << endl << "[" << record.time << " ms] Game " << record.gameId << ": started as player " << (int)record.player << "." << endl;
+			}
+			break;
+			case GAME_RECORD_MOVE:
+			{
+				GameRecordMove record;
+				if(!ReadRecord(in, &record, sizeof(record)))
+				{
+					out << "Truncated move record." << endl;
+					return false;
+				}
+				nrOfMoves++;
+				out << makeBoardStr(record.ambos) << endl;
+				out << "Game " << record.gameId << ": move " << (int)record.amboIndex + 1 << " after " << record.searchTime << " ms, depth ";
+				out << (int)record.depth << ", " << record.nrOfNodes << " nodes." << endl;
+			}
+			break;
+			case GAME_RECORD_END:
+			{
+				GameRecordEnd record;
+				if(!ReadRecord(in, &record, sizeof(record)))
+				{
+					out << "Truncated game end record." << endl;
+					return false;
+				}
+				out << "[" << record.time << " ms] Game " << record.gameId << ": player " << (int)record.winner << " won ";
+				out << (int)record.score[0] << " - " << (int)record.score[1] << "." << endl;
+			}
+			break;
+			default:
+				out << "Unknown record type " << (int)type << " at byte " << (long long)in.tellg() - 1 << "." << endl;
+				return false;
+			break;
+		}
+	}
+
+	out << endl << nrOfGames << " games, " << nrOfMoves << " of our moves." << endl;
+	return true;
+}
+
+bool GameRecordReader::Open(const char* fileName)
+{
+	this->games.clear();
+	this->error.clear();
+	this->in.open(fileName, ios::in | ios::binary);
+	if(!this->in)
+	{
+		this->error = string("Failed to open ") + fileName;
+		return false;
+	}
+	return true;
+}
+
+bool GameRecordReader::NextGame(RecordedGame& game)
+{
+	char type = 0;
+	while(this->in.get(type))
+	{
+		switch(type)
+		{
+			case GAME_RECORD_FILE:
+			{
+				GameRecordFile record;
+				if(!ReadRecord(this->in, &record, sizeof(record)) || memcmp(record.magic, GAME_RECORD_MAGIC, sizeof(GAME_RECORD_MAGIC)) != 0
+					|| record.version != GAME_RECORD_VERSION)
+				{
+					this->error = "Corrupt or unsupported file header.";
+					return false;
+				}
+				// The game ids of a new session start over, the games of the previous session were not ended.
+				this->games.clear();
+			}
+			break;
+			case GAME_RECORD_START:
+			{
+				GameRecordStart record;
+				if(!ReadRecord(this->in, &record, sizeof(record)))
+				{
+					this->error = "Truncated game start record.";
+					return false;
+				}
+				RecordedGame& started = this->games[record.gameId];
+				started.gameId = record.gameId;
+				started.player = record.player;
+				started.moves.clear();
+			}
+			break;
+			case GAME_RECORD_MOVE:
+			{
+				GameRecordMove record;
+				if(!ReadRecord(this->in, &record, sizeof(record)))
+				{
+					this->error = "Truncated move record.";
+					return false;
+				}
+				std::map<unsigned short, RecordedGame>::iterator started = this->games.find(record.gameId);
+				if(started != this->games.end())
+				{
+					started->second.moves.push_back(record);
+				}
+			}
+			break;
+			case GAME_RECORD_END:
+			{
+				GameRecordEnd record;
+				if(!ReadRecord(this->in, &record, sizeof(record)))
+				{
+					this->error = "Truncated game end record.";
+					return false;
+				}
+				std::map<unsigned short, RecordedGame>::iterator started = this->games.find(record.gameId);
+				if(started != this->games.end())
+				{
+					game.gameId = started->second.gameId;
+					game.player = started->second.player;
+					game.moves.swap(started->second.moves);
+					game.end = record;
+					this->games.erase(started);
+					return true;
+				}
+			}
+			break;
+			default:
+				this->error = "Unknown record type " + to_string((int)type) + ".";
+				return false;
+			break;
+		}
+	}
+	return false;
+}
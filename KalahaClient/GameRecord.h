@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Board.h"
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <vector>
+
+static const char GAME_RECORD_MAGIC[3] = {'K', 'G', 'R'};
+static const unsigned char GAME_RECORD_VERSION = 1;
+static const char* const GAME_RECORD_FILE_NAME = "Games.kgr";
+
+/*
+	The records of a game record file. Every record starts with its type.
+	A file may contain several sessions, each starting with a GameRecordFile.
+*/
+enum GAME_RECORD_TYPE
+{
+	GAME_RECORD_FILE	= 1,
+	GAME_RECORD_START	= 2,
+	GAME_RECORD_MOVE	= 3,
+	GAME_RECORD_END		= 4
+};
+
+#pragma pack(push, 1)
+struct GameRecordFile
+{
+	unsigned char type;
+	char magic[3];
+	unsigned char version;
+	unsigned int time; // Seconds since 1970.
+};
+
+struct GameRecordStart
+{
+	unsigned char type;
+	unsigned short gameId; // The connection, several games may be played at the same time.
+	unsigned char player; // Our player number, 1 or 2.
+	unsigned int time; // Milliseconds since the session started.
+};
+
+/*
+	One of our moves, with the board it was made from (as received from the server).
+	The opponent's moves are the differences between the boards.
+*/
+struct GameRecordMove
+{
+	unsigned char type;
+	unsigned short gameId;
+	unsigned char ambos[AMBO_COUNT];
+	unsigned char amboIndex; // 0-5.
+	unsigned short searchTime; // In milliseconds.
+	unsigned char depth;
+	unsigned int nrOfNodes;
+};
+
+struct GameRecordEnd
+{
+	unsigned char type;
+	unsigned short gameId;
+	char winner; // 0 = draw.
+	unsigned char score[2]; // The seeds in the kalahs of player 1 and 2, 0 - 0 if the final board could not be parsed.
+	unsigned int time; // Milliseconds since the session started.
+};
+#pragma pack(pop)
+
+/*
+	Returns a printable string of the board (player 2 on top).
+*/
+string makeBoardStr(const unsigned char ambos[AMBO_COUNT]);
+string makeSpaces(string str);
+/*
+	Prints the records of a game record file as text.
+	Returns false if the file could not be read or is corrupt.
+*/
+bool DecodeGameRecords(const char* fileName, ostream& out);
+
+/*
+	A game read from a game record file: our moves in the order they were made and the result.
+*/
+struct RecordedGame
+{
+	unsigned short gameId;
+	unsigned char player; // Our player number, 1 or 2.
+	std::vector<GameRecordMove> moves;
+	GameRecordEnd end;
+};
+
+/*
+	Reads the games of a game record file one at a time. The records are read as they are needed and a game is
+	returned when its end record is read, so the memory used only depends on the number of games played at the same time,
+	not on the size of the file. Games without an end record (the client was stopped) are skipped.
+*/
+class GameRecordReader
+{
+	private:
+		ifstream in;
+		std::map<unsigned short, RecordedGame> games; // Started and not yet ended, by game id.
+		string error; // Why the latest read failed, empty at the end of the file.
+
+	public:
+		bool Open(const char* fileName);
+		/*
+			Reads records until a game has ended and moves it to game.
+			Returns false at the end of the file or if the file is corrupt (see GetError()).
+		*/
+		bool NextGame(RecordedGame& game);
+		const string& GetError() const { return this->error; }
+};
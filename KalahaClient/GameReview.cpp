@@ -0,0 +1,245 @@
+#include "GameReview.h"
+
+#include <thread>
+#include <sstream>
+#include <Windows.h>
+
+// Writes the ambos in the format of the server (player 2's kalah first), as read by -analyze and -trace-search.
+static string FormatBoard(const unsigned char ambos[AMBO_COUNT])
+{
+	string board = to_string((int)ambos[AMBO_COUNT - 1]);
+	for(unsigned char i = 0; i < AMBO_COUNT - 1; i++)
+	{
+		board += ";" + to_string((int)ambos[i]);
+	}
+	return board;
+}
+
+GameReviewer::GameReviewer(const Config& config, unsigned char depth, unsigned char margin) : config(config)
+{
+	this->depth = depth;
+	this->margin = margin;
+	this->nrOfThreads = config.nrOfSearchThreads != 0 ? config.nrOfSearchThreads : max(std::thread::hardware_concurrency(), 1U);
+	this->readAll = false;
+}
+
+void GameReviewer::AnalyzeGame(ReviewedGame& reviewed) const
+{
+	Minimax minimax;
+	ConfigureMinimax(minimax, this->config, this->nrOfThreads);
+
+	// The boards are recorded as received from the server, player 1 is max.
+	bool minTurn = reviewed.game.player == 2;
+	reviewed.utilities.resize(reviewed.game.moves.size() * AMBO_PLAYER_COUNT);
+	reviewed.nrOfNodes = 0;
+	for(unsigned int m = 0; m < reviewed.game.moves.size(); m++)
+	{
+		Board board(reviewed.game.moves[m].ambos);
+		for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+		{
+			char& utility = reviewed.utilities[m * AMBO_PLAYER_COUNT + i];
+			Board child = board;
+			MoveOutcome outcome = child.MoveSeeds(i, minTurn);
+			if(!outcome.IsValid())
+			{
+				utility = REVIEW_INVALID_MOVE;
+				continue;
+			}
+			bool extraTurn = outcome.extraTurn && !outcome.terminal;
+			minimax.ResetNrOfNodes();
+			utility = minimax.Analyze(child, extraTurn ? minTurn : !minTurn, minimax.ChildDepth(this->depth, extraTurn));
+			reviewed.nrOfNodes += minimax.GetNrOfNodes();
+		}
+	}
+}
+
+void GameReviewer::Analyze()
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+	while(true)
+	{
+		this->changed.wait(lock, [this]() { return !this->queue.empty() || this->readAll; });
+		if(this->queue.empty())
+		{
+			return;
+		}
+		ReviewedGame* reviewed = this->queue.front();
+		this->queue.pop_front();
+		lock.unlock();
+		this->AnalyzeGame(*reviewed);
+		lock.lock();
+		this->analysed[reviewed->index] = reviewed;
+		this->changed.notify_all();
+	}
+}
+
+bool GameReviewer::Review(const char* fileName, const char* reportFileName, ostream& out)
+{
+	GameRecordReader reader;
+	if(!reader.Open(fileName))
+	{
+		out << reader.GetError() << endl;
+		return false;
+	}
+	ofstream report(reportFileName);
+	if(!report)
+	{
+		out << "Failed to open " << reportFileName << endl;
+		return false;
+	}
+	report << "Review of " << fileName << " at depth " << (int)this->depth << ", moves " << (int)this->margin;
+	report << " seeds or more worse than the best are flagged." << endl << endl;
+	out << "Reviewing " << fileName << " with " << this->nrOfThreads << " threads." << endl;
+
+	DWORD startTime = timeGetTime();
+	this->readAll = false;
+	std::vector<std::thread> threads;
+	for(unsigned int t = 0; t < this->nrOfThreads; t++)
+	{
+		threads.push_back(std::thread(&GameReviewer::Analyze, this));
+	}
+
+	// Totals of the report.
+	unsigned int nrOfGames = 0;
+	unsigned int nrOfPositions = 0;
+	unsigned int nrOfBestMoves = 0; // Positions where the played move was (one of) the best.
+	unsigned int nrOfFlaggedMoves = 0;
+	unsigned long long totalLoss = 0;
+	unsigned long long nrOfNodes = 0;
+
+	// Writes the analysed games that are next in the file to the report, without holding the lock while writing.
+	unsigned int nrOfGamesRead = 0;
+	auto reportGames = [&](std::unique_lock<std::mutex>& lock)
+	{
+		std::vector<ReviewedGame*> ready;
+		std::map<unsigned int, ReviewedGame*>::iterator next;
+		while((next = this->analysed.find(nrOfGames + (unsigned int)ready.size())) != this->analysed.end())
+		{
+			ready.push_back(next->second);
+			this->analysed.erase(next);
+		}
+		if(ready.empty())
+		{
+			return;
+		}
+		lock.unlock();
+		for(unsigned int g = 0; g < ready.size(); g++)
+		{
+			ReviewedGame* reviewed = ready[g];
+			const RecordedGame& game = reviewed->game;
+			bool minTurn = game.player == 2;
+			std::ostringstream flagged;
+			unsigned int nrOfGameFlaggedMoves = 0;
+			unsigned int gameLoss = 0;
+			for(unsigned int m = 0; m < game.moves.size(); m++)
+			{
+				const char* utilities = &reviewed->utilities[m * AMBO_PLAYER_COUNT];
+				unsigned char played = game.moves[m].amboIndex;
+				char bestMove = -1;
+				for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+				{
+					if(utilities[i] != REVIEW_INVALID_MOVE && (bestMove == -1 || (minTurn ? utilities[i] < utilities[bestMove] : utilities[i] > utilities[bestMove])))
+					{
+						bestMove = i;
+					}
+				}
+				if(played >= AMBO_PLAYER_COUNT || utilities[played] == REVIEW_INVALID_MOVE)
+				{
+					flagged << "  Move " << m + 1 << ": played the empty ambo " << (int)played << ". Board " << FormatBoard(game.moves[m].ambos) << endl;
+					nrOfGameFlaggedMoves++;
+					continue;
+				}
+				unsigned int loss = minTurn ? utilities[played] - utilities[bestMove] : utilities[bestMove] - utilities[played];
+				nrOfPositions++;
+				gameLoss += loss;
+				nrOfBestMoves += loss == 0 ? 1 : 0;
+				if(loss >= this->margin)
+				{
+					flagged << "  Move " << m + 1 << ": played " << (int)played << " (" << (int)utilities[played] << "), best " << (int)bestMove;
+					flagged << " (" << (int)utilities[bestMove] << "), loss " << loss << ". Board " << FormatBoard(game.moves[m].ambos) << endl;
+					nrOfGameFlaggedMoves++;
+				}
+			}
+			const char* result = game.end.winner == 0 ? "draw" : (game.end.winner == game.player ? "won" : "lost");
+			report << "Game " << reviewed->index + 1 << " (id " << game.gameId << ", player " << (int)game.player << ", " << result << " ";
+			report << (int)game.end.score[0] << " - " << (int)game.end.score[1] << "): " << game.moves.size() << " moves, ";
+			report << nrOfGameFlaggedMoves << " flagged, loss " << gameLoss << " seeds." << endl << flagged.str();
+			nrOfFlaggedMoves += nrOfGameFlaggedMoves;
+			totalLoss += gameLoss;
+			nrOfNodes += reviewed->nrOfNodes;
+			delete reviewed;
+		}
+		nrOfGames += (unsigned int)ready.size();
+		if(nrOfGames / 100 != (nrOfGames - ready.size()) / 100)
+		{
+			out << "Reviewed " << nrOfGames << " games (" << timeGetTime() - startTime << " ms)." << endl;
+		}
+		lock.lock();
+	};
+
+	// Read ahead only a few games per thread, waiting for the reports of the earlier ones.
+	RecordedGame game;
+	std::unique_lock<std::mutex> lock(this->mutex);
+	lock.unlock();
+	while(reader.NextGame(game))
+	{
+		ReviewedGame* reviewed = new ReviewedGame();
+		reviewed->index = nrOfGamesRead++;
+		reviewed->game.gameId = game.gameId;
+		reviewed->game.player = game.player;
+		reviewed->game.moves.swap(game.moves);
+		reviewed->game.end = game.end;
+		lock.lock();
+		this->queue.push_back(reviewed);
+		this->changed.notify_all();
+		while(true)
+		{
+			reportGames(lock);
+			if(nrOfGamesRead - nrOfGames < REVIEW_GAMES_IN_FLIGHT * this->nrOfThreads)
+			{
+				break;
+			}
+			if(this->analysed.count(nrOfGames) == 0) // A game may have been analysed while the report was written.
+			{
+				this->changed.wait(lock);
+			}
+		}
+		lock.unlock();
+	}
+	lock.lock();
+	this->readAll = true;
+	this->changed.notify_all();
+	while(true)
+	{
+		reportGames(lock);
+		if(nrOfGames == nrOfGamesRead)
+		{
+			break;
+		}
+		if(this->analysed.count(nrOfGames) == 0)
+		{
+			this->changed.wait(lock);
+		}
+	}
+	lock.unlock();
+	for(unsigned int t = 0; t < threads.size(); t++)
+	{
+		threads[t].join();
+	}
+
+	DWORD time = max(timeGetTime() - startTime, (DWORD)1);
+	std::ostringstream summary;
+	summary << nrOfGames << " games, " << nrOfPositions << " positions: the best move was played in " << nrOfBestMoves << ", ";
+	summary << nrOfFlaggedMoves << " moves flagged, mean loss " << (nrOfPositions ? (double)totalLoss / nrOfPositions : 0.0) << " seeds per move." << endl;
+	summary << nrOfNodes << " nodes in " << time << " ms (" << (unsigned long long)nrOfPositions * 1000 / time << " positions/s, ";
+	summary << nrOfNodes / time << " knodes/s)." << endl;
+	report << endl << summary.str();
+	out << summary.str() << "Wrote the report to " << reportFileName << endl;
+	if(!reader.GetError().empty())
+	{
+		out << reader.GetError() << endl;
+		report << reader.GetError() << endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Config.h"
+#include "GameRecord.h"
+#include "Minimax.h"
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+
+static const unsigned char REVIEW_DEFAULT_DEPTH = 10;
+static const unsigned char REVIEW_DEFAULT_MARGIN = 3; // Seeds the played move may be worse than the best one before it is flagged.
+static const unsigned int REVIEW_GAMES_IN_FLIGHT = 4; // Games read ahead or waiting to be reported, per thread.
+static const char* const REVIEW_REPORT_FILE_NAME = "Review.txt";
+static const char REVIEW_INVALID_MOVE = SCHAR_MIN; // The utility of an empty ambo.
+
+/*
+	A game of the archive and the utilities of the moves in its positions.
+*/
+struct ReviewedGame
+{
+	unsigned int index; // In the file, counting from 0.
+	RecordedGame game;
+	std::vector<char> utilities; // AMBO_PLAYER_COUNT per recorded move, REVIEW_INVALID_MOVE for empty ambos.
+	unsigned long long nrOfNodes;
+};
+
+/*
+	Re-analyses the recorded games of a game record file: every position we moved in is replayed on a Board and
+	each move of it is searched to a fixed depth with Minimax. Moves whose utility is more than a margin worse than the
+	best move's are flagged in a report.
+	The file is streamed and the games are analysed by several threads, one game per thread at a time with a fresh
+	Minimax (so the result of a game doesn't depend on the thread or the games before it). Only a few games per thread
+	are read ahead, so the memory used doesn't depend on the size of the archive.
+*/
+class GameReviewer
+{
+	private:
+		const Config& config;
+		unsigned char depth;
+		unsigned char margin;
+		unsigned int nrOfThreads;
+		// Shared with the threads.
+		std::mutex mutex;
+		std::condition_variable changed; // Signalled when a game is queued, analysed, or the file has been read.
+		std::deque<ReviewedGame*> queue; // Read and not yet analysed.
+		std::map<unsigned int, ReviewedGame*> analysed; // By index, until they are reported in the order of the file.
+		bool readAll;
+
+		/*
+			The analysis thread: takes games from the queue until the file has been read.
+		*/
+		void Analyze();
+		/*
+			Searches every move of the recorded positions of the game.
+		*/
+		void AnalyzeGame(ReviewedGame& reviewed) const;
+
+	public:
+		/*
+			depth = The depth of the search of a position (the moves are searched one ply less deep).
+			margin = In seeds. The settings of the search, and the number of threads (nrOfSearchThreads), are taken from the config.
+		*/
+		GameReviewer(const Config& config, unsigned char depth, unsigned char margin);
+
+		/*
+			Analyses the games of the file and writes the flagged moves and a summary to the report, and the progress to out.
+			Returns false if a file could not be opened or the game record file is corrupt (the games read before are reported).
+		*/
+		bool Review(const char* fileName, const char* reportFileName, ostream& out);
+};
@@ -19,48 +19,48 @@
 
 using namespace std;
 
-#include "Minimax.h"
+#include "Config.h"
+#include "MultiGameClient.h"
+#include "ProtocolBenchmark.h"
+#include "RulesBenchmark.h"
+#include "Logger.h"
+#include "Mcts.h"
+#include "DistributedAnalysis.h"
+#include "WeightTuner.h"
+#include "Metrics.h"
+#include "SearchTrace.h"
+#include "GameReview.h"
+#include "SpanTrace.h"
 
 #pragma comment(lib, "wsock32.lib")
 #ifdef _DEBUG
 	#include "vld.h" // Debug, to locate memory leaks.
 #endif
 
-void gameLoop(int mySocket, int player);
-void makeMove(int mySocket, int player);
-void sendMoveCmd(int mySocket, int player, int myMove);
-string makeBoardStr(char input[]);
-string makeSpaces(string str);
-void tokenizeBoard(char input[], vector<string> &tokens);
-
-enum ERROR_CODE
-{
-	ERROR_GAME_FULL				= 0,
-	ERROR_GAME_NOT_FULL			= 1,
-	ERROR_ARGLENGTH_NOT_VALID	= 2,
-	ERROR_ARGTYPE_NOT_VALID		= 3,
-	ERROR_PLAYER_OUT_OF_TURN	= 4,
-	ERROR_CMD_NOT_FOUND			= 5,
-	ERROR_AMBO_EMPTY			= 6
-};
-
-struct Config
-{
-	int port;
-	string address;
-	unsigned char startDepth;
-	unsigned int sleepTime;
-	unsigned short int timeLimit; // In milliseconds.
-	unsigned int nrOfGames;
-};
+void gameLoop(ServerConnection& server, int player);
+void makeMove(ServerConnection& server, int player);
+bool sendMoveCmd(ServerConnection& server, int player, int myMove); // Returns false if the move could not be sent.
+bool ReceiveMoveResponse(ServerConnection& server); // Returns false if the connection failed.
+/*
+	Hands the text of the stream to the logger and clears the stream.
+*/
+void Print(ostringstream& stream);
+/*
+	Writes the recorded trace spans to SPAN_TRACE_FILE_NAME, if they are enabled (traceSpans).
+*/
+void WriteSpans();
 
 Config config;
+Logger logger; // Writes the console output and the game records in the background.
+Metrics metrics; // Served to a local endpoint if config.metricsPort is set.
 
+void SetDefaultConfig();
+/*
+	Reads the next value of the config file, skipping comments and empty lines.
+	Returns false if the end of the file was reached.
+*/
+bool ReadConfigValue(ifstream& in, char* input, int size);
 bool ReadConfigFile(const char* fileName);
-void GetBoard(int socket, unsigned char* ambos);
-void PrintBoard(int socket);
-string ErrorCodeToString(ERROR_CODE errorCode);
-int ErrorCode(char input[]); // Return -1 if there's no error.
 
 
 int main(int a, char *args[]) 
@@ -69,17 +69,217 @@ int main(int a, char *args[])
 	_CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF); // Debug, to detect memory leaks.
 #endif
 
+	// Tools that don't need a server.
+	if(a > 1 && strcmp(args[1], "-benchmark-protocol") == 0)
+	{
+		RunProtocolBenchmark(a > 2 ? atoi(args[2]) : 1000000);
+		return 0;
+	}
+	if(a > 1 && strcmp(args[1], "-fuzz-protocol") == 0)
+	{
+		return RunProtocolFuzzTest(a > 2 ? atoi(args[2]) : 100000) == 0 ? 0 : 1;
+	}
+	if(a > 1 && strcmp(args[1], "-benchmark-rules") == 0)
+	{
+		return RunRulesBenchmark(a > 2 ? (unsigned char)atoi(args[2]) : 0, cout) == 0 ? 0 : 1;
+	}
+	if(a > 1 && strcmp(args[1], "-decode-games") == 0)
+	{
+		return DecodeGameRecords(a > 2 ? args[2] : GAME_RECORD_FILE_NAME, cout) ? 0 : 1;
+	}
+	if(a > 1 && strcmp(args[1], "-trace-stats") == 0)
+	{
+		return PrintSearchTraceStats(a > 2 ? args[2] : SEARCH_TRACE_FILE_NAME, cout) ? 0 : 1;
+	}
+	// -trace-tree [trace file] [moves from the root, e.g. 25, - for the root] [plies]
+	if(a > 1 && strcmp(args[1], "-trace-tree") == 0)
+	{
+		string moves = a > 3 && strcmp(args[3], "-") != 0 ? args[3] : "";
+		unsigned char plies = a > 4 ? (unsigned char)atoi(args[4]) : 2;
+		return PrintSearchTraceTree(a > 2 ? args[2] : SEARCH_TRACE_FILE_NAME, moves, plies, cout) ? 0 : 1;
+	}
+
 	// Read configuration file.
+	SetDefaultConfig();
 	if(!ReadConfigFile("Config.cfg"))
 	{
 		cout << "Failed to load config file. " << endl;
 		cout << "Using default values instead. " << endl;
-		config.port = 8888;
-		config.address = "127.0.0.1";
-		config.startDepth = 8;
-		config.sleepTime = 100;
-		config.timeLimit = 3000;
-		config.nrOfGames = 2;
+	}
+	if(!config.evaluationWeights.Load(config.weightsFile.c_str()) && ifstream(config.weightsFile.c_str()))
+	{
+		cout << "Failed to load the evaluation weights from " << config.weightsFile << ", using the default weights." << endl;
+	}
+
+	// Evaluation tuning: -tune-weights [game records] [weights file], the weights in the config are the starting point.
+	if(a > 1 && strcmp(args[1], "-tune-weights") == 0)
+	{
+		WeightTuner tuner(config.nrOfSearchThreads);
+		if(!tuner.AddGames(a > 2 ? args[2] : GAME_RECORD_FILE_NAME, cout) && tuner.GetNrOfPositions() == 0)
+		{
+			return 1;
+		}
+		EvaluationWeights weights = config.evaluationWeights;
+		tuner.Tune(weights, TUNER_NR_OF_ITERATIONS, cout);
+		const char* fileName = a > 3 ? args[3] : config.weightsFile.c_str();
+		if(!weights.Save(fileName))
+		{
+			cout << "Failed to write " << fileName << endl;
+			return 1;
+		}
+		cout << "Wrote the weights to " << fileName << endl;
+		return 0;
+	}
+
+	// Game review: -review-games [game records] [depth] [margin in seeds] [report file], searched with the settings of the config.
+	if(a > 1 && strcmp(args[1], "-review-games") == 0)
+	{
+		unsigned char depth = a > 3 ? (unsigned char)atoi(args[3]) : REVIEW_DEFAULT_DEPTH;
+		unsigned char margin = a > 4 ? (unsigned char)atoi(args[4]) : REVIEW_DEFAULT_MARGIN;
+		GameReviewer reviewer(config, depth, margin);
+		return reviewer.Review(a > 2 ? args[2] : GAME_RECORD_FILE_NAME, a > 5 ? args[5] : REVIEW_REPORT_FILE_NAME, cout) ? 0 : 1;
+	}
+
+	// Search tracing: -trace-search <depth> [trace file] [board as sent by the server, player 1 to move] searches the board
+	// with the settings of the config and streams the searched tree to the file, read by -trace-stats and -trace-tree.
+	if(a > 2 && strcmp(args[1], "-trace-search") == 0)
+	{
+		Board board;
+		if(a > 4)
+		{
+			unsigned char ambos[AMBO_COUNT];
+			if(!ParseBoard(args[4], (unsigned short)strlen(args[4]), ambos))
+			{
+				cout << "Invalid board: " << args[4] << endl;
+				return 1;
+			}
+			board = Board(ambos);
+		}
+		const char* fileName = a > 3 ? args[3] : SEARCH_TRACE_FILE_NAME;
+		SearchTraceWriter writer;
+		if(!writer.Open(fileName))
+		{
+			cout << "Failed to open " << fileName << endl;
+			return 1;
+		}
+		Minimax minimax;
+		ConfigureMinimax(minimax, config);
+		minimax.SetSearchVisitor(&writer);
+		DWORD startTime = timeGetTime();
+		char utility = minimax.Analyze(board, false, (unsigned char)atoi(args[2]));
+		minimax.SetSearchVisitor(nullptr);
+		if(!writer.Close())
+		{
+			cout << "Failed to write " << fileName << endl;
+			return 1;
+		}
+		cout << "Utility " << (int)utility << ", " << minimax.GetNrOfNodes() << " nodes in " << timeGetTime() - startTime << " ms. ";
+		cout << "Wrote " << writer.GetNrOfBytes() << " bytes to " << fileName << "." << endl;
+		return 0;
+	}
+
+	// Multi-PV analysis: -analyze-lines <depth> [lines] [board as sent by the server, player 1 to move] writes the best
+	// moves of the board with their exact utilities and principal variations, searched with the settings of the config
+	// (selectiveSearch 0 for the utilities of a full-width search).
+	if(a > 2 && strcmp(args[1], "-analyze-lines") == 0)
+	{
+		Board board;
+		if(a > 4)
+		{
+			unsigned char ambos[AMBO_COUNT];
+			if(!ParseBoard(args[4], (unsigned short)strlen(args[4]), ambos))
+			{
+				cout << "Invalid board: " << args[4] << endl;
+				return 1;
+			}
+			board = Board(ambos);
+		}
+		Minimax minimax;
+		ConfigureMinimax(minimax, config);
+		std::vector<PrincipalVariation> lines;
+		DWORD startTime = timeGetTime();
+		minimax.AnalyzeLines(board, false, (unsigned char)atoi(args[2]), a > 3 ? (unsigned char)atoi(args[3]) : AMBO_PLAYER_COUNT, lines);
+		DWORD time = max(timeGetTime() - startTime, (DWORD)1);
+		for(unsigned int i = 0; i < lines.size(); i++)
+		{
+			cout << "Move " << lines[i].move + 1 << ": " << (int)lines[i].utility << ", line";
+			for(unsigned int m = 0; m < lines[i].moves.size(); m++)
+			{
+				cout << " " << lines[i].moves[m] + 1;
+			}
+			cout << endl;
+		}
+		cout << minimax.GetNrOfNodes() << " nodes in " << time << " ms, " << (unsigned long long)minimax.GetNrOfNodes() * 1000 / time << " nodes/s." << endl;
+		return 0;
+	}
+
+	// Engine match: -match-engines [games] [time limit in ms] plays the Monte Carlo tree search against Minimax, both set up 
+	// with the config, and writes the results of the Monte Carlo tree search and its playouts per second. The engines 
+	// switch sides every game, and each opening (two random moves) is played from both sides.
+	if(a > 1 && strcmp(args[1], "-match-engines") == 0)
+	{
+		unsigned int nrOfGames = a > 2 ? atoi(args[2]) : 100;
+		short int timeLimit = a > 3 ? (short int)atoi(args[3]) : config.timeLimit;
+		Minimax minimax;
+		minimax.SetTimeLimit(timeLimit);
+		minimax.SetSolverTableSize(config.solverTableSize);
+		ConfigureMinimax(minimax, config);
+		Mcts mcts;
+		mcts.SetTimeLimit(timeLimit);
+		mcts.SetNrOfThreads(config.nrOfSearchThreads);
+		mcts.SetPlayoutPolicy((MCTS_PLAYOUT_POLICY)config.playoutPolicy);
+		unsigned int results[3] = {0, 0, 0}; // Wins, draws and losses of the Monte Carlo tree search.
+		unsigned long long nrOfPlayouts = 0;
+		unsigned long long mctsTime = 0;
+		for(unsigned int game = 0; game < nrOfGames; game++)
+		{
+			minimax.StartGame();
+			mcts.StartGame();
+			Board board;
+			unsigned char player = 0;
+			srand(game / 2);
+			for(unsigned char ply = 0; ply < 2 && board.IsTerminalState() == -1; ply++)
+			{
+				unsigned char move;
+				do
+				{
+					move = (unsigned char)(rand() % AMBO_PLAYER_COUNT);
+				} while(board.GetNrOfSeeds(move, player) == 0);
+				player = board.MoveSeeds(move, player).extraTurn ? player : !player;
+			}
+			unsigned char mctsPlayer = game % 2;
+			while(board.IsTerminalState() == -1)
+			{
+				// Max (the engine to move) is always the first player.
+				Board view = board;
+				if(player == 1)
+				{
+					view.Swap();
+				}
+				char move;
+				if(player == mctsPlayer)
+				{
+					DWORD startTime = timeGetTime();
+					move = mcts.Search(view);
+					mctsTime += timeGetTime() - startTime;
+					nrOfPlayouts += mcts.GetNrOfPlayouts();
+				}
+				else
+				{
+					move = minimax.Search(view, config.startDepth);
+					minimax.KeepSubtree(move);
+				}
+				player = board.MoveSeeds(move, player).extraTurn ? player : !player;
+			}
+			// The seeds left on a side go to the kalah of that side.
+			int mctsScore = board.GetNrOfSeedsInKalah(mctsPlayer) + board.GetNrOfSeedsInAmbos(mctsPlayer);
+			int minimaxScore = board.GetNrOfSeedsInKalah(!mctsPlayer) + board.GetNrOfSeedsInAmbos(!mctsPlayer);
+			results[mctsScore > minimaxScore ? 0 : (mctsScore == minimaxScore ? 1 : 2)]++;
+			cout << "Game " << game + 1 << ": Monte Carlo tree search " << mctsScore << " - " << minimaxScore << " Minimax." << endl;
+		}
+		cout << "Monte Carlo tree search against Minimax: +" << results[0] << " =" << results[1] << " -" << results[2] << ", ";
+		cout << nrOfPlayouts * 1000 / max(mctsTime, 1ULL) << " playouts/s." << endl;
+		return 0;
 	}
 
 	//Connection details
@@ -90,6 +290,65 @@ int main(int a, char *args[])
 	WSADATA ws;
 	WSAStartup(0x0101, &ws);
 
+	// Offline analysis with several processes: -analyze <depth> [port] [board as sent by the server, player 1 to move] 
+	// and -analysis-worker [address] [port].
+	if(a > 2 && strcmp(args[1], "-analyze") == 0)
+	{
+		unsigned char ambos[AMBO_COUNT];
+		Board board;
+		if(a > 4)
+		{
+			if(!ParseBoard(args[4], (unsigned short)strlen(args[4]), ambos))
+			{
+				cout << "Invalid board: " << args[4] << endl;
+				return 1;
+			}
+			board = Board(ambos);
+		}
+		AnalysisCoordinator coordinator(config);
+		bool analyzed = coordinator.Analyze(board, (unsigned char)atoi(args[2]), a > 3 ? (unsigned short)atoi(args[3]) : ANALYSIS_DEFAULT_PORT, cout);
+		return analyzed ? 0 : 1;
+	}
+	if(a > 1 && strcmp(args[1], "-analysis-worker") == 0)
+	{
+		unsigned int nrOfJobs = RunAnalysisWorker(config, a > 2 ? args[2] : IP, a > 3 ? (unsigned short)atoi(args[3]) : ANALYSIS_DEFAULT_PORT);
+		cout << "Searched " << nrOfJobs << " jobs." << endl;
+		return 0;
+	}
+
+	if(config.traceSpans)
+	{
+		SpanTracer::Enable();
+		SpanTracer::NameThread("Game");
+	}
+	if(!logger.Start(config.recordGames ? GAME_RECORD_FILE_NAME : nullptr))
+	{
+		cout << "Failed to open " << GAME_RECORD_FILE_NAME << ", the games are not recorded." << endl;
+		logger.Start(nullptr);
+	}
+	if(config.metricsPort != 0 && !metrics.StartServer(config.metricsPort))
+	{
+		cout << "Failed to serve the metrics on port " << config.metricsPort << "." << endl;
+	}
+
+	// Play several games at the same time.
+	if(config.nrOfConnections > 1)
+	{
+		MultiGameClient client(config, logger, metrics);
+		if(client.Connect() == 0)
+		{
+			cout << "Error connecting to Kalaha server" << endl;
+		}
+		else
+		{
+			client.Run();
+		}
+		logger.Stop();
+		WriteSpans();
+		system("pause");
+		return 0;
+	}
+
 	//Create and configure the socket
 	int mySocket = socket(AF_INET, SOCK_STREAM, 0);
 	struct sockaddr_in peer; 
@@ -99,15 +358,15 @@ int main(int a, char *args[])
 
 	//Connect to server and game
 	connect(mySocket, (struct sockaddr*)&peer, sizeof(peer));
-	send(mySocket, "HELLO\n", 6, 0);
+	ServerConnection server(mySocket);
 	
 	//Check which player you are
-	char input[43]; 
-	recv(mySocket, input, sizeof(input), 0);
-	if (input[6] != '1' && input[6] != '2')  
+	unsigned short inputLength = 0;
+	const char* input = server.Request("HELLO\n", inputLength);
+	if (!input || inputLength < 7 || (input[6] != '1' && input[6] != '2'))  
 	{
 		cout << "Error connecting to Kalaha server" << endl;
-		cout << "Reason: " << ErrorCodeToString((ERROR_CODE)ErrorCode(input)) << endl;
+		cout << "Reason: " << ErrorCodeToString((ERROR_CODE)(input ? ParseErrorCode(input, inputLength) : -1)) << endl;
 		system("pause");
 		return 0;
 	}
@@ -115,12 +374,14 @@ int main(int a, char *args[])
 
 	cout << "Connected to Kalaha server as player " << player << endl;
 
-	gameLoop(mySocket, player);
+	gameLoop(server, player);
 
+	logger.Stop();
+	WriteSpans();
 	system("pause");
 }
 
-void gameLoop(int mySocket, int player) 
+void gameLoop(ServerConnection& server, int player) 
 {
 	bool gameRunning = true;
 	int opponent;
@@ -132,182 +393,311 @@ void gameLoop(int mySocket, int player)
 	{
 		opponent = 1;
 	}
-	char input[43];
+	const char* input = nullptr;
+	unsigned short inputLength = 0;
 
 	unsigned int nrOfVictories[2] = {0, 0}; 
 	unsigned int nrOfGamesCap = config.nrOfGames;
-	Minimax minimax = Minimax();
+	Minimax minimax;
 	minimax.SetTimeLimit(config.timeLimit);
+	minimax.SetGameTime(config.gameTime);
+	minimax.SetSolverTableSize(config.solverTableSize);
+	ConfigureMinimax(minimax, config);
+	Mcts mcts;
+	mcts.SetTimeLimit(config.timeLimit);
+	mcts.SetGameTime(config.gameTime);
+	mcts.SetNrOfThreads(config.nrOfSearchThreads);
+	mcts.SetPlayoutPolicy((MCTS_PLAYOUT_POLICY)config.playoutPolicy);
+	bool useMcts = config.engine == ENGINE_MCTS;
 	bool once = false;
+	bool movePending = false; // The response to our last move has not been received yet.
+	bool gameStarted = false; // The start of the current round has been recorded.
+	ostringstream out; // Console output, handed to the logger.
+	if(config.memoryBudget != 0 && minimax.GetMemoryUsage() >= (unsigned long long)config.memoryBudget * 1024 * 1024)
+	{
+		out << "The tables use the whole memory budget of " << config.memoryBudget << " MB, the search tree is not stored." << endl;
+		Print(out);
+	}
 
 	while (gameRunning) 
 	{
-		// Check if anyone has won yet.
-		send(mySocket, "WINNER\n", 7, 0);
-		recv(mySocket, input, sizeof(input), 0);
+		// Ask who has won, whose turn it is and for the board in a single round trip.
+		server.Queue("WINNER\n");
+		server.Queue("PLAYER\n");
+		server.Queue("BOARD\n");
+		unsigned long long pollStartTime = metrics.GetTime();
+
+		// The response to our last move comes first.
+		if(movePending)
+		{
+			movePending = false;
+			if(!ReceiveMoveResponse(server))
+			{
+				out << "Lost the connection to the server." << endl;
+				break;
+			}
+		}
+
+		input = server.Receive(inputLength);
+		if(!input)
+		{
+			out << "Lost the connection to the server." << endl;
+			break;
+		}
+		int errorCode = ParseErrorCode(input, inputLength);
+		char winner = -1;
+		if(errorCode != -1)
+		{
+			out << ErrorCodeToString((ERROR_CODE)errorCode) << endl;
+		}
+		else if(input[0] != '-')
+		{
+			winner = input[0] - '0';
+		}
 
-		int errorCode = ErrorCode(input);
+		input = server.Receive(inputLength);
+		if(!input)
+		{
+			out << "Lost the connection to the server." << endl;
+			break;
+		}
+		int nextToMove = -1;
+		errorCode = ParseErrorCode(input, inputLength);
 		if(errorCode != -1)
 		{
-			cout << ErrorCodeToString((ERROR_CODE)errorCode) << endl;
+			out << ErrorCodeToString((ERROR_CODE)errorCode) << endl;
 		}
 		else
 		{
-			char winner = ' ';
-			if(input[0] == '-')
-			{
-				winner = -1;
-			}
-			else
-			{
-				winner = input[0] - '0';
-			}
-			if(winner == -1)
-			{
-				// Check whose turn it is
-				send(mySocket, "PLAYER\n", 7, 0);
-				recv(mySocket, input, sizeof(input), 0);
+			nextToMove = input[0] - '0';
+		}
 
-				int errorCode = ErrorCode(input);
-				if(errorCode != -1)
+		input = server.Receive(inputLength);
+		if(!input)
+		{
+			out << "Lost the connection to the server." << endl;
+			break;
+		}
+		unsigned char ambos[AMBO_COUNT];
+		bool validBoard = ParseBoard(input, inputLength, ambos);
+		metrics.RecordRoundTrip(pollStartTime);
+
+		if(!gameStarted)
+		{
+			GameRecordStart record = {GAME_RECORD_START, 1, (unsigned char)player, logger.GetTime()};
+			logger.Record(&record, sizeof(record));
+			gameStarted = true;
+		}
+
+		if(winner == -1)
+		{
+			// Check if it is our (max's) turn to make a move.
+			// The opponent's move may end the game after the winner was polled, then the next poll tells the winner.
+			if(nextToMove == player && validBoard && Board(ambos).IsTerminalState() == -1) 
+			{
+				once = false;
+				// The opponent has moved, so use the time for our own search instead.
+				minimax.StopPondering();
+
+				Board currentBoard = Board(ambos);
+				// Max (us) is always assumed to be the first player.
+				// Therefore swap the board around if max is the second player.
+				if(player == 2)
+				{
+					currentBoard.Swap();
+				}
+				// Search for the best move, reusing what is known from earlier searches.
+				DWORD searchStartTime = timeGetTime();
+				int myMove = (useMcts ? mcts.Search(currentBoard) : minimax.Search(currentBoard, config.startDepth)) + 1;
+				unsigned short searchTime = (unsigned short)(timeGetTime() - searchStartTime);
+				if(useMcts)
 				{
-					cout << ErrorCodeToString((ERROR_CODE)errorCode) << endl;
+					metrics.RecordMove(searchTime, mcts.GetTimeManager().GetHardLimit(), mcts.GetNrOfPlayouts(), mcts.GetTreeDepth());
+					metrics.SetEngineMemory(0, mcts.GetMemoryUsage());
 				}
 				else
 				{
-					int nextToMove = input[0] - '0';
-
-					// Check if it is our (max's) turn to make a move.
-					if(nextToMove == player) 
-					{
-						once = false;
-
-						unsigned char ambos[AMBO_COUNT];
-						GetBoard(mySocket, ambos);
-						Board currentBoard = Board(ambos);
-						// Max (us) is always assumed to be the first player.
-						// Therefore swap the board around if max is the second player.
-						if(player == 2)
-						{
-							currentBoard.Swap();
-						}
-						Node* currentNode = new Node(currentBoard);
-						int myMove = 0;
-						unsigned char depth = config.startDepth; // Reset start depth.
-						unsigned short int timeElapsed = 0;
-						char bestUtility = SCHAR_MIN;
-
-						// Set start time for the search.
-						minimax.SetStartTime();
-						while(timeElapsed < config.timeLimit && depth < 37) //**Todo: config-variabel och/eller kommentar(motivering) 37**
-						{
-							// De-allocate memory from previous search.
-							minimax.DeAllocate(currentNode);
-							currentNode = new Node(currentBoard); // as Minimax::DeAllocate(..) deletes currentNode aswell, so recreate it.
-							// Generate and search a new game tree.
-							minimax.Generate(currentNode, depth, false, timeElapsed);
-
-							// Check child nodes of root node to select the best move.
-							for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
-							{
-								if(currentNode->children[i])
-								{
-									if(bestUtility < currentNode->children[i]->utility)
-									{
-										bestUtility = currentNode->children[i]->utility;
-										myMove = i + 1;
-									}
-								}
-							}
-
-							timeElapsed = (unsigned short int)(timeGetTime() - minimax.GetStartTime()); 
-							depth++; // Increase depth for next search.
-						}
+					metrics.RecordMove(searchTime, minimax.GetTimeManager().GetHardLimit(), minimax.GetNrOfNodes(), minimax.GetSearchDepth());
+					metrics.SetEngineMemory(0, minimax.GetPeakMemoryUsage());
+				}
 
-						// Print the current board (after the opponents move).
-						cout << endl;
-						cout << "Previous move, board: " << endl;
-						PrintBoard(mySocket);
+				// Send move command to the Kalaha server. The response is received with the next poll.
+				movePending = sendMoveCmd(server, player, myMove);
+
+				// Record and print the boards while the server handles the move. The logger does the writing.
+				GameRecordMove record = {GAME_RECORD_MOVE, 1};
+				memcpy(record.ambos, ambos, AMBO_COUNT);
+				record.amboIndex = (unsigned char)(myMove - 1);
+				record.searchTime = searchTime;
+				record.depth = useMcts ? mcts.GetTreeDepth() : minimax.GetSearchDepth();
+				record.nrOfNodes = useMcts ? mcts.GetNrOfPlayouts() : minimax.GetNrOfNodes();
+				logger.Record(&record, sizeof(record));
+
+				out << endl;
+				out << "Previous move, board: " << endl;
+				Print(out);
+				logger.PrintBoard(ambos);
+
+				// Our own move is applied locally instead of asking the server for the board again.
+				Board nextBoard = Board(ambos);
+				nextBoard.MoveSeeds(myMove - 1, player - 1);
+				out << endl;
+				out << "You have made your move, board: " << endl;
+				Print(out);
+				logger.PrintBoard(nextBoard.GetAmbos());
+
+				if(useMcts)
+				{
+					out << mcts.GetNrOfPlayouts() << " playouts, " << mcts.GetNrOfTreeNodes() << " tree nodes, depth " << (int)mcts.GetTreeDepth() << ". ";
+					out << "Expected score " << (int)(100 * mcts.GetBestMoveScore()) << "%." << endl;
+					Print(out);
+					continue;
+				}
 
-						// Send move command to the Kalaha server.
-						sendMoveCmd(mySocket, player, myMove);
+				// Keep the part of the search tree that is still relevant.
+				minimax.KeepSubtree(myMove - 1);
+				if(minimax.GetSolverResult() == SOLVER_PROVEN || minimax.IsSolvedDraw())
+				{
+					out << "Solved: " << (minimax.IsSolvedDraw() ? "at least a draw" : "win") << " (" << minimax.GetNrOfSolverNodes() << " nodes)." << endl;
+					Print(out);
+					continue;
+				}
+				unsigned int nrOfNodes = max(minimax.GetNrOfNodes(), 1U);
+				unsigned int nrOfReused = minimax.GetNrOfReusedNodes() + minimax.GetNrOfTranspositionHits();
+				out << "Searched depth " << (int)minimax.GetSearchStartDepth() << " to " << (int)minimax.GetSearchDepth() << ", " << nrOfNodes << " nodes. ";
+				if(config.gameTime > 0)
+				{
+					const TimeManager& timeManager = minimax.GetTimeManager();
+					out << "Limits " << timeManager.GetSoftLimit() << "/" << timeManager.GetHardLimit() << " ms, " << timeManager.GetRemainingTime() << " ms left. ";
+				}
+				out << "Reused " << minimax.GetNrOfReusedNodes() << " expanded nodes and " << minimax.GetNrOfTranspositionHits() << " cached results (" << (100 * (unsigned long long)nrOfReused / nrOfNodes) << "%)." << endl;
+				out << "Peak memory " << minimax.GetPeakMemoryUsage() / 1024 << " kB";
+				if(minimax.GetNrOfUnstoredNodes() > 0)
+				{
+					out << ", over the budget: " << minimax.GetNrOfUnstoredNodes() << " nodes searched without storing them";
+				}
+				out << "." << endl;
+				Print(out);
 
-						// Print again after our move.
-						cout << endl;
-						cout << "You have made your move, board: " << endl;
-						PrintBoard(mySocket);
+				// Poll again right away, it may be our turn again.
+				continue;
+			}
+			else if(nextToMove == opponent)
+			{
+				if(!once)
+				{
+					out << "Waiting for player: "  << nextToMove << endl;    
+					Print(out);
 
-						// De-allocate the memory used for the latest search.
-						minimax.DeAllocate(currentNode);
-					}
-					else
-					{    
-						if(!once)
+					if(config.ponder && validBoard && !useMcts)
+					{
+						// Search the position on the opponent's time. The results are kept in the transposition table. 
+						Board ponderBoard = Board(ambos);
+						if(player == 2)
 						{
-							ostringstream stream;   
-							stream << "Waiting for player: "  << nextToMove << endl;    
-							cout << stream.str();
-
-							once = true;
+							ponderBoard.Swap();
 						}
+						minimax.StartPondering(ponderBoard);
 					}
+
+					once = true;
 				}
+			}
 
-				// Wait a bit
-				Sleep(config.sleepTime); 
+			// Wait a bit
+			Print(out);
+			ScopedSpan span("Sleep");
+			Sleep(config.sleepTime); 
+		}
+		else
+		{
+			minimax.StopPondering();
+			out << endl;
+			out << "Final board state (and score): " << endl;
+			Print(out);
+			if(validBoard)
+			{
+				logger.PrintBoard(ambos);
 			}
-			else
+			// The scores are only known from a board that could be parsed.
+			GameRecordEnd record = {GAME_RECORD_END, 1, winner, {0, 0}, logger.GetTime()};
+			if(validBoard)
 			{
-				cout << endl;
-				cout << "Final board state (and score): " << endl;
-				PrintBoard(mySocket);
+				record.score[0] = ambos[AMBO_PLAYER_COUNT];
+				record.score[1] = ambos[AMBO_COUNT - 1];
+			}
+			logger.Record(&record, sizeof(record));
+			gameStarted = false;
 
-				string winnerStr = "";
-				if(winner == player)
-				{
-					winnerStr = "you";
-					nrOfVictories[player - 1]++; // Increment total victories for player (us).
-				}
-				else if(winner == 0) // Draw.
+			string winnerStr = "";
+			if(winner == player)
+			{
+				winnerStr = "you";
+				nrOfVictories[player - 1]++; // Increment total victories for player (us).
+			}
+			else if(winner == 0) // Draw.
+			{
+				winnerStr = "none";
+			}
+			else
+			{
+				winnerStr = "opponent";
+				nrOfVictories[opponent - 1]++; // Increment total victories for opponent.
+			}
+			out << endl;
+			out << "Player " << (int)winner << "(" << winnerStr << ") won this round!" << endl;
+			const TranspositionStats& tableStats = minimax.GetTranspositionTable().GetStats();
+			if(!useMcts && tableStats.nrOfProbes > 0)
+			{
+				unsigned long long nrOfHits = 0;
+				for(unsigned char i = 0; i < TRANSPOSITION_BUCKET_SIZE; i++)
 				{
-					winnerStr = "none";
+					nrOfHits += tableStats.nrOfHits[i];
 				}
-				else
+				out << "Transposition table" << (minimax.GetTranspositionTable().UsesLargePages() ? " (large pages)" : "") << ": " 
+					<< tableStats.nrOfProbes << " probes, " << 100 * nrOfHits / tableStats.nrOfProbes << "% hits (by way:";
+				for(unsigned char i = 0; i < TRANSPOSITION_BUCKET_SIZE; i++)
 				{
-					winnerStr = "opponent";
-					nrOfVictories[opponent - 1]++; // Increment total victories for opponent.
+					out << " " << 100 * tableStats.nrOfHits[i] / tableStats.nrOfProbes << "%";
 				}
-				cout << endl;
-				cout << "Player " << (int)winner << "(" << winnerStr << ") won this round!" << endl;
+				out << "), " << tableStats.latencyCycles / max(tableStats.nrOfLatencySamples, 1ULL) << " cycles per probe, " 
+					<< tableStats.nrOfReplacements << " replaced entries." << endl;
+			}
+			Print(out);
 
-				if(nrOfVictories[0] + nrOfVictories[1] < nrOfGamesCap) //**todo: ta bort/gra om allt till turnering**
+			if(nrOfVictories[0] + nrOfVictories[1] < nrOfGamesCap) //**todo: ta bort/gra om allt till turnering**
+			{
+				// Play again if no final victor has emerged.
+				Sleep(3000); // Wait a little before starting the next round.
+				minimax.StartGame();
+				mcts.StartGame();
+				if(!server.Request("NEW\n", inputLength))
 				{
-					// Play again if no final victor has emerged.
-					Sleep(3000); // Wait a little before starting the next round.
-					send(mySocket, "NEW\n", 4, 0);
-					recv(mySocket, input, sizeof(input), 0);
+					out << "Lost the connection to the server." << endl;
+					break;
 				}
-				else
+			}
+			else
+			{
+				// Display who won the game. 
+				string motivationalSpeech = "Congratulations! You have just won the dumbass award because ";
+				winner = (char)opponent;
+				if(nrOfVictories[player - 1] > nrOfVictories[opponent - 1]) 
 				{
-					// Display who won the game. 
-					string motivationalSpeech = "Congratulations! You have just won the dumbass award because ";
-					winner = (char)opponent;
-					if(nrOfVictories[player - 1] > nrOfVictories[opponent - 1]) 
-					{
-						// Oh you won? *Ahem* I.. uh.. I mean:
-						motivationalSpeech = "Congratulations! ";
-						winner = (char)player; 
-					}
-					cout << motivationalSpeech << "Player " << (int)winner << "(" << winnerStr << ") won the game. (By the way, you who is reading this right now just lost the game.)" << endl;
-					cout << "Problem?" << endl;
-					gameRunning = false;
+					// Oh you won? *Ahem* I.. uh.. I mean:
+					motivationalSpeech = "Congratulations! ";
+					winner = (char)player; 
 				}
+				out << motivationalSpeech << "Player " << (int)winner << "(" << winnerStr << ") won the game. (By the way, you who is reading this right now just lost the game.)" << endl;
+				out << "Problem?" << endl;
+				gameRunning = false;
 			}
 		}
 	}
+	Print(out);
 }
 
-void makeMove(int mySocket, int player) 
+void makeMove(ServerConnection& server, int player) 
 {
 	//Ask the player for his move
 	cout << "\nYou are next! make a move." << endl;
@@ -316,13 +706,16 @@ void makeMove(int mySocket, int player)
 	cin >> myMove;
 
 	//Send a move command to the Kalaha server.
-	sendMoveCmd(mySocket, player, myMove);
+	if(sendMoveCmd(server, player, myMove))
+	{
+		ReceiveMoveResponse(server);
+	}
 }
 
-void sendMoveCmd(int mySocket, int player, int myMove) 
+bool sendMoveCmd(ServerConnection& server, int player, int myMove) 
 {
-	char input[43];
-	char output[9];
+	ScopedSpan span("Send move");
+	char output[10];
 
 	//Generate the command string
 	output[0] = 'M';
@@ -334,79 +727,69 @@ void sendMoveCmd(int mySocket, int player, int myMove)
 	output[6] = ' ';
 	output[7] = (char)player + '0';
 	output[8] = '\n';
+	output[9] = '\0';
 	
 	//Send the command
-	send(mySocket, output, sizeof(output), 0);
-	recv(mySocket, input, sizeof(input), 0);
-
-	int errorCode = ErrorCode(input);
-	if(errorCode != -1)
-	{
-		cout << ErrorCodeToString((ERROR_CODE)ErrorCode(input)) << endl;
-	}
+	return server.Queue(output) && server.Flush();
 }
 
-string makeBoardStr(char input[]) 
+bool ReceiveMoveResponse(ServerConnection& server)
 {
-	//Convert the board datastructure to a vector of ; separated tokens.
-	vector<string> myBoard;
-	tokenizeBoard(input, myBoard);
-
-	//Generate a nice output of the board.
-	string out = "\n[2]";
-
-	for(int i = AMBO_COUNT - 1; i > AMBO_PLAYER_COUNT + 1; i--)
+	ScopedSpan span("Receive move response");
+	unsigned short inputLength = 0;
+	const char* input = server.Receive(inputLength);
+	if(!input)
 	{
-		out += makeSpaces(myBoard.at(i));
+		return false;
 	}
 
-	out += "\n" + makeSpaces(myBoard.at(0)) + "                  " + makeSpaces(myBoard.at(7)) + "\n" + "[1]";
-
-	for(int i = 1; i < AMBO_PLAYER_COUNT + 1; i++)
+	int errorCode = ParseErrorCode(input, inputLength);
+	if(errorCode != -1)
 	{
-		out += makeSpaces(myBoard.at(i));
+		logger.Print(ErrorCodeToString((ERROR_CODE)errorCode) + "\n");
 	}
-
-	return out;
+	return true;
 }
 
-string makeSpaces(string str) 
+void SetDefaultConfig()
 {
-	string res = "";
-
-	//Formats a number (0-99) to a nice string.
-	if(str.length() == 2) 
-	{
-		res = " " + str;
-	}
-	else if(str.length() == 1) 
-	{
-		res = "  " + str;
-	}
-	else 
-	{
-		res = str;
-	}
-
-	return res;
+	config.port = 8888;
+	config.address = "127.0.0.1";
+	config.startDepth = 8;
+	config.sleepTime = 100;
+	config.timeLimit = 3000;
+	config.gameTime = 0;
+	config.nrOfGames = 2;
+	config.expandExtraTurns = false;
+	config.quiescenceDepth = 4;
+	config.transpositionTableSize = 16;
+	config.ponder = true;
+	config.nrOfConnections = 1;
+	config.nrOfSearchThreads = 0;
+	config.recordGames = true;
+	config.engine = ENGINE_MINIMAX;
+	config.playoutPolicy = MCTS_PLAYOUT_HEURISTIC;
+	config.solverTableSize = 16;
+	config.selectiveSearch = SELECTIVE_ALL;
+	config.weightsFile = EVALUATION_WEIGHTS_FILE_NAME;
+	config.metricsPort = 0;
+	config.traceSpans = false;
+	config.memoryBudget = 512;
 }
 
-void tokenizeBoard(char input[], vector<string> &tokens) 
+bool ReadConfigValue(ifstream& in, char* input, int size)
 {
-	//Converts a board datastructure to a vector of ; separated tokens.
-	char sep[] = ";";
-	char *token;
-	token = strtok(input, sep);
-
-	while (token != NULL) 
+	// Skip comments and empty lines.
+	do
 	{
-		tokens.push_back(token);
-		token = strtok(NULL, sep);
-	}
-}
-
-
+		if(!in.getline(input, size))
+		{
+			return false;
+		}
+	} while(input[0] == '#' || input[0] == '\0');
 
+	return true;
+}
 
 bool ReadConfigFile(const char* fileName)
 {
@@ -415,173 +798,167 @@ bool ReadConfigFile(const char* fileName)
 	char input[256];
 	if(in)
 	{
+		// Values missing at the end of the file keep their default values.
 		// Port number.
-		in.getline(input, sizeof(input));
-		while(input[0] == '#' || input[0] == '\0')
+		if(ReadConfigValue(in, input, sizeof(input)))
 		{
-			in.getline(input, sizeof(input));
+			config.port = atoi(input);
 		}
-		config.port = atoi(input);
 
 		// IP-address.
-		in.getline(input, sizeof(input));
-		while(input[0] == '#' || input[0] == '\0')
+		if(ReadConfigValue(in, input, sizeof(input)))
 		{
-			in.getline(input, sizeof(input));
+			config.address = input;
 		}
-		config.address = input;
 
 		// Start depth of search.
-		in.getline(input, sizeof(input));
-		while(input[0] == '#' || input[0] == '\0')
+		if(ReadConfigValue(in, input, sizeof(input)))
 		{
-			in.getline(input, sizeof(input));
+			config.startDepth = (unsigned char)atoi(input);
 		}
-		config.startDepth = (unsigned char)atoi(input);
 
 		// Sleep time (update frequency) in milliseconds.
-		in.getline(input, sizeof(input));
-		while(input[0] == '#' || input[0] == '\0')
+		if(ReadConfigValue(in, input, sizeof(input)))
 		{
-			in.getline(input, sizeof(input));
+			config.sleepTime = atoi(input);
 		}
-		config.sleepTime = atoi(input);
 
 		// Time limit of search in milliseconds.
-		in.getline(input, sizeof(input));
-		while(input[0] == '#' || input[0] == '\0')
+		if(ReadConfigValue(in, input, sizeof(input)))
 		{
-			in.getline(input, sizeof(input));
+			config.timeLimit = (unsigned short int)atoi(input);
 		}
-		config.timeLimit = (unsigned short int)atoi(input);
 
 		// Number of games to play.
-		in.getline(input, sizeof(input));
-		while(input[0] == '#' || input[0] == '\0')
+		if(ReadConfigValue(in, input, sizeof(input)))
 		{
-			in.getline(input, sizeof(input));
+			config.nrOfGames = (unsigned int)atoi(input);
 		}
-		config.nrOfGames = (unsigned int)atoi(input);
 
-		in.close();
-		return true;
-	}
-	else
-	{
-		in.close();
-		return false;
-	}
-}
+		// Search extra-turn chains as one move.
+		if(ReadConfigValue(in, input, sizeof(input)))
+		{
+			config.expandExtraTurns = atoi(input) != 0;
+		}
 
-void GetBoard(int socket, unsigned char* ambos)
-{
-	// Ask server for current board.
-	char input[43];
-	send(socket, "BOARD\n", 6, 0);
-	recv(socket, input, sizeof(input), 0);
+		// Quiescence search depth.
+		if(ReadConfigValue(in, input, sizeof(input)))
+		{
+			config.quiescenceDepth = (unsigned char)atoi(input);
+		}
 
-	string tmpStr = input;
-	unsigned char amboIndex = 0;
-	unsigned char stringStartIndex = 0;
-	// Get the number of seeds in player 2's kalah.
-	while(input[stringStartIndex] != ';')
-	{
-		stringStartIndex++;
-		if(input[stringStartIndex] == ';')
+		// Transposition table size in megabytes.
+		if(ReadConfigValue(in, input, sizeof(input)))
 		{
-			ambos[AMBO_COUNT - 1] = (unsigned char)atoi(tmpStr.substr(0, stringStartIndex).c_str());
+			config.transpositionTableSize = (unsigned int)atoi(input);
 		}
-	}
-	// Get the rest.
-	stringStartIndex++;
-	for(unsigned char i = stringStartIndex; i < 43; i++)
-	{
-		if(input[i] == ';')
+
+		// Pondering.
+		if(ReadConfigValue(in, input, sizeof(input)))
 		{
-			ambos[amboIndex++] = (unsigned char)atoi(tmpStr.substr(stringStartIndex, i - stringStartIndex).c_str());
-			stringStartIndex = i + 1;
+			config.ponder = atoi(input) != 0;
 		}
-	}
-}
 
-void PrintBoard(int socket)
-{
-	char input[43];
+		// Number of games played at the same time.
+		if(ReadConfigValue(in, input, sizeof(input)))
+		{
+			config.nrOfConnections = (unsigned int)atoi(input);
+		}
+
+		// Number of search threads.
+		if(ReadConfigValue(in, input, sizeof(input)))
+		{
+			config.nrOfSearchThreads = (unsigned int)atoi(input);
+		}
+
+		// Time for all our moves of a game in milliseconds.
+		if(ReadConfigValue(in, input, sizeof(input)))
+		{
+			config.gameTime = (unsigned int)atoi(input);
+		}
+
+		// Game recording.
+		if(ReadConfigValue(in, input, sizeof(input)))
+		{
+			config.recordGames = atoi(input) != 0;
+		}
+
+		// Search engine.
+		if(ReadConfigValue(in, input, sizeof(input)))
+		{
+			config.engine = (unsigned char)atoi(input);
+		}
+
+		// Playouts of the Monte Carlo tree search.
+		if(ReadConfigValue(in, input, sizeof(input)))
+		{
+			config.playoutPolicy = (unsigned char)atoi(input);
+		}
 
-	//Ask for current board
-	send(socket, "BOARD\n", 6, 0);
-	recv(socket, input, sizeof(input), 0);
+		// Size of the endgame solver table.
+		if(ReadConfigValue(in, input, sizeof(input)))
+		{
+			config.solverTableSize = (unsigned int)atoi(input);
+		}
+
+		// Selective search techniques.
+		if(ReadConfigValue(in, input, sizeof(input)))
+		{
+			config.selectiveSearch = (unsigned char)atoi(input);
+		}
+
+		// Evaluation weights file.
+		if(ReadConfigValue(in, input, sizeof(input)))
+		{
+			config.weightsFile = input;
+		}
+
+		// Port of the metrics endpoint.
+		if(ReadConfigValue(in, input, sizeof(input)))
+		{
+			config.metricsPort = (unsigned short)atoi(input);
+		}
 
-	//Convert the received board data structure to a printable string
-	string out = makeBoardStr(input);
+		// Record trace spans.
+		if(ReadConfigValue(in, input, sizeof(input)))
+		{
+			config.traceSpans = atoi(input) != 0;
+		}
 
-	//Print the board
-	cout << out << endl;
+		// Memory budget.
+		if(ReadConfigValue(in, input, sizeof(input)))
+		{
+			config.memoryBudget = (unsigned int)atoi(input);
+		}
+
+		in.close();
+		return true;
+	}
+	else
+	{
+		in.close();
+		return false;
+	}
 }
 
-string ErrorCodeToString(ERROR_CODE errorCode)
+void Print(ostringstream& stream)
 {
-	switch (errorCode)
-	{
-		case ERROR_GAME_FULL: 
-			return "Can't connect to server: Game is full."; 
-		break;
-		case ERROR_GAME_NOT_FULL: 
-			return "Can't make a move: Only one client connected."; 
-		break;
-		case ERROR_ARGLENGTH_NOT_VALID: 
-			return "Invalid command format. Too few or too many arguments."; 
-		break;
-		case ERROR_ARGTYPE_NOT_VALID: 
-			return "Invalid command format. Usually caused by expecting an integer but received a string."; 
-		break;
-		case ERROR_PLAYER_OUT_OF_TURN:
-			return "Not your turn!"; 
-		break;
-		case ERROR_CMD_NOT_FOUND:
-			return "Unknown command."; 
-		break;
-		case ERROR_AMBO_EMPTY: 
-			return "Can't make a move from an empty ambo!"; 
-		break;
-		default: return "Unknown. Maybe the server is dead."; break;
-	}
+	logger.Print(stream.str());
+	stream.str("");
 }
 
-int ErrorCode(char input[])
+void WriteSpans()
 {
-	string tmp = input;
-	
-	if(tmp.find("ERROR GAME_FULL") != -1)
-	{
-		return ERROR_GAME_FULL;
-	}
-	else if(tmp.find("ERROR GAME_NOT_FULL") != -1)
-	{
-		return ERROR_GAME_NOT_FULL;
-	}
-	else if(tmp.find("ERROR ARGLENGTH_NOT_VALID") != -1)
-	{
-		return ERROR_ARGLENGTH_NOT_VALID;
-	}
-	else if(tmp.find("ERROR ARGTYPE_NOT_VALID") != -1)
-	{
-		return ERROR_ARGTYPE_NOT_VALID;
-	}
-	else if(tmp.find("ERROR PLAYER_OUT_OF_TURN") != -1)
-	{
-		return ERROR_PLAYER_OUT_OF_TURN;
-	}
-	else if(tmp.find("ERROR CMD_NOT_FOUND") != -1)
+	if(!config.traceSpans)
 	{
-		return ERROR_CMD_NOT_FOUND;
+		return;
 	}
-	else if(tmp.find("ERROR AMBO_EMPTY") != -1)
+	if(SpanTracer::Write(SPAN_TRACE_FILE_NAME))
 	{
-		return ERROR_AMBO_EMPTY;
+		cout << "Wrote the trace spans to " << SPAN_TRACE_FILE_NAME << endl;
 	}
 	else
 	{
-		return -1;
+		cout << "Failed to write " << SPAN_TRACE_FILE_NAME << endl;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "Logger.h"
+#include "SpanTrace.h"
+
+#include <time.h>
+#include <string.h>
+#include <limits.h>
+
+// Each entry in the buffer: type (1 byte), size (2 bytes), data.
+static const unsigned int LOG_ENTRY_HEADER_SIZE = 3;
+
+Logger::Logger()
+{
+	this->head = 0;
+	this->tail = 0;
+	this->nrOfDroppedEntries = 0;
+	this->running = false;
+	this->startTime = timeGetTime();
+}
+
+Logger::~Logger()
+{
+	this->Stop();
+}
+
+bool Logger::Start(const char* recordFileName)
+{
+	this->startTime = timeGetTime();
+	if(recordFileName)
+	{
+		this->recordFile.open(recordFileName, ios::out | ios::binary | ios::app);
+		if(!this->recordFile)
+		{
+			return false;
+		}
+		GameRecordFile record;
+		record.type = GAME_RECORD_FILE;
+		memcpy(record.magic, GAME_RECORD_MAGIC, sizeof(GAME_RECORD_MAGIC));
+		record.version = GAME_RECORD_VERSION;
+		record.time = (unsigned int)time(nullptr);
+		this->Record(&record, sizeof(record));
+	}
+	this->running = true;
+	this->writerThread = std::thread(&Logger::Write, this);
+	return true;
+}
+
+void Logger::Stop()
+{
+	if(this->writerThread.joinable())
+	{
+		this->running = false;
+		this->writerThread.join();
+	}
+	if(this->recordFile.is_open())
+	{
+		this->recordFile.close();
+	}
+}
+
+bool Logger::Log(LOG_ENTRY_TYPE type, const void* data, unsigned short size)
+{
+	unsigned int head = this->head.load(std::memory_order_relaxed);
+	unsigned int tail = this->tail.load(std::memory_order_acquire);
+	if(LOG_BUFFER_SIZE - (head - tail) < LOG_ENTRY_HEADER_SIZE + size)
+	{
+		this->nrOfDroppedEntries++;
+		return false;
+	}
+
+	unsigned char header[LOG_ENTRY_HEADER_SIZE] = {(unsigned char)type, (unsigned char)(size & 0xFF), (unsigned char)(size >> 8)};
+	this->Copy(head, header, LOG_ENTRY_HEADER_SIZE);
+	this->Copy(head + LOG_ENTRY_HEADER_SIZE, data, size);
+	// Publish the entry after its bytes.
+	this->head.store(head + LOG_ENTRY_HEADER_SIZE + size, std::memory_order_release);
+	return true;
+}
+
+void Logger::Copy(unsigned int position, const void* data, unsigned int size)
+{
+	unsigned int index = position & (LOG_BUFFER_SIZE - 1);
+	unsigned int firstPart = min(size, LOG_BUFFER_SIZE - index);
+	memcpy(this->buffer + index, data, firstPart);
+	memcpy(this->buffer, (const char*)data + firstPart, size - firstPart);
+}
+
+void Logger::CopyOut(unsigned int position, void* data, unsigned int size) const
+{
+	unsigned int index = position & (LOG_BUFFER_SIZE - 1);
+	unsigned int firstPart = min(size, LOG_BUFFER_SIZE - index);
+	memcpy(data, this->buffer + index, firstPart);
+	memcpy((char*)data + firstPart, this->buffer, size - firstPart);
+}
+
+bool Logger::HandleEntries()
+{
+	unsigned int tail = this->tail.load(std::memory_order_relaxed);
+	unsigned int head = this->head.load(std::memory_order_acquire);
+	if(tail == head)
+	{
+		return false;
+	}
+
+	ScopedSpan span("Print");
+	char data[USHRT_MAX + 1];
+	while(tail != head)
+	{
+		unsigned char header[LOG_ENTRY_HEADER_SIZE];
+		this->CopyOut(tail, header, LOG_ENTRY_HEADER_SIZE);
+		unsigned short size = header[1] | (header[2] << 8);
+		this->CopyOut(tail + LOG_ENTRY_HEADER_SIZE, data, size);
+		tail += LOG_ENTRY_HEADER_SIZE + size;
+		// Give the space back before the (slow) output.
+		this->tail.store(tail, std::memory_order_release);
+
+		switch(header[0])
+		{
+			case LOG_ENTRY_TEXT:
+				cout.write(data, size);
+			break;
+			case LOG_ENTRY_BOARD:
+				cout << makeBoardStr((const unsigned char*)data) << '\n';
+			break;
+			case LOG_ENTRY_RECORD:
+				if(this->recordFile.is_open())
+				{
+					this->recordFile.write(data, size);
+				}
+			break;
+		}
+	}
+
+	// Flush once per batch instead of once per line.
+	cout.flush();
+	if(this->recordFile.is_open())
+	{
+		this->recordFile.flush();
+	}
+	return true;
+}
+
+void Logger::Write()
+{
+	SpanTracer::NameThread("Logger");
+	while(this->running)
+	{
+		if(!this->HandleEntries())
+		{
+			Sleep(LOG_WRITER_SLEEP_TIME);
+		}
+	}
+	// Write what was logged before Stop() was called.
+	this->HandleEntries();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "GameRecord.h"
+#include <Windows.h>
+#include <atomic>
+#include <thread>
+#include <fstream>
+
+static const unsigned int LOG_BUFFER_SIZE = 1 << 16; // Bytes, a power of 2.
+static const DWORD LOG_WRITER_SLEEP_TIME = 5; // Milliseconds the writer sleeps when there is nothing to write.
+
+enum LOG_ENTRY_TYPE
+{
+	LOG_ENTRY_TEXT		= 0, // Printed as it is.
+	LOG_ENTRY_BOARD		= 1, // The ambos of a board, printed by makeBoardStr(...).
+	LOG_ENTRY_RECORD	= 2  // A game record (see GameRecord.h), written to the record file.
+};
+
+/*
+	Moves console output and game recording off the thread playing the game.
+	Entries are copied into a lock-free ring buffer, and a writer thread prints and writes them.
+	Only one thread may write to the logger. If the buffer is full, the entry is dropped (and counted).
+*/
+class Logger
+{
+	private:
+		char buffer[LOG_BUFFER_SIZE];
+		std::atomic<unsigned int> head; // Written by the producer: the end of the last complete entry.
+		std::atomic<unsigned int> tail; // Written by the writer: the start of the first entry not yet handled.
+		std::atomic<unsigned int> nrOfDroppedEntries;
+		std::atomic<bool> running;
+		std::thread writerThread;
+		ofstream recordFile;
+		DWORD startTime;
+
+		void Write();
+		void Copy(unsigned int position, const void* data, unsigned int size);
+		void CopyOut(unsigned int position, void* data, unsigned int size) const;
+		/*
+			Handles all complete entries in the buffer. Returns false if there were none.
+		*/
+		bool HandleEntries();
+
+	public:
+		Logger();
+		virtual ~Logger();
+
+		/*
+			Starts the writer thread. Game records are appended to the given file, nullptr disables recording.
+		*/
+		bool Start(const char* recordFileName);
+		/*
+			Writes what is left in the buffer and stops the writer thread.
+		*/
+		void Stop();
+
+		/*
+			Returns false if the entry was dropped.
+		*/
+		bool Log(LOG_ENTRY_TYPE type, const void* data, unsigned short size);
+		bool Print(const string& text) { return this->Log(LOG_ENTRY_TEXT, text.c_str(), (unsigned short)text.size()); }
+		bool PrintBoard(const unsigned char ambos[AMBO_COUNT]) { return this->Log(LOG_ENTRY_BOARD, ambos, AMBO_COUNT); }
+		bool Record(const void* record, unsigned short size) { return this->Log(LOG_ENTRY_RECORD, record, size); }
+
+		/*
+			Returns the milliseconds since the logger was started, for the time stamps of the records.
+		*/
+		unsigned int GetTime() const { return timeGetTime() - this->startTime; }
+		unsigned int GetNrOfDroppedEntries() const { return this->nrOfDroppedEntries; }
+};
@@ -0,0 +1,309 @@
+#include "Mcts.h"
+#include "SpanTrace.h"
+
+#include <math.h>
+
+// A fast random number generator (xorshift), one state per thread.
+static unsigned int NextRandom(unsigned int& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+// Returns the index of a random set bit of the (non-zero) bits.
+static unsigned char RandomBit(unsigned char bits, unsigned int& random)
+{
+	unsigned char nrOfBits = 0;
+	for(unsigned char b = bits; b; b &= b - 1)
+	{
+		nrOfBits++;
+	}
+	unsigned char n = NextRandom(random) % nrOfBits;
+	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+	{
+		if((bits & (1 << i)) && n-- == 0)
+		{
+			return i;
+		}
+	}
+	return 0;
+}
+
+Mcts::Mcts()
+{
+	this->nodes = nullptr;
+	this->nrOfNodes = 0;
+	this->nrOfUsedNodes = 0;
+	this->nrOfThreads = 0;
+	this->playoutPolicy = MCTS_PLAYOUT_HEURISTIC;
+	this->startTime = 0;
+	this->timeLimitMS = 0;
+	this->stopSearch = false;
+	this->nrOfPlayouts = 0;
+	this->treeDepth = 0;
+	this->bestMove = -1;
+}
+
+Mcts::~Mcts()
+{
+	if(this->nodes)
+	{
+		delete[] this->nodes;
+		this->nodes = nullptr;
+	}
+}
+
+float Mcts::GetBestMoveScore() const
+{
+	if(this->bestMove == -1)
+	{
+		return 0.0f;
+	}
+	const MctsNode& root = this->nodes[0];
+	for(unsigned char i = 0; i < root.nrOfChildren; i++)
+	{
+		const MctsNode& child = this->nodes[root.firstChild + i];
+		if(child.amboIndex == this->bestMove && child.nrOfVisits > 0)
+		{
+			return child.score / (2.0f * child.nrOfVisits);
+		}
+	}
+	return 0.0f;
+}
+
+void Mcts::Expand(MctsNode& node, const Board& board)
+{
+	unsigned char expected = MCTS_NODE_LEAF;
+	if(!node.state.compare_exchange_strong(expected, MCTS_NODE_EXPANDING))
+	{
+		return; // Another thread is expanding the node.
+	}
+
+	unsigned char nonEmptyAmbos = ~board.GetEmptyAmbos(node.minTurn) & ((1 << AMBO_PLAYER_COUNT) - 1);
+	unsigned char nrOfChildren = 0;
+	for(unsigned char b = nonEmptyAmbos; b; b &= b - 1)
+	{
+		nrOfChildren++;
+	}
+	unsigned int firstChild = this->nrOfUsedNodes.fetch_add(nrOfChildren);
+	if(firstChild + nrOfChildren > this->nrOfNodes)
+	{
+		// The pool is full, the node stays a leaf.
+		node.state = MCTS_NODE_LEAF;
+		return;
+	}
+
+	MctsNode* child = this->nodes + firstChild;
+	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+	{
+		if(!(nonEmptyAmbos & (1 << i)))
+		{
+			continue;
+		}
+		Board childBoard = board;
+		MoveOutcome outcome = childBoard.MoveSeeds(i, node.minTurn);
+		child->nrOfVisits = 0;
+		child->score = 0;
+		child->firstChild = 0;
+		child->state = MCTS_NODE_LEAF;
+		child->nrOfChildren = 0;
+		child->amboIndex = i;
+		// The player keeps the turn after an extra turn.
+		child->minTurn = (outcome.extraTurn && !outcome.terminal) ? node.minTurn : !node.minTurn;
+		child++;
+	}
+	node.firstChild = firstChild;
+	node.nrOfChildren = nrOfChildren;
+	// Publish the children after they have been written.
+	node.state.store(MCTS_NODE_EXPANDED, std::memory_order_release);
+}
+
+unsigned int Mcts::Select(const MctsNode& node) const
+{
+	float logVisits = logf((float)max((unsigned int)node.nrOfVisits, 1U));
+	unsigned int best = node.firstChild;
+	float bestValue = -1.0f;
+	for(unsigned int i = node.firstChild; i < node.firstChild + node.nrOfChildren; i++)
+	{
+		const MctsNode& child = this->nodes[i];
+		unsigned int nrOfVisits = child.nrOfVisits;
+		if(nrOfVisits == 0)
+		{
+			return i; // Every move is tried once before any is tried again.
+		}
+		// The mean result of the move plus a bonus for moves that have been tried few times.
+		float value = child.score / (2.0f * nrOfVisits) + MCTS_EXPLORATION_CONSTANT * sqrtf(logVisits / nrOfVisits);
+		if(value > bestValue)
+		{
+			bestValue = value;
+			best = i;
+		}
+	}
+	return best;
+}
+
+unsigned char Mcts::Playout(Board& board, bool minTurn, unsigned int& random) const
+{
+	while(true)
+	{
+		// The kalahs are never emptied, so more than half of the seeds wins.
+		if(board.GetNrOfSeedsInKalah(0) >= MCTS_SEEDS_TO_WIN)
+		{
+			return 0;
+		}
+		if(board.GetNrOfSeedsInKalah(1) >= MCTS_SEEDS_TO_WIN)
+		{
+			return 1;
+		}
+		if(board.IsTerminalState() != -1)
+		{
+			return board.GetNrOfSeedsInKalah(0) > board.GetNrOfSeedsInKalah(1) ? 0 : (board.GetNrOfSeedsInKalah(0) < board.GetNrOfSeedsInKalah(1) ? 1 : 2);
+		}
+
+		unsigned char amboIndex;
+		unsigned char extraTurnAmbos = board.GetExtraTurnAmbos(minTurn);
+		if(this->playoutPolicy == MCTS_PLAYOUT_HEURISTIC && extraTurnAmbos)
+		{
+			// Take the extra turn closest to the kalah first, it doesn't change the other ambos giving extra turns.
+			amboIndex = AMBO_PLAYER_COUNT - 1;
+			while(!(extraTurnAmbos & (1 << amboIndex)))
+			{
+				amboIndex--;
+			}
+		}
+		else
+		{
+			amboIndex = RandomBit(~board.GetEmptyAmbos(minTurn) & ((1 << AMBO_PLAYER_COUNT) - 1), random);
+		}
+
+		MoveOutcome outcome = board.MoveSeeds(amboIndex, minTurn);
+		if(!outcome.extraTurn)
+		{
+			minTurn = !minTurn;
+		}
+	}
+}
+
+void Mcts::Work(unsigned int seed)
+{
+	unsigned int random = seed * 2654435761U + 1;
+	unsigned int path[MCTS_MAX_TREE_DEPTH + 1];
+	unsigned char movers[MCTS_MAX_TREE_DEPTH + 1]; // The player who made the move to the node of the path.
+	unsigned int nrOfPlayouts = 0;
+	while(!this->stopSearch)
+	{
+		// Selection: follow the UCT values down to a leaf, counting the visits on the way (virtual loss).
+		Board board = this->rootBoard;
+		unsigned char depth = 0;
+		unsigned int index = 0;
+		this->nodes[0].nrOfVisits++;
+		while(true)
+		{
+			MctsNode& node = this->nodes[index];
+			if(node.state.load(std::memory_order_acquire) != MCTS_NODE_EXPANDED)
+			{
+				// Expansion: add the children of a leaf that has been visited enough, then select one of them.
+				if(node.nrOfVisits < MCTS_EXPANSION_VISITS || depth >= MCTS_MAX_TREE_DEPTH || board.IsTerminalState() != -1)
+				{
+					break;
+				}
+				this->Expand(node, board);
+				if(node.state.load(std::memory_order_acquire) != MCTS_NODE_EXPANDED)
+				{
+					break;
+				}
+			}
+			if(node.nrOfChildren == 0)
+			{
+				break;
+			}
+			unsigned int child = this->Select(node);
+			this->nodes[child].nrOfVisits++;
+			movers[depth] = node.minTurn;
+			board.MoveSeeds(this->nodes[child].amboIndex, node.minTurn);
+			path[depth++] = child;
+			index = child;
+		}
+
+		// Simulation.
+		unsigned char winner = this->Playout(board, this->nodes[index].minTurn, random);
+
+		// Backpropagation: the visits have already been counted, add the points.
+		for(unsigned char i = 0; i < depth; i++)
+		{
+			this->nodes[path[i]].score += winner == 2 ? 1 : (winner == movers[i] ? 2 : 0);
+		}
+		if(depth > this->treeDepth)
+		{
+			this->treeDepth = depth;
+		}
+
+		nrOfPlayouts++;
+		if(nrOfPlayouts % MCTS_TIME_CHECK_INTERVAL == 0 && timeGetTime() - this->startTime >= this->timeLimitMS)
+		{
+			this->stopSearch = true;
+		}
+	}
+	this->nrOfPlayouts += nrOfPlayouts;
+}
+
+char Mcts::Search(const Board& board, TimeManager& timeManager)
+{
+	ScopedSpan span("Search");
+	this->startTime = timeGetTime();
+	timeManager.StartMove(board);
+	this->timeLimitMS = timeManager.GetSoftLimit();
+	if(!this->nodes)
+	{
+		this->nrOfNodes = MCTS_TREE_SIZE_MB * 1024 * 1024 / sizeof(MctsNode);
+		this->nodes = new MctsNode[this->nrOfNodes];
+	}
+
+	// A new tree for every search.
+	this->rootBoard = board;
+	MctsNode& root = this->nodes[0];
+	root.nrOfVisits = 0;
+	root.score = 0;
+	root.state = MCTS_NODE_LEAF;
+	root.nrOfChildren = 0;
+	root.amboIndex = 0;
+	root.minTurn = false;
+	this->nrOfUsedNodes = 1;
+	this->nrOfPlayouts = 0;
+	this->treeDepth = 0;
+	this->Expand(root, board);
+	this->bestMove = -1;
+
+	// Only search if there is a choice.
+	if(root.nrOfChildren > 1)
+	{
+		this->stopSearch = false;
+		unsigned int nrOfThreads = this->nrOfThreads > 0 ? this->nrOfThreads : max(std::thread::hardware_concurrency(), 1U);
+		std::vector<std::thread> threads;
+		for(unsigned int i = 1; i < nrOfThreads; i++)
+		{
+			threads.push_back(std::thread(&Mcts::Work, this, i + this->startTime));
+		}
+		this->Work(this->startTime);
+		for(unsigned int i = 0; i < threads.size(); i++)
+		{
+			threads[i].join();
+		}
+	}
+
+	// The most visited move is the most reliable one.
+	unsigned int maxNrOfVisits = 0;
+	for(unsigned char i = 0; i < root.nrOfChildren; i++)
+	{
+		const MctsNode& child = this->nodes[root.firstChild + i];
+		if(this->bestMove == -1 || child.nrOfVisits > maxNrOfVisits)
+		{
+			maxNrOfVisits = child.nrOfVisits;
+			this->bestMove = child.amboIndex;
+		}
+	}
+	timeManager.EndMove(timeGetTime() - this->startTime);
+	return this->bestMove;
+}
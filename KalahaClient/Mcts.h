@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Board.h"
+#include "TimeManager.h"
+#include <Windows.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static const unsigned int MCTS_TREE_SIZE_MB = 64; // Memory of the node pool, allocated by the first search.
+static const float MCTS_EXPLORATION_CONSTANT = 0.5f; // C of the UCT formula, the rewards are in [0, 1].
+static const unsigned int MCTS_EXPANSION_VISITS = 2; // Visits of a leaf before its children are added to the tree.
+static const unsigned int MCTS_TIME_CHECK_INTERVAL = 64; // Playouts between checks of the time.
+static const unsigned char MCTS_MAX_TREE_DEPTH = 128; // Moves from the root, deeper leaves are not expanded.
+static const unsigned char MCTS_SEEDS_TO_WIN = AMBO_SEED_COUNT * AMBO_PLAYER_COUNT + 1; // More than half of the seeds decides the game.
+
+enum MCTS_PLAYOUT_POLICY
+{
+	MCTS_PLAYOUT_RANDOM		= 0, // Uniformly random moves.
+	MCTS_PLAYOUT_HEURISTIC	= 1  // Extra turns first (the ambo closest to the kalah), else random moves.
+};
+
+enum MCTS_NODE_STATE
+{
+	MCTS_NODE_LEAF		= 0,
+	MCTS_NODE_EXPANDING	= 1, // A thread is adding the children.
+	MCTS_NODE_EXPANDED	= 2
+};
+
+/*
+	A node of the search tree, 16 bytes. The children of a node are stored next to each other in the pool.
+*/
+struct MctsNode
+{
+	std::atomic<unsigned int>	nrOfVisits;		// Includes the playouts still running through the node (virtual loss).
+	std::atomic<unsigned int>	score;			// Half points of the player who made the move to the node: 2 per win, 1 per draw.
+	unsigned int				firstChild;		// Index of the first child in the pool, valid when the node is expanded.
+	std::atomic<unsigned char>	state;			// One of MCTS_NODE_STATE.
+	unsigned char				nrOfChildren;	// 0 in a terminal position.
+	unsigned char				amboIndex;		// The move leading to the node.
+	bool						minTurn;		// Whose turn it is in the node.
+};
+
+/*
+	Monte Carlo Tree Search (UCT), an alternative to Minimax which needs no evaluation function:
+	positions are valued by the results of fast playouts to the end of the game.
+	Several threads search the same tree (tree parallelism). A thread counts its visit of a node before the playout is done,
+	which is a virtual loss that makes the other threads prefer other paths until the result is added.
+*/
+class Mcts
+{
+	private:
+		MctsNode* nodes;
+		unsigned int nrOfNodes; // The size of the pool.
+		std::atomic<unsigned int> nrOfUsedNodes;
+		Board rootBoard;
+		unsigned int nrOfThreads; // 0 = one per core.
+		MCTS_PLAYOUT_POLICY playoutPolicy;
+		TimeManager timeManager; // Used by Search(...) when no other time manager is given.
+		DWORD startTime;
+		unsigned short timeLimitMS;
+		std::atomic<bool> stopSearch;
+		// Statistics of the latest search.
+		std::atomic<unsigned int> nrOfPlayouts;
+		std::atomic<unsigned char> treeDepth;
+		char bestMove;
+
+	private:
+		/*
+			Playouts from the root until the time is up. Run by every search thread.
+		*/
+		void Work(unsigned int seed);
+		/*
+			Adds the children of a leaf, unless another thread is already doing it or the pool is full.
+		*/
+		void Expand(MctsNode& node, const Board& board);
+		/*
+			Returns the index of the child with the highest UCT value.
+		*/
+		unsigned int Select(const MctsNode& node) const;
+		/*
+			Plays the game to the end with the playout policy.
+			Returns 0 if max wins, 1 if min wins and 2 for a draw.
+		*/
+		unsigned char Playout(Board& board, bool minTurn, unsigned int& random) const;
+
+	public:
+		Mcts();
+		virtual~Mcts();
+
+		void SetTimeLimit(short int timeLimit) { this->timeManager.SetMoveTime(timeLimit); }
+		void SetGameTime(unsigned int gameTimeMS) { this->timeManager.SetGameTime(gameTimeMS); }
+		void StartGame() { this->timeManager.StartGame(); }
+		const TimeManager& GetTimeManager() const { return this->timeManager; }
+		void SetNrOfThreads(unsigned int nrOfThreads) { this->nrOfThreads = nrOfThreads; }
+		void SetPlayoutPolicy(MCTS_PLAYOUT_POLICY playoutPolicy) { this->playoutPolicy = playoutPolicy; }
+		unsigned int GetNrOfPlayouts() const { return this->nrOfPlayouts; }
+		unsigned int GetNrOfTreeNodes() const { return min((unsigned int)this->nrOfUsedNodes, this->nrOfNodes); }
+		unsigned char GetTreeDepth() const { return this->treeDepth; }
+		unsigned long long GetMemoryUsage() const { return (unsigned long long)this->nrOfNodes * sizeof(MctsNode); }
+		/*
+			Returns the share (0-1) of the playouts through the best move of the latest search that max won (draws count half).
+		*/
+		float GetBestMoveScore() const;
+		/*
+			Selects a move for max (us): searches until the soft limit of the time manager and
+			returns the index of the most visited move of the root.
+		*/
+		char Search(const Board& board, TimeManager& timeManager);
+		char Search(const Board& board) { return this->Search(board, this->timeManager); }
+};
@@ -0,0 +1,273 @@
+#include "Metrics.h"
+
+#include <winsock.h>
+#include <sstream>
+#include <string.h>
+
+MetricsHistogram::MetricsHistogram(const unsigned int* bounds, unsigned char nrOfBounds)
+{
+	this->bounds = bounds;
+	this->nrOfBounds = min(nrOfBounds, METRICS_MAX_BUCKETS);
+	for(unsigned char i = 0; i <= METRICS_MAX_BUCKETS; i++)
+	{
+		this->counts[i] = 0;
+	}
+	this->sum = 0;
+}
+
+void MetricsHistogram::Observe(unsigned int value)
+{
+	unsigned char bucket = 0;
+	while(bucket < this->nrOfBounds && value > this->bounds[bucket])
+	{
+		bucket++;
+	}
+	this->counts[bucket].fetch_add(1, std::memory_order_relaxed);
+	this->sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+void MetricsHistogram::Write(ostream& out, const char* name, const char* help, double unit) const
+{
+	out << "# HELP " << name << " " << help << "\n";
+	out << "# TYPE " << name << " histogram\n";
+	// Prometheus buckets are cumulative.
+	unsigned long long count = 0;
+	for(unsigned char i = 0; i <= this->nrOfBounds; i++)
+	{
+		count += this->counts[i].load(std::memory_order_relaxed);
+		out << name << "_bucket{le=\"";
+		if(i < this->nrOfBounds)
+		{
+			out << this->bounds[i] * unit;
+		}
+		else
+		{
+			out << "+Inf";
+		}
+		out << "\"} " << count << "\n";
+	}
+	out << name << "_sum " << this->sum.load(std::memory_order_relaxed) * unit << "\n";
+	out << name << "_count " << count << "\n";
+}
+
+Metrics::Metrics() 
+	: thinkTime(METRICS_THINK_TIME_BOUNDS, sizeof(METRICS_THINK_TIME_BOUNDS) / sizeof(METRICS_THINK_TIME_BOUNDS[0])),
+	roundTrip(METRICS_ROUND_TRIP_BOUNDS, sizeof(METRICS_ROUND_TRIP_BOUNDS) / sizeof(METRICS_ROUND_TRIP_BOUNDS[0]))
+{
+	this->nrOfMoves = 0;
+	this->nrOfNodes = 0;
+	this->searchTimeMS = 0;
+	this->nrOfOverruns = 0;
+	this->lastDepth = 0;
+	this->lastNodesPerSecond = 0;
+	for(unsigned int i = 0; i < METRICS_MAX_ENGINES; i++)
+	{
+		this->engineMemory[i] = 0;
+	}
+	QueryPerformanceFrequency(&this->frequency);
+	this->startTime = timeGetTime();
+	this->stopServer = false;
+	this->nrOfScrapes = 0;
+	this->listenSocket = -1;
+}
+
+Metrics::~Metrics()
+{
+	this->StopServer();
+}
+
+void Metrics::RecordMove(unsigned int thinkTimeMS, unsigned int hardLimitMS, unsigned int nrOfNodes, unsigned char depth)
+{
+	this->nrOfMoves.fetch_add(1, std::memory_order_relaxed);
+	this->nrOfNodes.fetch_add(nrOfNodes, std::memory_order_relaxed);
+	this->searchTimeMS.fetch_add(thinkTimeMS, std::memory_order_relaxed);
+	if(thinkTimeMS > hardLimitMS + METRICS_OVERRUN_MARGIN)
+	{
+		this->nrOfOverruns.fetch_add(1, std::memory_order_relaxed);
+	}
+	this->lastDepth.store(depth, std::memory_order_relaxed);
+	this->lastNodesPerSecond.store((unsigned int)(1000ULL * nrOfNodes / max(thinkTimeMS, 1U)), std::memory_order_relaxed);
+	this->thinkTime.Observe(thinkTimeMS);
+}
+
+unsigned long long Metrics::GetTime() const
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return now.QuadPart;
+}
+
+void Metrics::RecordRoundTrip(unsigned long long startTime)
+{
+	unsigned long long microseconds = (this->GetTime() - startTime) * 1000000 / this->frequency.QuadPart;
+	this->roundTrip.Observe((unsigned int)min(microseconds, (unsigned long long)UINT_MAX));
+}
+
+void Metrics::SetEngineMemory(unsigned int engineIndex, unsigned long long bytes)
+{
+	if(engineIndex < METRICS_MAX_ENGINES)
+	{
+		this->engineMemory[engineIndex].store(bytes, std::memory_order_relaxed);
+	}
+}
+
+string Metrics::Format() const
+{
+	ostringstream out;
+	out.precision(12);
+	out << "# HELP kalaha_moves_total Moves played by the client.\n";
+	out << "# TYPE kalaha_moves_total counter\n";
+	out << "kalaha_moves_total " << this->nrOfMoves.load(std::memory_order_relaxed) << "\n";
+	this->thinkTime.Write(out, "kalaha_move_think_seconds", "Time spent searching each move.", 0.001);
+	out << "# HELP kalaha_nodes_total Nodes searched (playouts of the Monte Carlo tree search).\n";
+	out << "# TYPE kalaha_nodes_total counter\n";
+	out << "kalaha_nodes_total " << this->nrOfNodes.load(std::memory_order_relaxed) << "\n";
+	out << "# HELP kalaha_search_seconds_total Time spent searching, for the average nodes per second.\n";
+	out << "# TYPE kalaha_search_seconds_total counter\n";
+	out << "kalaha_search_seconds_total " << this->searchTimeMS.load(std::memory_order_relaxed) * 0.001 << "\n";
+	out << "# HELP kalaha_nodes_per_second Nodes per second of the latest move.\n";
+	out << "# TYPE kalaha_nodes_per_second gauge\n";
+	out << "kalaha_nodes_per_second " << this->lastNodesPerSecond.load(std::memory_order_relaxed) << "\n";
+	out << "# HELP kalaha_search_depth Depth reached by the latest move.\n";
+	out << "# TYPE kalaha_search_depth gauge\n";
+	out << "kalaha_search_depth " << this->lastDepth.load(std::memory_order_relaxed) << "\n";
+	out << "# HELP kalaha_time_limit_overruns_total Moves that took more than " << METRICS_OVERRUN_MARGIN << " ms longer than their hard time limit.\n";
+	out << "# TYPE kalaha_time_limit_overruns_total counter\n";
+	out << "kalaha_time_limit_overruns_total " << this->nrOfOverruns.load(std::memory_order_relaxed) << "\n";
+	this->roundTrip.Write(out, "kalaha_protocol_round_trip_seconds", "Time from sending a poll to the server until all its responses were received.", 0.000001);
+	unsigned long long memory = 0;
+	for(unsigned int i = 0; i < METRICS_MAX_ENGINES; i++)
+	{
+		memory += this->engineMemory[i].load(std::memory_order_relaxed);
+	}
+	out << "# HELP kalaha_engine_memory_bytes Memory used by the search engines (trees and tables), as of their latest move.\n";
+	out << "# TYPE kalaha_engine_memory_bytes gauge\n";
+	out << "kalaha_engine_memory_bytes " << memory << "\n";
+	out << "# HELP kalaha_uptime_seconds Time since the client started.\n";
+	out << "# TYPE kalaha_uptime_seconds gauge\n";
+	out << "kalaha_uptime_seconds " << (timeGetTime() - this->startTime) / 1000 << "\n";
+	out << "# HELP kalaha_metrics_scrapes_total Requests served by the metrics endpoint.\n";
+	out << "# TYPE kalaha_metrics_scrapes_total counter\n";
+	out << "kalaha_metrics_scrapes_total " << this->nrOfScrapes.load(std::memory_order_relaxed) << "\n";
+	return out.str();
+}
+
+bool Metrics::StartServer(unsigned short port)
+{
+	this->StopServer();
+	this->listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	int reuseAddress = 1;
+	setsockopt(this->listenSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuseAddress, sizeof(reuseAddress));
+	if(bind(this->listenSocket, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(this->listenSocket, SOMAXCONN) != 0)
+	{
+		closesocket(this->listenSocket);
+		this->listenSocket = -1;
+		return false;
+	}
+	this->stopServer = false;
+	this->serverThread = std::thread(&Metrics::Serve, this);
+	return true;
+}
+
+void Metrics::StopServer()
+{
+	if(this->serverThread.joinable())
+	{
+		this->stopServer = true;
+		this->serverThread.join();
+	}
+	if(this->listenSocket != -1)
+	{
+		closesocket(this->listenSocket);
+		this->listenSocket = -1;
+	}
+}
+
+void Metrics::Serve()
+{
+	while(!this->stopServer)
+	{
+		// Wake up regularly to see if the server should stop.
+		fd_set readSet;
+		FD_ZERO(&readSet);
+		FD_SET(this->listenSocket, &readSet);
+		timeval timeout = {0, (long)METRICS_POLL_TIME * 1000};
+		if(select(this->listenSocket + 1, &readSet, nullptr, nullptr, &timeout) <= 0)
+		{
+			continue;
+		}
+		int clientSocket = accept(this->listenSocket, nullptr, nullptr);
+		if(clientSocket < 0)
+		{
+			continue;
+		}
+		this->HandleRequest(clientSocket);
+		closesocket(clientSocket);
+	}
+}
+
+void Metrics::HandleRequest(int clientSocket)
+{
+	// Read the request head. Only the request line matters, the headers are skipped.
+	char request[4096];
+	unsigned int length = 0;
+	DWORD startTime = timeGetTime();
+	while(length < sizeof(request) - 1)
+	{
+		DWORD timeElapsed = timeGetTime() - startTime;
+		if(timeElapsed >= METRICS_REQUEST_TIMEOUT)
+		{
+			return;
+		}
+		fd_set readSet;
+		FD_ZERO(&readSet);
+		FD_SET(clientSocket, &readSet);
+		timeval timeout = {0, (long)(METRICS_REQUEST_TIMEOUT - timeElapsed) * 1000};
+		if(select(clientSocket + 1, &readSet, nullptr, nullptr, &timeout) <= 0)
+		{
+			return;
+		}
+		int nrOfBytes = recv(clientSocket, request + length, sizeof(request) - 1 - length, 0);
+		if(nrOfBytes <= 0)
+		{
+			return;
+		}
+		length += nrOfBytes;
+		request[length] = '\0';
+		if(strstr(request, "\r\n\r\n") || strstr(request, "\n\n"))
+		{
+			break;
+		}
+	}
+	request[length] = '\0';
+
+	string status = "200 OK";
+	string body;
+	if(strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET / ", 6) == 0)
+	{
+		body = this->Format();
+		this->nrOfScrapes.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		status = "404 Not Found";
+		body = "Metrics are served at /metrics.\n";
+	}
+	string response = "HTTP/1.0 " + status + "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + to_string(body.size());
+	response += "\r\nConnection: close\r\n\r\n" + body;
+	unsigned int sent = 0;
+	while(sent < response.size())
+	{
+		int nrOfBytes = send(clientSocket, response.c_str() + sent, (int)(response.size() - sent), 0);
+		if(nrOfBytes <= 0)
+		{
+			return;
+		}
+		sent += nrOfBytes;
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <Windows.h>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <ostream>
+
+using namespace std;
+
+static const unsigned char METRICS_MAX_BUCKETS = 16;
+static const unsigned int METRICS_MAX_ENGINES = 64; // Engines whose memory is reported.
+static const DWORD METRICS_POLL_TIME = 200; // Milliseconds the server waits for a connection before checking whether to stop.
+static const unsigned int METRICS_REQUEST_TIMEOUT = 1000; // Milliseconds a scraper may take to send its request.
+static const unsigned int METRICS_OVERRUN_MARGIN = 5; // Milliseconds over the hard limit before a move counts as an overrun, the search only stops at its next time check.
+// Bucket bounds: think time in milliseconds and protocol round trips in microseconds.
+static const unsigned int METRICS_THINK_TIME_BOUNDS[] = {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000};
+static const unsigned int METRICS_ROUND_TRIP_BOUNDS[] = {50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 500000};
+
+/*
+	A Prometheus histogram. Observations are counted per bucket (not cumulative), so that an observation is one atomic add.
+*/
+class MetricsHistogram
+{
+	private:
+		const unsigned int* bounds;
+		unsigned char nrOfBounds;
+		std::atomic<unsigned long long> counts[METRICS_MAX_BUCKETS + 1]; // The last bucket is +Inf.
+		std::atomic<unsigned long long> sum;
+
+	public:
+		MetricsHistogram(const unsigned int* bounds, unsigned char nrOfBounds);
+
+		void Observe(unsigned int value);
+		/*
+			Writes the histogram in the Prometheus text format. The values are multiplied by unit (e.g. 0.001 for milliseconds to seconds).
+		*/
+		void Write(ostream& out, const char* name, const char* help, double unit) const;
+};
+
+/*
+	Counters of a running client, served in the Prometheus text format over HTTP (GET /metrics) on a local port.
+	The counters are only changed with relaxed atomic operations and the server thread only reads them, so recording
+	never waits for a scrape and a scrape never slows down a search. A scrape may see the counters of a move partially updated.
+*/
+class Metrics
+{
+	private:
+		std::atomic<unsigned long long> nrOfMoves;
+		std::atomic<unsigned long long> nrOfNodes;
+		std::atomic<unsigned long long> searchTimeMS;
+		std::atomic<unsigned long long> nrOfOverruns; // Moves that took longer than their hard time limit (+ METRICS_OVERRUN_MARGIN).
+		std::atomic<unsigned int> lastDepth;
+		std::atomic<unsigned int> lastNodesPerSecond;
+		MetricsHistogram thinkTime;
+		MetricsHistogram roundTrip;
+		std::atomic<unsigned long long> engineMemory[METRICS_MAX_ENGINES]; // Bytes, per engine.
+		LARGE_INTEGER frequency;
+		DWORD startTime;
+		// The HTTP server.
+		std::thread serverThread;
+		std::atomic<bool> stopServer;
+		std::atomic<unsigned long long> nrOfScrapes;
+		int listenSocket;
+
+		void Serve();
+		/*
+			Reads the request of a scraper and sends the response.
+		*/
+		void HandleRequest(int clientSocket);
+
+	public:
+		Metrics();
+		virtual ~Metrics();
+
+		/*
+			Records one of our moves. hardLimitMS = The time the move should not have exceeded.
+		*/
+		void RecordMove(unsigned int thinkTimeMS, unsigned int hardLimitMS, unsigned int nrOfNodes, unsigned char depth);
+		/*
+			Returns a time stamp for RecordRoundTrip(...).
+		*/
+		unsigned long long GetTime() const;
+		/*
+			Records a round trip to the server that started at the given time stamp.
+		*/
+		void RecordRoundTrip(unsigned long long startTime);
+		void SetEngineMemory(unsigned int engineIndex, unsigned long long bytes);
+		/*
+			Returns all metrics in the Prometheus text format.
+		*/
+		string Format() const;
+
+		/*
+			Starts serving the metrics on the port of the loopback interface. Returns false if the port could not be opened.
+		*/
+		bool StartServer(unsigned short port);
+		void StopServer();
+};
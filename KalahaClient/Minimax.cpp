@@ -2,6 +2,7 @@
 
 #include "Node.h"
 #include "Board.h"
+#include "SpanTrace.h"
 
 #include <limits.h>
 
@@ -10,22 +11,10 @@ using namespace std;
 
 char Minimax::Evaluation(const Board const* board, bool minTurn)
 {
-	// Difference in max & min's current scores.
-	char utilityDiff = board->GetNrOfSeedsInKalah(0) - board->GetNrOfSeedsInKalah(1);  
-	
-	// Check if current player can steal the opponent's seeds and...
-	char nrOfStolenSeeds = board->CanGetOpponentSeeds(minTurn);
-	if(nrOfStolenSeeds > 0)
-	{
-		utilityDiff += nrOfStolenSeeds;
-	}
-	else
-	{
-		// ... only check if current player can get more turns, this turn, if not.
-		utilityDiff += UTILITY_EXTRA_TURN_CONSTANT * board->CanGetExtraTurn(minTurn);
-	}
-
-	return utilityDiff;
+	// A weighted sum of the features of the position, see Evaluation.h.
+	short features[EVALUATION_NR_OF_FEATURES];
+	ExtractFeatures(*board, minTurn, features);
+	return this->evaluationWeights.Evaluate(features);
 }
 
 char Minimax::UtilityFunction(const Board const* board)
@@ -36,10 +25,156 @@ char Minimax::UtilityFunction(const Board const* board)
 		// Max won, return max's score.
 		return board->GetNrOfSeedsInKalah(0);
 	}
+	if(board->GetNrOfSeedsInKalah(0) == board->GetNrOfSeedsInKalah(1))
+	{
+		// Draw, the same for both players (so that the utility of a swapped board is the negated utility).
+		return 0;
+	}
 
 	// Min won, return min's (negative) score.
 	return -board->GetNrOfSeedsInKalah(1);
 }
+unsigned char Minimax::ChildDepth(unsigned char maxDepth, bool extraTurn) const
+{
+	// An extra turn is a forced continuation of the same player's move, so treat the chain as one (macro) move.
+	if(this->expandExtraTurns && extraTurn)
+	{
+		return maxDepth;
+	}
+	return maxDepth - 1;
+}
+bool Minimax::IsQuietMove(const Board& board, const Board& childBoard, bool minTurn, bool extraTurn) const
+{
+	// A capture puts at least the captured seed and the last seed in the kalah, a plain move at most one seed (when passing it).
+	return !extraTurn && childBoard.GetNrOfSeedsInKalah(minTurn) - board.GetNrOfSeedsInKalah(minTurn) <= 1 && childBoard.IsTerminalState() == -1;
+}
+bool Minimax::SeedBoundCutoff(const Board& board, char alpha, char beta, char& utility) const
+{
+	// The seeds in a kalah never leave it, so a player with more than half of the seeds has won 
+	// and the utility (the winner's final score) lies between the seeds in the kalah and the seeds not in the loser's kalah.
+	const char half = AMBO_SEED_COUNT * AMBO_PLAYER_COUNT;
+	char lower;
+	char upper;
+	if(board.GetNrOfSeedsInKalah(0) > half)
+	{
+		lower = board.GetNrOfSeedsInKalah(0);
+		upper = 2 * half - board.GetNrOfSeedsInKalah(1);
+	}
+	else if(board.GetNrOfSeedsInKalah(1) > half)
+	{
+		lower = -(2 * half - board.GetNrOfSeedsInKalah(0));
+		upper = -board.GetNrOfSeedsInKalah(1);
+	}
+	else
+	{
+		return false;
+	}
+
+	if(lower >= beta)
+	{
+		utility = lower;
+		return true;
+	}
+	if(upper <= alpha)
+	{
+		utility = upper;
+		return true;
+	}
+	return false;
+}
+char Minimax::Quiescence(Board& board, unsigned char depth, bool minTurn, char alpha, char beta)
+{
+	this->nrOfNodes++;
+	if(board.IsTerminalState() != -1)
+	{
+		char utility = this->UtilityFunction(&board);
+		this->TraceExit(utility, EXIT_TERMINAL);
+		return utility;
+	}
+
+	// The side to move is not forced to make a tactical move, so the evaluation is a bound (stand pat).
+	char standPat = this->Evaluation(&board, minTurn);
+	if(depth == 0)
+	{
+		this->TraceExit(standPat, EXIT_EVALUATION);
+		return standPat;
+	}
+	if(minTurn)
+	{
+		if(standPat <= alpha)
+		{
+			this->TraceExit(alpha, EXIT_STAND_PAT);
+			return alpha;
+		}
+		beta = min(beta, standPat);
+	}
+	else
+	{
+		if(standPat >= beta)
+		{
+			this->TraceExit(beta, EXIT_STAND_PAT);
+			return beta;
+		}
+		alpha = max(alpha, standPat);
+	}
+
+	// The moves are made and taken back on the board itself.
+	unsigned char seedsInKalah = board.GetNrOfSeedsInKalah(minTurn);
+	MoveUndo undo;
+	unsigned char nrOfMoves = 0; // Searched so far.
+	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+	{
+		MoveOutcome outcome = board.MoveSeeds(i, minTurn, undo);
+		if(!outcome.IsValid())
+		{
+			continue;
+		}
+		// Only tactical moves are searched.
+		if(!outcome.extraTurn && outcome.nrOfCapturedSeeds == 0)
+		{
+			board.UndoMove(undo);
+			continue;
+		}
+		if(!outcome.extraTurn && !outcome.terminal)
+		{
+			// Delta pruning: skip captures that can't reach the bound even if they are worth a bit more than the seeds gained.
+			int gain = board.GetNrOfSeedsInKalah(minTurn) - seedsInKalah + QUIESCENCE_DELTA_MARGIN;
+			if((minTurn && standPat - gain >= beta) || (!minTurn && standPat + gain <= alpha))
+			{
+				board.UndoMove(undo);
+				continue;
+			}
+		}
+
+		bool childMinTurn = outcome.extraTurn ? minTurn : !minTurn;
+		nrOfMoves++;
+		if(this->searchVisitor)
+		{
+			this->searchVisitor->EnterNode(i, depth - 1, childMinTurn, alpha, beta, true);
+		}
+		char utilityValue = this->Quiescence(board, depth - 1, childMinTurn, alpha, beta);
+		board.UndoMove(undo);
+		if(minTurn && utilityValue < beta)
+		{
+			beta = utilityValue;
+			this->TraceScore(i, beta);
+		}
+		else if(!minTurn && utilityValue > alpha)
+		{
+			alpha = utilityValue;
+			this->TraceScore(i, alpha);
+		}
+		// If alpha is greater (or equal) to beta, it means we've found a branch that is worse.
+		if(beta <= alpha)
+		{
+			this->TraceCutoff(i, nrOfMoves);
+			break;
+		}
+	}
+
+	this->TraceExit(minTurn ? beta : alpha, EXIT_SEARCHED);
+	return minTurn ? beta : alpha;
+}
 void Minimax::DeAllocate(Node* currentNode)
 {
 	// Delete the nodes recursively using depth-first search.
@@ -52,134 +187,770 @@ void Minimax::DeAllocate(Node* currentNode)
 	}
 	delete currentNode;	
 	currentNode = nullptr;
+	this->nrOfAllocatedNodes--;
 }
 
 Minimax::Minimax()
 {
 	this->startTime = 0;
 	this->timeLimitMS = 0;
+	this->expandExtraTurns = false;
+	this->quiescenceDepth = 0;
+	this->selectiveSearch = SELECTIVE_NONE;
+	this->nrOfNodes = 0;
+	this->nrOfAllocatedNodes = 0;
+	this->memoryBudget = 0;
+	this->maxNrOfAllocatedNodes = ULLONG_MAX;
+	this->scratchNodes.assign(SCRATCH_MAX_PLIES * AMBO_PLAYER_COUNT, Node()); // Also used by pondering without a budget.
+	this->nrOfScratchNodesInUse = 0;
+	this->nrOfUnstoredNodes = 0;
+	this->peakMemoryUsage = 0;
+	this->searchVisitor = nullptr;
+	this->timedOut = false;
+	this->pondering = false;
+	this->ponderingOnOpponentTime = false;
+	this->stopSearch = false;
+	this->rootNode = nullptr;
+	this->rootMinTurn = false;
+	this->rootBestMove = -1;
+	this->nrOfReusedNodes = 0;
+	this->nrOfTranspositionHits = 0;
+	this->searchStartDepth = 0;
+	this->searchDepth = 0;
+	this->solverResult = SOLVER_UNKNOWN;
+	this->solvedDraw = false;
+	this->nrOfSolverNodes = 0;
+	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+	{
+		this->history[0][i] = 0;
+		this->history[1][i] = 0;
+	}
 }
 Minimax::~Minimax()
 {
-	
+	this->StopPondering();
+	if(this->rootNode)
+	{
+		this->DeAllocate(this->rootNode);
+		this->rootNode = nullptr;
+	}
+	this->DeAllocateDiscardedNodes();
 }
 
-char Minimax::Generate(Node* currentNode, unsigned char maxDepth, bool minTurn, unsigned short int time, char alpha, char beta)
+char Minimax::Generate(Node* currentNode, unsigned char maxDepth, bool minTurn, unsigned short int time, char alpha, char beta, bool isRoot)
 {
-	if(maxDepth == 0 || time > this->timeLimitMS)
+	this->nrOfNodes++;
+	if(isRoot)
+	{
+		this->timedOut = false;
+		if(this->searchVisitor)
+		{
+			this->searchVisitor->StartIteration(currentNode->board, minTurn, maxDepth);
+			this->searchVisitor->EnterNode(SEARCH_TRACE_NO_MOVE, maxDepth, minTurn, alpha, beta, false);
+		}
+	}
+	else if(this->selectiveSearch & SELECTIVE_SEED_BOUNDS)
 	{
-		if(currentNode->board->IsTerminalState() != -1)
+		char boundUtility;
+		if(this->SeedBoundCutoff(currentNode->board, alpha, beta, boundUtility))
 		{
-			return this->UtilityFunction(currentNode->board);
+			currentNode->utility = boundUtility;
+			this->TraceExit(currentNode->utility, EXIT_SEED_BOUND);
+			return currentNode->utility;
 		}
+	}
+	// The game is over. With the sweep rule no moves are left, without it the side with seeds must not move on.
+	if(currentNode->board.IsTerminalState() != -1)
+	{
+		currentNode->utility = this->UtilityFunction(&currentNode->board);
+		this->TraceExit(currentNode->utility, EXIT_TERMINAL);
+		return currentNode->utility;
+	}
+	if(maxDepth == 0 || this->IsTimeUp(time))
+	{
+		if(this->IsTimeUp(time))
+		{
+			// Results depending on this evaluation are not stored, as they were not searched to their full depth.
+			this->timedOut = true;
+			currentNode->utility = this->Evaluation(&currentNode->board, minTurn);
+			this->TraceExit(currentNode->utility, EXIT_TIME_UP);
+			return currentNode->utility;
+		}
+
+		// Resolve pending captures and extra turns before trusting the evaluation. The quiescence search exits the node in the visitor.
+		currentNode->utility = this->Quiescence(currentNode->board, this->quiescenceDepth, minTurn, alpha, beta);
+		return currentNode->utility;
+	}
 
-		return this->Evaluation(currentNode->board, minTurn);
+	// Check if the position has already been searched deep enough. 
+	// The root is always expanded, as the move is selected from its children.
+	unsigned long long key = TranspositionTable::GetKey(currentNode->board, minTurn);
+	TranspositionEntry entry;
+	bool found = this->transpositionTable.Probe(key, minTurn, entry);
+	if(!isRoot && found && entry.depth >= maxDepth)
+	{
+		if(entry.bound == BOUND_EXACT || (entry.bound == BOUND_LOWER && entry.utility >= beta) || (entry.bound == BOUND_UPPER && entry.utility <= alpha))
+		{
+			this->nrOfTranspositionHits++;
+			currentNode->utility = entry.utility;
+			this->TraceExit(currentNode->utility, EXIT_TRANSPOSITION);
+			return currentNode->utility;
+		}
 	}
+	char originalAlpha = alpha;
+	char originalBeta = beta;
+	char bestMove = -1;
+
+	unsigned char order[AMBO_PLAYER_COUNT];
+	this->OrderMoves(order, minTurn, found ? entry.bestMove : -1);
 
 
 	// Expand the tree if maximum depth has not yet been reached.
-	unsigned char nrOfSeeds[AMBO_PLAYER_COUNT];
-	Board childBoard;
-	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+	unsigned int nrOfUnstoredChildren = 0;
+	if(!currentNode->expanded)
 	{
-		childBoard = *currentNode->board; // Reset/copy board.
-		Node* newNode = nullptr;
-		nrOfSeeds[i] = childBoard.GetNrOfSeeds(i, minTurn); 
-		bool possibleMove = childBoard.MoveSeeds(i, minTurn);
-		if(possibleMove) 
+		// Over the memory budget (or below a node that was), the children are scratch nodes that are given back when
+		// this node has been searched, so the rest of the subtree is searched without storing it.
+		// Pondering can run for as long as the opponent thinks, so its tree is limited even without a budget.
+		unsigned long long maxNrOfNodes = this->ponderingOnOpponentTime ? min(this->maxNrOfAllocatedNodes, PONDER_MAX_NODES) : this->maxNrOfAllocatedNodes;
+		bool unstored = this->nrOfScratchNodesInUse > 0 || this->nrOfAllocatedNodes + AMBO_PLAYER_COUNT > maxNrOfNodes;
+		if(unstored && this->nrOfScratchNodesInUse + AMBO_PLAYER_COUNT > this->scratchNodes.size())
 		{
-			newNode = new Node(childBoard);
+			// The scratch nodes are used up (by a very long line of extra turns), the position is evaluated instead.
+			currentNode->utility = this->Quiescence(currentNode->board, this->quiescenceDepth, minTurn, alpha, beta);
+			return currentNode->utility;
 		}
-		currentNode->children[i] = newNode; // Always set the child pointers. null pointers are handled.
+		// Each move is made on the node's board, copied into the child and taken back.
+		MoveUndo undo;
+		for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+		{
+			Node* newNode = nullptr;
+			MoveOutcome outcome = currentNode->board.MoveSeeds(i, minTurn, undo);
+			if(outcome.IsValid()) 
+			{
+				bool extraTurn = outcome.extraTurn && !outcome.terminal;
+				if(this->ChildDepth(maxDepth, extraTurn) > 0)
+				{
+					// The child will probe the table, start loading its bucket while the other children are made.
+					this->transpositionTable.Prefetch(TranspositionTable::GetKey(currentNode->board, extraTurn ? minTurn : !minTurn));
+				}
+				if(unstored)
+				{
+					newNode = &this->scratchNodes[this->nrOfScratchNodesInUse + nrOfUnstoredChildren++];
+					*newNode = Node(currentNode->board);
+				}
+				else
+				{
+					newNode = new Node(currentNode->board);
+					this->nrOfAllocatedNodes++;
+				}
+				currentNode->board.UndoMove(undo);
+				if(extraTurn)
+				{
+					currentNode->extraTurnChildren |= 1 << i;
+				}
+			}
+			currentNode->children[i] = newNode; // Always set the child pointers. null pointers are handled.
+		}
+		currentNode->expanded = true;
+		this->nrOfScratchNodesInUse += nrOfUnstoredChildren;
+		this->nrOfUnstoredNodes += nrOfUnstoredChildren;
+	}
+	else
+	{
+		this->nrOfReusedNodes++; // The children were generated by an earlier search.
 	}
 
 	if(currentNode->IsLeaf())
 	{
-		return this->UtilityFunction(currentNode->board);
+		currentNode->utility = this->UtilityFunction(&currentNode->board);
+		this->TraceExit(currentNode->utility, EXIT_TERMINAL);
+		return currentNode->utility;
 	}
 
 
 	// If node is not a terminal node, propagate the utility value (highest/lowest depending on whose turn it is)
 	// of children to parent node up to root node.
 	char utilityValue = 0;
-	unsigned short int timeElapsed = 0;
+	unsigned char nrOfMoves = 0; // Moves reached in the order, including pruned ones.
 	
 	if(minTurn)
 	{
 		currentNode->utility = UTILITY_BEST_OPPONENT;
-		for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+		for(unsigned char n = 0; n < AMBO_PLAYER_COUNT; n++)
 		{
-			minTurn = true; 
+			unsigned char i = order[n];
 			if(currentNode->children[i])
 			{
-				// Check if last seed was put in the kalah.
-				// i = start.
-				// nrOfSeeds = steps to increment (end).
-				// playerIndex * AMBO_PLAYER_COUNT + playerIndex = player-offset.
-				unsigned char lastSeedIndex = (i + nrOfSeeds[i] + 1 * AMBO_PLAYER_COUNT + 1) % AMBO_COUNT;
-
-				// The opponents kalah shall be stepped over, so check how many times we iterate over it.
-				// i = start index.
-				// i + nrOfSeeds = end index.
-				// Range [0, AMBO_COUNT-1] of (i + nrOfSeeds), therefore to get correct number of iterations,
-				// subtract 1 from AMBO_COUNT and do integer division.
-				lastSeedIndex += (i + nrOfSeeds[i]) / (AMBO_COUNT - 1);
-				if(lastSeedIndex == AMBO_COUNT - 1)
+				// Min keeps the turn if the last seed was put in the kalah.
+				bool extraTurn = (currentNode->extraTurnChildren & (1 << i)) != 0;
+				bool childMinTurn = extraTurn;
+				Node* child = currentNode->children[i];
+				unsigned char childDepth = this->ChildDepth(maxDepth, extraTurn);
+				bool quiet = !isRoot && this->IsQuietMove(currentNode->board, child->board, minTurn, extraTurn);
+				nrOfMoves++;
+
+				// Futility pruning: near the horizon a quiet move can't make up for an evaluation far beyond the bound.
+				if(quiet && (this->selectiveSearch & SELECTIVE_FUTILITY_PRUNING) && maxDepth <= FUTILITY_MAX_DEPTH 
+					&& this->Evaluation(&child->board, childMinTurn) - FUTILITY_MARGIN * (maxDepth - 1) >= beta)
 				{
-					minTurn = false;
+					continue;
 				}
 				
-				// Send child node, reduce the depth-meter by one and change whose turn it is as parameters to this function.
-				timeElapsed = (unsigned short int)(timeGetTime() - this->startTime);
-				utilityValue = Generate(currentNode->children[i], maxDepth - 1, !minTurn, timeElapsed, alpha, beta);
-				beta = min(beta, utilityValue);
+				// Send child node, reduce the depth-meter by one (unless it is a free extra turn) and change whose turn it is as parameters to this function.
+				// Late quiet moves are unlikely to be best and are searched one ply shallower first.
+				bool reduce = quiet && (this->selectiveSearch & SELECTIVE_LATE_MOVE_REDUCTIONS) && maxDepth >= LATE_MOVE_REDUCTION_MIN_DEPTH 
+					&& nrOfMoves > LATE_MOVE_REDUCTION_FULL_MOVES;
+				utilityValue = this->GenerateChild(child, i, childDepth - (reduce ? 1 : 0), childMinTurn, alpha, beta);
+				if(reduce && utilityValue < beta)
+				{
+					// The reduced search found a better move, so it is searched again to full depth.
+					utilityValue = this->GenerateChild(child, i, childDepth, childMinTurn, alpha, beta);
+				}
+				if(utilityValue < beta)
+				{
+					beta = utilityValue;
+					bestMove = i;
+					this->TraceScore(i, beta);
+				}
 				// If alpha is greater (or equal) to beta, it means we've found a branch that is worse.
 				if(beta <= alpha)
 				{
+					this->history[minTurn][i] += maxDepth * maxDepth;
+					this->TraceCutoff(i, nrOfMoves);
 					break;
 				}
 			}
 		}
 		currentNode->utility = beta;
-		return currentNode->utility; 
 	}
 	else
 	{
 		currentNode->utility = UTILITY_BEST_PLAYER; 
-		for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+		for(unsigned char n = 0; n < AMBO_PLAYER_COUNT; n++)
 		{
-			minTurn = false;
+			unsigned char i = order[n];
 			if(currentNode->children[i])
 			{
-				// Check if last seed was put in the kalah.
-				// i = start.
-				// nrOfSeeds = steps to increment (end).
-				// playerIndex * AMBO_PLAYER_COUNT + playerIndex = player-offset.
-				unsigned char lastSeedIndex = (i + nrOfSeeds[i]) % AMBO_COUNT;
-
-				// The opponents kalah shall be stepped over, so check how many times we iterate over it.
-				// i = start index.
-				// i + nrOfSeeds = end index.
-				// Range [0, AMBO_COUNT-1] of (i + nrOfSeeds), therefore to get correct number of iterations,
-				// subtract 1 from AMBO_COUNT and do integer division.
-				lastSeedIndex += (i + nrOfSeeds[i]) / (AMBO_COUNT - 1);
-				if(lastSeedIndex == AMBO_PLAYER_COUNT)
+				// Max keeps the turn if the last seed was put in the kalah.
+				bool extraTurn = (currentNode->extraTurnChildren & (1 << i)) != 0;
+				bool childMinTurn = !extraTurn;
+				Node* child = currentNode->children[i];
+				unsigned char childDepth = this->ChildDepth(maxDepth, extraTurn);
+				bool quiet = !isRoot && this->IsQuietMove(currentNode->board, child->board, minTurn, extraTurn);
+				nrOfMoves++;
+
+				// Futility pruning: near the horizon a quiet move can't make up for an evaluation far beyond the bound.
+				if(quiet && (this->selectiveSearch & SELECTIVE_FUTILITY_PRUNING) && maxDepth <= FUTILITY_MAX_DEPTH 
+					&& this->Evaluation(&child->board, childMinTurn) + FUTILITY_MARGIN * (maxDepth - 1) <= alpha)
 				{
-					minTurn = true;
+					continue;
+				}
+				
+				// Send child node, reduce the depth-meter by one (unless it is a free extra turn) and change whose turn it is as parameters to this function.
+				// Late quiet moves are unlikely to be best and are searched one ply shallower first.
+				bool reduce = quiet && (this->selectiveSearch & SELECTIVE_LATE_MOVE_REDUCTIONS) && maxDepth >= LATE_MOVE_REDUCTION_MIN_DEPTH 
+					&& nrOfMoves > LATE_MOVE_REDUCTION_FULL_MOVES;
+				utilityValue = this->GenerateChild(child, i, childDepth - (reduce ? 1 : 0), childMinTurn, alpha, beta);
+				if(reduce && utilityValue > alpha)
+				{
+					// The reduced search found a better move, so it is searched again to full depth.
+					utilityValue = this->GenerateChild(child, i, childDepth, childMinTurn, alpha, beta);
+				}
+				if(utilityValue > alpha)
+				{
+					alpha = utilityValue;
+					bestMove = i;
+					this->TraceScore(i, alpha);
 				}
-
-				// Send child node, reduce the depth-meter by one and change whose turn it is as parameters to this function.
-				timeElapsed = (unsigned short int)(timeGetTime() - this->startTime); 
-				utilityValue = Generate(currentNode->children[i], maxDepth - 1, !minTurn, timeElapsed, alpha, beta);
-				alpha = max(alpha, utilityValue);
 				// If alpha is greater (or equal) to beta, it means we've found a branch that is worse.
 				if(beta <= alpha)
 				{
+					this->history[minTurn][i] += maxDepth * maxDepth;
+					this->TraceCutoff(i, nrOfMoves);
 					break; 
 				}
 			}
 		}
 		currentNode->utility = alpha;
-		return currentNode->utility;
 	}
+
+	if(isRoot)
+	{
+		this->rootBestMove = bestMove;
+	}
+
+	if(!this->timedOut)
+	{
+		unsigned char bound = BOUND_EXACT;
+		if(currentNode->utility <= originalAlpha)
+		{
+			bound = BOUND_UPPER;
+		}
+		else if(currentNode->utility >= originalBeta)
+		{
+			bound = BOUND_LOWER;
+		}
+		this->transpositionTable.Store(key, minTurn, currentNode->utility, maxDepth, bound, bestMove);
+	}
+	if(nrOfUnstoredChildren > 0)
+	{
+		// Give the scratch nodes back, the node is expanded again if it is searched again.
+		for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+		{
+			currentNode->children[i] = nullptr;
+		}
+		currentNode->expanded = false;
+		currentNode->extraTurnChildren = 0;
+		this->nrOfScratchNodesInUse -= nrOfUnstoredChildren;
+	}
+	this->TraceExit(currentNode->utility, EXIT_SEARCHED);
+	return currentNode->utility;
+}
+
+char Minimax::GenerateChild(Node* child, unsigned char move, unsigned char depth, bool minTurn, char alpha, char beta)
+{
+	if(this->searchVisitor)
+	{
+		this->searchVisitor->EnterNode(move, depth, minTurn, alpha, beta, false);
+	}
+	unsigned short int timeElapsed = (unsigned short int)(timeGetTime() - this->startTime);
+	return this->Generate(child, depth, minTurn, timeElapsed, alpha, beta, false);
+}
+
+void Minimax::OrderMoves(unsigned char order[AMBO_PLAYER_COUNT], bool minTurn, char bestMove) const
+{
+	// The best move of an earlier search of the position first, as it is the most likely to cause a cutoff.
+	// Then the moves which have caused the most cutoffs (history heuristic), insertion sorted.
+	unsigned char nrOfMoves = 0;
+	if(bestMove >= 0)
+	{
+		order[nrOfMoves++] = bestMove;
+	}
+	unsigned char firstSorted = nrOfMoves;
+	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+	{
+		if(i == bestMove)
+		{
+			continue;
+		}
+		unsigned char j = nrOfMoves++;
+		while(j > firstSorted && this->history[minTurn][order[j - 1]] < this->history[minTurn][i])
+		{
+			order[j] = order[j - 1];
+			j--;
+		}
+		order[j] = i;
+	}
+}
+
+Node* Minimax::DetachNode(Node* currentNode, bool currentMinTurn, const Board& board, bool minTurn, unsigned char maxPlies)
+{
+	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+	{
+		Node* child = currentNode->children[i];
+		if(!child)
+		{
+			continue;
+		}
+		bool childMinTurn = (currentNode->extraTurnChildren & (1 << i)) ? currentMinTurn : !currentMinTurn;
+		if(childMinTurn == minTurn && child->board == board)
+		{
+			currentNode->children[i] = nullptr;
+			return child;
+		}
+		// Only follow the moves of the other player, who may have made several moves in a row (extra turns).
+		if(childMinTurn != minTurn && maxPlies > 1)
+		{
+			Node* found = this->DetachNode(child, childMinTurn, board, minTurn, maxPlies - 1);
+			if(found)
+			{
+				return found;
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+void Minimax::SetRoot(const Board& board, bool minTurn)
+{
+	Node* newRoot = nullptr;
+	if(this->rootNode)
+	{
+		if(this->rootMinTurn == minTurn && this->rootNode->board == board)
+		{
+			return; // Keep the whole tree.
+		}
+		// Keep the subtree of the moves that were actually played, if they were searched.
+		// The rest of the tree is de-allocated by KeepSubtree(...), after the move has been made.
+		newRoot = this->DetachNode(this->rootNode, this->rootMinTurn, board, minTurn, KEPT_TREE_MAX_CHAIN);
+		this->discardedNodes.push_back(this->rootNode);
+	}
+	if(!newRoot)
+	{
+		newRoot = new Node(board);
+		this->nrOfAllocatedNodes++;
+	}
+	this->rootNode = newRoot;
+	this->rootMinTurn = minTurn;
+}
+
+char Minimax::Search(const Board& board, unsigned char startDepth, TimeManager& timeManager)
+{
+	ScopedSpan span("Search");
+	this->SetStartTime();
+	this->nrOfNodes = 0;
+	this->nrOfReusedNodes = 0;
+	this->nrOfTranspositionHits = 0;
+	this->nrOfUnstoredNodes = 0;
+	// Age the history, so that recent cutoffs count more than old ones.
+	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+	{
+		this->history[0][i] /= 2;
+		this->history[1][i] /= 2;
+	}
+	this->SetRoot(board, false);
+	this->transpositionTable.NewSearch();
+
+	// Start warm: an earlier search (e.g. pondering) that completed a depth for this position left an exact entry with 
+	// its best move, so the iterations up to that depth are skipped and the search goes on with the next one.
+	unsigned char depth = startDepth;
+	char warmMove = -1;
+	TranspositionEntry entry;
+	if(this->transpositionTable.Probe(TranspositionTable::GetKey(board, false), false, entry) && entry.bound == BOUND_EXACT 
+		&& entry.depth >= depth && entry.bestMove != -1 && board.GetNrOfSeeds(entry.bestMove, 0) > 0)
+	{
+		depth = (unsigned char)min(entry.depth + 1, MAX_SEARCH_DEPTH - 1);
+		warmMove = entry.bestMove;
+	}
+	// A warm search reports the completed depth it starts from, also if no further iteration completes.
+	this->searchStartDepth = warmMove != -1 ? entry.depth : depth;
+	this->searchDepth = this->searchStartDepth;
+	timeManager.StartMove(board);
+	this->timeLimitMS = timeManager.GetHardLimit();
+
+	char bestMove = this->Solve(board, timeManager.GetSoftLimit() / SOLVER_TIME_SHARE);
+	if(bestMove != -1)
+	{
+		timeManager.EndMove(timeGetTime() - this->startTime);
+		this->peakMemoryUsage = this->GetMemoryUsage();
+		return bestMove;
+	}
+	unsigned int timeElapsed = timeGetTime() - this->startTime; // The solver may have used some time.
+	// Without a move of a skipped depth, the first iteration always runs, so that there is a move.
+	bestMove = warmMove;
+	while(depth < MAX_SEARCH_DEPTH && (bestMove == -1 || timeManager.StartNextIteration(timeElapsed)))
+	{
+		unsigned int iterationStartNodes = this->nrOfNodes;
+		this->rootBestMove = -1;
+		{
+			ScopedSpan iterationSpan("Iteration", depth);
+			this->Generate(this->rootNode, depth, false, (unsigned short int)timeElapsed);
+		}
+		// An iteration stopped by the time limit hasn't compared all moves.
+		if(this->rootBestMove != -1 && (!this->timedOut || bestMove == -1))
+		{
+			bestMove = this->rootBestMove;
+		}
+		if(this->timedOut)
+		{
+			break;
+		}
+		this->searchDepth = depth;
+		timeManager.EndIteration(this->nrOfNodes - iterationStartNodes, bestMove);
+
+		timeElapsed = timeGetTime() - this->startTime; 
+		depth++; // Increase depth for next search.
+	}
+	timeManager.EndMove(timeGetTime() - this->startTime);
+	this->peakMemoryUsage = this->GetMemoryUsage();
+
+	// Fall back on the first possible move (the root can't be terminal when it is our turn).
+	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT && bestMove == -1; i++)
+	{
+		if(board.GetNrOfSeeds(i, 0) > 0)
+		{
+			bestMove = i;
+		}
+	}
+	return bestMove;
+}
+
+char Minimax::Solve(const Board& board, unsigned int timeLimitMS)
+{
+	this->solverResult = SOLVER_UNKNOWN;
+	this->solvedDraw = false;
+	this->nrOfSolverNodes = 0;
+	if(!this->solver.IsEnabled() || board.GetNrOfSeedsInAmbos(0) + board.GetNrOfSeedsInAmbos(1) > SOLVER_MAX_SEEDS)
+	{
+		return -1;
+	}
+
+	ScopedSpan span("Solve");
+	char move;
+	this->solverResult = this->solver.Solve(board, SOLVER_WIN_THRESHOLD, timeLimitMS, move);
+	this->nrOfSolverNodes = this->solver.GetNrOfNodes();
+	if(this->solverResult == SOLVER_DISPROVEN)
+	{
+		// The game can't be won, but a draw is still better than the heuristic search risking a loss.
+		unsigned int timeUsed = timeGetTime() - this->startTime;
+		if(timeUsed < timeLimitMS && this->solver.Solve(board, SOLVER_DRAW_THRESHOLD, timeLimitMS - timeUsed, move) == SOLVER_PROVEN)
+		{
+			this->solvedDraw = true;
+		}
+		this->nrOfSolverNodes += this->solver.GetNrOfNodes();
+	}
+	return move;
+}
+
+char Minimax::Analyze(const Board& board, bool minTurn, unsigned char depth)
+{
+	this->SetStartTime();
+	this->SetRoot(board, minTurn);
+	this->DeAllocateDiscardedNodes();
+
+	// Like pondering, the search is only limited by the depth.
+	this->pondering = true;
+	this->stopSearch = false;
+	char utility = 0;
+	for(unsigned char d = depth > 0 ? 1 : 0; d <= depth; d++)
+	{
+		ScopedSpan span("Iteration", d);
+		utility = this->Generate(this->rootNode, d, minTurn);
+	}
+	this->pondering = false;
+	return utility;
+}
+
+void Minimax::AnalyzeLines(const Board& board, bool minTurn, unsigned char depth, unsigned char nrOfLines, std::vector<PrincipalVariation>& lines)
+{
+	this->SetStartTime();
+	this->SetRoot(board, minTurn);
+	this->DeAllocateDiscardedNodes();
+	lines.clear();
+	if(board.IsTerminalState() != -1 || nrOfLines == 0)
+	{
+		return;
+	}
+	// The lines are searched from the children of the root, so they are always stored (even over the memory budget).
+	if(!this->rootNode->expanded)
+	{
+		for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+		{
+			Board child = board;
+			MoveOutcome outcome = child.MoveSeeds(i, minTurn);
+			if(outcome.IsValid())
+			{
+				this->rootNode->children[i] = new Node(child);
+				this->nrOfAllocatedNodes++;
+				if(outcome.extraTurn && !outcome.terminal)
+				{
+					this->rootNode->extraTurnChildren |= 1 << i;
+				}
+			}
+		}
+		this->rootNode->expanded = true;
+	}
+
+	unsigned char order[AMBO_PLAYER_COUNT]; // The moves, best first after every iteration.
+	unsigned char nrOfMoves = 0;
+	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+	{
+		if(this->rootNode->children[i])
+		{
+			order[nrOfMoves++] = i;
+		}
+	}
+	nrOfLines = min(nrOfLines, nrOfMoves);
+	// Of the player to move at the root. Exact for the lines of the latest iteration, an upper bound for the other moves.
+	int utilities[AMBO_PLAYER_COUNT];
+	bool exact[AMBO_PLAYER_COUNT] = {false};
+
+	// Like pondering, the search is only limited by the depth.
+	this->pondering = true;
+	this->stopSearch = false;
+	for(unsigned char d = 1; d <= max(depth, (unsigned char)1); d++)
+	{
+		int best[AMBO_PLAYER_COUNT]; // The exact utilities of this iteration, best first.
+		unsigned char nrOfExact = 0;
+		for(unsigned char n = 0; n < nrOfMoves; n++)
+		{
+			unsigned char move = order[n];
+			int kth = nrOfExact >= nrOfLines ? best[nrOfLines - 1] : -SCHAR_MAX; // The utility to beat to be one of the lines.
+			int lower = kth;
+			int upper = SCHAR_MAX;
+			if(exact[move] && utilities[move] + MULTI_PV_WINDOW > kth)
+			{
+				lower = max(kth, utilities[move] - MULTI_PV_WINDOW);
+				upper = utilities[move] + MULTI_PV_WINDOW;
+			}
+			int utility = this->SearchRootMove(move, d, lower, upper);
+			if((utility >= upper && upper < SCHAR_MAX) || (utility <= lower && lower > kth))
+			{
+				// Outside the window.
+				utility = this->SearchRootMove(move, d, kth, SCHAR_MAX);
+			}
+			utilities[move] = utility;
+			exact[move] = utility > kth;
+			if(exact[move])
+			{
+				// When the lines are full, the move replaces the worst of them.
+				unsigned char i = min(nrOfExact, (unsigned char)(nrOfLines - 1));
+				for(; i > 0 && best[i - 1] < utility; i--)
+				{
+					best[i] = best[i - 1];
+				}
+				best[i] = utility;
+				nrOfExact++;
+			}
+		}
+		// The bounds of the other moves are at most the utilities of the lines, so sorting keeps the lines first.
+		for(unsigned char n = 1; n < nrOfMoves; n++)
+		{
+			unsigned char move = order[n];
+			unsigned char m = n;
+			for(; m > 0 && utilities[order[m - 1]] < utilities[move]; m--)
+			{
+				order[m] = order[m - 1];
+			}
+			order[m] = move;
+		}
+	}
+	this->pondering = false;
+
+	for(unsigned char n = 0; n < nrOfLines && exact[order[n]]; n++)
+	{
+		unsigned char move = order[n];
+		bool extraTurn = (this->rootNode->extraTurnChildren & (1 << move)) != 0;
+		PrincipalVariation line;
+		line.move = move;
+		line.utility = (char)(minTurn ? -utilities[move] : utilities[move]);
+		line.moves.push_back(move);
+		this->GetPrincipalVariation(this->rootNode->children[move]->board, extraTurn ? minTurn : !minTurn, max(depth, (unsigned char)1), line.moves);
+		lines.push_back(line);
+	}
+}
+
+int Minimax::SearchRootMove(unsigned char move, unsigned char depth, int lower, int upper)
+{
+	bool extraTurn = (this->rootNode->extraTurnChildren & (1 << move)) != 0;
+	bool childMinTurn = extraTurn ? this->rootMinTurn : !this->rootMinTurn;
+	// Generate(...) works with the utilities of max.
+	char alpha = (char)(this->rootMinTurn ? -upper : lower);
+	char beta = (char)(this->rootMinTurn ? -lower : upper);
+	char utility = this->Generate(this->rootNode->children[move], this->ChildDepth(depth, extraTurn), childMinTurn, 0, alpha, beta, false);
+	return this->rootMinTurn ? -utility : utility;
+}
+
+void Minimax::GetPrincipalVariation(Board board, bool minTurn, unsigned char maxLength, std::vector<unsigned char>& moves) const
+{
+	for(unsigned char n = 0; n < maxLength && board.IsTerminalState() == -1; n++)
+	{
+		TranspositionEntry entry;
+		if(!this->transpositionTable.Probe(TranspositionTable::GetKey(board, minTurn), minTurn, entry) || entry.bestMove < 0 
+			|| board.GetNrOfSeeds(entry.bestMove, minTurn) == 0)
+		{
+			return;
+		}
+		MoveOutcome outcome = board.MoveSeeds(entry.bestMove, minTurn);
+		moves.push_back(entry.bestMove);
+		minTurn = outcome.extraTurn && !outcome.terminal ? minTurn : !minTurn;
+	}
+}
+
+void Minimax::KeepSubtree(unsigned char amboIndex)
+{
+	if(!this->rootNode)
+	{
+		return;
+	}
+	ScopedSpan span("Keep subtree");
+	Node* child = this->rootNode->children[amboIndex];
+	bool childMinTurn = (this->rootNode->extraTurnChildren & (1 << amboIndex)) ? this->rootMinTurn : !this->rootMinTurn;
+	this->rootNode->children[amboIndex] = nullptr;
+	this->DeAllocate(this->rootNode);
+	this->rootNode = child; // May be null if the move was never searched.
+	this->rootMinTurn = childMinTurn;
+	this->DeAllocateDiscardedNodes();
+}
+
+unsigned long long Minimax::GetMemoryUsage() const
+{
+	return (unsigned long long)(this->nrOfAllocatedNodes + this->scratchNodes.size()) * sizeof(Node) + this->transpositionTable.GetMemoryUsage() 
+		+ this->solver.GetMemoryUsage();
+}
+
+void Minimax::SetMemoryBudget(unsigned int sizeMB)
+{
+	this->memoryBudget = (unsigned long long)sizeMB * 1024 * 1024;
+	this->UpdateNodeLimit();
+}
+
+void Minimax::UpdateNodeLimit()
+{
+	if(this->memoryBudget == 0)
+	{
+		this->maxNrOfAllocatedNodes = ULLONG_MAX;
+		return;
+	}
+	unsigned long long tableMemory = this->transpositionTable.GetMemoryUsage() + this->solver.GetMemoryUsage() + this->scratchNodes.size() * sizeof(Node);
+	this->maxNrOfAllocatedNodes = this->memoryBudget > tableMemory ? (this->memoryBudget - tableMemory) / sizeof(Node) : 0;
+}
+
+void Minimax::DeAllocateDiscardedNodes()
+{
+	if(this->discardedNodes.empty())
+	{
+		return;
+	}
+	ScopedSpan span("De-allocate discarded nodes");
+	for(unsigned int i = 0; i < this->discardedNodes.size(); i++)
+	{
+		this->DeAllocate(this->discardedNodes[i]);
+	}
+	this->discardedNodes.clear();
+}
+
+void Minimax::StartPondering(const Board& board)
+{
+	this->StopPondering();
+	this->SetRoot(board, true);
+	this->stopSearch = false;
+	this->pondering = true;
+	this->ponderingOnOpponentTime = true;
+	this->ponderThread = thread(&Minimax::Ponder, this);
+}
+
+void Minimax::StopPondering()
+{
+	if(this->ponderThread.joinable())
+	{
+		this->stopSearch = true;
+		this->ponderThread.join();
+	}
+	this->stopSearch = false;
+	this->pondering = false;
+	this->ponderingOnOpponentTime = false;
+}
+
+void Minimax::Ponder()
+{
+	SpanTracer::NameThread("Ponder");
+	// It is the opponent's (min's) turn. Deepen until stopped, the tree and the transposition table are kept for our search.
+	for(unsigned char depth = 1; depth < MAX_SEARCH_DEPTH && !this->stopSearch; depth++)
+	{
+		ScopedSpan span("Ponder iteration", depth);
+		this->Generate(this->rootNode, depth, true);
+	}
+}
+
+void ConfigureMinimax(Minimax& minimax, const Config& config, unsigned int nrOfEngines)
+{
+	minimax.SetExpandExtraTurns(config.expandExtraTurns);
+	minimax.SetQuiescenceDepth(config.quiescenceDepth);
+	minimax.SetTranspositionTableSize(config.transpositionTableSize);
+	minimax.SetSelectiveSearch(config.selectiveSearch);
+	minimax.SetEvaluationWeights(config.evaluationWeights);
+	minimax.SetMemoryBudget(config.memoryBudget != 0 ? max(config.memoryBudget / nrOfEngines, 1U) : 0);
 }
\ No newline at end of file
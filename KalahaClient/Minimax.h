@@ -2,29 +2,275 @@
 
 
 #include "Node.h"
+#include "TranspositionTable.h"
+#include "TimeManager.h"
+#include "Solver.h"
+#include "Evaluation.h"
+#include "SearchTrace.h"
+#include "Config.h"
 #include <Windows.h>
+#include <thread>
+#include <atomic>
+#include <vector>
 #pragma comment(lib, "winmm.lib") // Needed for the timeGetTime()-function.
 
-static const char UTILITY_EXTRA_TURN_CONSTANT = 6; 
+static const char QUIESCENCE_DELTA_MARGIN = 2; // Seeds added to the gain of a capture before it is compared to the bound in the quiescence search.
 static const int UTILITY_BEST_OPPONENT = SCHAR_MAX;
 static const int UTILITY_BEST_PLAYER = SCHAR_MIN;
+static const unsigned char MAX_SEARCH_DEPTH = 37; // Depth limit of the iterative deepening. 
+static const unsigned char KEPT_TREE_MAX_CHAIN = 8; // Moves of one player in a row (an extra-turn chain) that are followed to find the kept subtree.
+static const unsigned char LATE_MOVE_REDUCTION_MIN_DEPTH = 3; // Nodes searched shallower than this are never reduced.
+static const unsigned char LATE_MOVE_REDUCTION_FULL_MOVES = 2; // The first moves of the order are always searched to full depth.
+static const unsigned char FUTILITY_MAX_DEPTH = 2; // Futility pruning is done in nodes searched at most this deep.
+static const char FUTILITY_MARGIN = 6; // Seeds the evaluation may change by per ply left, one extra-turn bonus.
+static const unsigned char SOLVER_TIME_SHARE = 4; // The solver may use 1/SOLVER_TIME_SHARE of the soft limit of a move.
+static const char MULTI_PV_WINDOW = 2; // Seeds around its utility of the previous iteration a line is first searched with.
+static const unsigned char SCRATCH_MAX_PLIES = 128; // Plies searched without storing the nodes when over the memory budget, deeper lines are evaluated.
+static const unsigned long long PONDER_MAX_NODES = (256ULL << 20) / sizeof(Node); // The tree pondering may grow to (256 MB), also without a memory budget.
+
+enum SELECTIVE_SEARCH
+{
+	SELECTIVE_NONE					= 0, // Full-width alpha-beta.
+	SELECTIVE_LATE_MOVE_REDUCTIONS	= 1, // Quiet moves late in the order are searched one ply shallower, and again at full depth if they look good.
+	SELECTIVE_FUTILITY_PRUNING		= 2, // Quiet moves near the horizon are skipped if their evaluation is too far below the bound.
+	SELECTIVE_SEED_BOUNDS			= 4, // Decided positions are cut off when the seeds left can't reach the bound.
+	SELECTIVE_ALL					= 7
+};
+
+/*
+	A line of the multi-PV analysis: a move of the root, its exact utility and its principal variation.
+*/
+struct PrincipalVariation
+{
+	unsigned char move;
+	char utility; // For max, like the utilities of Generate(...).
+	std::vector<unsigned char> moves; // Starting with move, as far as the transposition table knows the line.
+};
 
 class Minimax
 {
 	private:
 		DWORD startTime;
-		short int timeLimitMS;
+		short int timeLimitMS; // The hard limit of the current search.
+		TimeManager timeManager; // Used by Search(...) when no other time manager is given.
+		bool expandExtraTurns; // If true, moves giving an extra turn don't use up depth (extra-turn chains are searched as macro moves).
+		unsigned char quiescenceDepth; // The maximum number of tactical moves searched beyond the depth horizon. 0 = disabled.
+		unsigned char selectiveSearch; // The SELECTIVE_SEARCH techniques used, or-ed together.
+		unsigned int nrOfNodes; // The number of nodes visited since the last call to ResetNrOfNodes().
+		unsigned int nrOfAllocatedNodes; // Nodes of the kept tree and the discarded trees.
+		// The memory budget: when the tree reaches its share, the rest of the search allocates no more nodes.
+		unsigned long long memoryBudget; // In bytes, 0 = unlimited.
+		unsigned long long maxNrOfAllocatedNodes; // What is left of the budget after the tables and the scratch nodes.
+		std::vector<Node> scratchNodes; // The children of the nodes searched without storing them, used as a stack.
+		unsigned int nrOfScratchNodesInUse;
+		bool timedOut; // Set when the current search hit the time limit. Results are then no longer stored in the transposition table.
+		TranspositionTable transpositionTable;
+		Solver solver; // Tried before the heuristic search in endgames.
+		EvaluationWeights evaluationWeights;
+		SearchVisitor* searchVisitor; // Receives the events of the searches, nullptr if none.
+		// Pondering: searching the position on the opponent's time in a background thread.
+		std::thread ponderThread;
+		std::atomic<bool> stopSearch; // Set to make a running search return as soon as possible.
+		bool pondering; // If true, the time limit is ignored and the search only stops on stopSearch.
+		bool ponderingOnOpponentTime; // Set while the pondering thread runs, the tree then stores at most PONDER_MAX_NODES.
+		// State kept between moves.
+		Node* rootNode; // The tree of the current position, kept between searches and moves.
+		bool rootMinTurn; // Whose turn it is in the root position.
+		std::vector<Node*> discardedNodes; // Trees no longer needed, de-allocated when it doesn't delay a move.
+		char rootBestMove; // The best move found by the latest call to Generate(...) at the root, -1 if none.
+		unsigned int history[2][AMBO_PLAYER_COUNT]; // The number of cutoffs (weighted by depth) caused by each move, per player.
+		// Statistics of the latest search.
+		unsigned int nrOfReusedNodes; // Expanded nodes kept from an earlier search.
+		unsigned int nrOfTranspositionHits; // Nodes cut off by the transposition table.
+		unsigned char searchStartDepth;
+		unsigned char searchDepth;
+		SOLVER_RESULT solverResult; // Of the win threshold, SOLVER_UNKNOWN if the solver wasn't run.
+		bool solvedDraw; // The solver proved at least a draw after disproving the win.
+		unsigned int nrOfSolverNodes;
+		unsigned int nrOfUnstoredNodes; // Searched in scratch nodes because the tree had reached the memory budget.
+		unsigned long long peakMemoryUsage;
 
 	private:
 		char Evaluation(const Board const* board, bool minTurn);
 		char UtilityFunction(const Board const* board);
+		/*
+			Returns true if the move from board to childBoard neither gave an extra turn nor captured seeds.
+		*/
+		bool IsQuietMove(const Board& board, const Board& childBoard, bool minTurn, bool extraTurn) const;
+		/*
+			Returns true if the seeds in the kalahs decide the game and bound the utility outside of [alpha, beta].
+			utility is then set to the bound.
+		*/
+		bool SeedBoundCutoff(const Board& board, char alpha, char beta, char& utility) const;
+		/*
+			Writes the order to search the moves in to order. 
+			bestMove = The best move of an earlier search of the position, searched first. -1 if unknown.
+		*/
+		void OrderMoves(unsigned char order[AMBO_PLAYER_COUNT], bool minTurn, char bestMove) const;
+		/*
+			Searches the tree below currentNode for a node with the given board and player to move, 
+			following only the moves of the other player (at most maxPlies moves).
+			Returns the node, removed from the tree, or nullptr if not found.
+		*/
+		Node* DetachNode(Node* currentNode, bool currentMinTurn, const Board& board, bool minTurn, unsigned char maxPlies);
+		/*
+			Makes the board the root of the kept tree. The subtree of the board is kept if it is found, the rest is de-allocated.
+		*/
+		void SetRoot(const Board& board, bool minTurn);
+		/*
+			Sets the number of nodes the tree may allocate: what is left of the memory budget after the tables and the scratch nodes.
+		*/
+		void UpdateNodeLimit();
+		void DeAllocateDiscardedNodes();
+		/*
+			Tries to prove a win, or else a draw, for max in the board with the solver.
+			Returns a move keeping the proven result, -1 if nothing was proven.
+		*/
+		char Solve(const Board& board, unsigned int timeLimitMS);
+		/*
+			Searches only tactical moves (captures and extra turns) from a position at the depth horizon.
+			The side to move may always "stand pat" and take the static evaluation instead.
+			No nodes are allocated, the moves are made and taken back on the given board.
+
+			Parameters:
+			board = The position at the horizon. Changed during the search, but restored before returning.
+			depth = The maximum number of tactical moves to search.
+			minTurn = Set to true if it is min's turn.
+			alpha, beta = The same bounds as in Generate(...).
+
+			Returns the utility value of the position.
+		*/
+		char Quiescence(Board& board, unsigned char depth, bool minTurn, char alpha, char beta);
+		bool IsTimeUp(unsigned short int time) const { return this->stopSearch || (!this->pondering && time > this->timeLimitMS); }
+		/*
+			Searches a move of the (expanded) root to the depth of an iteration with the window (lower, upper). 
+			The window and the returned utility are those of the player to move at the root.
+		*/
+		int SearchRootMove(unsigned char move, unsigned char depth, int lower, int upper);
+		/*
+			Writes the best moves stored in the transposition table from the board on, at most maxLength of them.
+		*/
+		void GetPrincipalVariation(Board board, bool minTurn, unsigned char maxLength, std::vector<unsigned char>& moves) const;
+		/*
+			The pondering thread: iterative deepening of the root (min to move) until StopPondering() is called.
+			Past PONDER_MAX_NODES stored nodes (or the memory budget, if smaller) it searches without storing the nodes.
+		*/
+		void Ponder();
+		/*
+			Searches a child of a node in Generate(...), entering it in the search visitor first.
+		*/
+		char GenerateChild(Node* child, unsigned char move, unsigned char depth, bool minTurn, char alpha, char beta);
+		void TraceExit(char utility, SEARCH_EXIT reason) { if(this->searchVisitor) this->searchVisitor->ExitNode(utility, reason); }
+		void TraceScore(unsigned char move, char utility) { if(this->searchVisitor) this->searchVisitor->Score(move, utility); }
+		void TraceCutoff(unsigned char move, unsigned char moveNumber) { if(this->searchVisitor) this->searchVisitor->Cutoff(move, moveNumber); }
 
 	public:
 		Minimax();
 		virtual~Minimax();
 
 		DWORD GetStartTime() { return this->startTime; }
-		void SetTimeLimit(short int timeLimit) { this->timeLimitMS = timeLimit; }
+		void SetTimeLimit(short int timeLimit) { this->timeLimitMS = timeLimit; this->timeManager.SetMoveTime(timeLimit); }
+		/*
+			Divides the given time over the moves of a game instead of using the time limit for every move. 0 = disabled.
+		*/
+		void SetGameTime(unsigned int gameTimeMS) { this->timeManager.SetGameTime(gameTimeMS); }
+		/*
+			Resets the time left of the game. Call at the start of each game.
+		*/
+		void StartGame() { this->timeManager.StartGame(); this->transpositionTable.ResetStats(); }
+		const TimeManager& GetTimeManager() const { return this->timeManager; }
+		void SetExpandExtraTurns(bool expandExtraTurns) { this->expandExtraTurns = expandExtraTurns; }
+		void SetQuiescenceDepth(unsigned char quiescenceDepth) { this->quiescenceDepth = quiescenceDepth; }
+		/*
+			Selects the SELECTIVE_SEARCH techniques to use, or-ed together.
+		*/
+		void SetSelectiveSearch(unsigned char selectiveSearch) { this->selectiveSearch = selectiveSearch; }
+		void SetEvaluationWeights(const EvaluationWeights& evaluationWeights) { this->evaluationWeights = evaluationWeights; }
+		/*
+			Streams the events of the following searches (every node entered and exited, improved utilities and cutoffs)
+			to the visitor, e.g. a SearchTraceWriter. nullptr stops it. Without a visitor the search only checks the pointer.
+		*/
+		void SetSearchVisitor(SearchVisitor* searchVisitor) { this->searchVisitor = searchVisitor; }
+		/*
+			Returns the depth to search a child to, given the outcome of the move leading to it.
+		*/
+		unsigned char ChildDepth(unsigned char maxDepth, bool extraTurn) const;
+		unsigned int GetNrOfNodes() const { return this->nrOfNodes; }
+		void ResetNrOfNodes() { this->nrOfNodes = 0; }
+		unsigned int GetNrOfReusedNodes() const { return this->nrOfReusedNodes; }
+		unsigned int GetNrOfTranspositionHits() const { return this->nrOfTranspositionHits; }
+		unsigned char GetSearchStartDepth() const { return this->searchStartDepth; }
+		unsigned char GetSearchDepth() const { return this->searchDepth; }
+		SOLVER_RESULT GetSolverResult() const { return this->solverResult; }
+		bool IsSolvedDraw() const { return this->solvedDraw; }
+		unsigned int GetNrOfSolverNodes() const { return this->nrOfSolverNodes; }
+		unsigned int GetNrOfUnstoredNodes() const { return this->nrOfUnstoredNodes; }
+		/*
+			Returns the bytes used by the tree and the tables.
+		*/
+		unsigned long long GetMemoryUsage() const;
+		/*
+			Returns the bytes used at the end of the latest search, the most during the move (including pondering),
+			as the nodes are only de-allocated between moves.
+		*/
+		unsigned long long GetPeakMemoryUsage() const { return this->peakMemoryUsage; }
+		/*
+			Limits the memory of the tree and the tables, 0 = unlimited. The tables are allocated up front and the tree gets 
+			what is left. When the tree has used up its share, the rest of the search doesn't store the nodes it expands 
+			(they are searched in a small preallocated stack of scratch nodes and forgotten), and the transposition table 
+			keeps replacing its entries as usual. The search is then slower but never allocates more.
+		*/
+		void SetMemoryBudget(unsigned int sizeMB);
+		/*
+			Allocates the transposition table, 0 disables it.
+		*/
+		void SetTranspositionTableSize(unsigned int sizeMB) { this->transpositionTable.Resize(sizeMB); this->UpdateNodeLimit(); }
+		const TranspositionTable& GetTranspositionTable() const { return this->transpositionTable; }
+		/*
+			Allocates the table of the endgame solver, 0 disables it.
+		*/
+		void SetSolverTableSize(unsigned int sizeMB) { this->solver.Resize(sizeMB); this->UpdateNodeLimit(); }
+		/*
+			Selects a move for max (us). When few seeds are left, the solver first tries to prove a win or a draw
+			and its move is played without searching. Otherwise iterative deepening is used, starting at startDepth or deeper 
+			if the position has already been searched. The tree, the transposition table and the move ordering history 
+			are kept for the following searches.
+			The time manager decides the limits of the move and whether to start each iteration. 
+			An iteration stopped by the hard limit doesn't change the selected move.
+			Returns the index of the selected ambo.
+		*/
+		char Search(const Board& board, unsigned char startDepth, TimeManager& timeManager);
+		char Search(const Board& board, unsigned char startDepth) { return this->Search(board, startDepth, this->timeManager); }
+		/*
+			Searches the board to exactly the given depth without a time limit, deepening iteratively for the move ordering, 
+			and returns its utility. Used for offline analysis.
+		*/
+		char Analyze(const Board& board, bool minTurn, unsigned char depth);
+		/*
+			Multi-PV analysis: searches the board to the given depth like Analyze(...) and writes the best nrOfLines moves 
+			(or all moves, if there are fewer) to lines, best first, with their exact utilities and principal variations.
+			All lines are searched in one iterative deepening. A move only has to beat the nrOfLines-th best utility found
+			so far, which is its alpha (beta for min), so the moves outside the lines are refuted as cheaply as in a
+			single-line search. The lines are first searched in a window of MULTI_PV_WINDOW seeds around their utility
+			of the previous iteration, and searched again with the full window if they fall outside it.
+			With full-width search (SELECTIVE_NONE) the utilities are those of searching each move on its own; late move
+			reductions and futility pruning depend on the window, so with them the utilities may differ by a few seeds.
+		*/
+		void AnalyzeLines(const Board& board, bool minTurn, unsigned char depth, unsigned char nrOfLines, std::vector<PrincipalVariation>& lines);
+		/*
+			Keeps the subtree of the given move of the last searched position and de-allocates the rest of the tree.
+			Call after making the move returned by Search(...).
+		*/
+		void KeepSubtree(unsigned char amboIndex);
+		/*
+			Starts searching the board in a background thread, filling the tree and the transposition table with results 
+			for the opponent's (min's) possible moves. Search(...) and Generate(...) must not be called until StopPondering() has been called.
+		*/
+		void StartPondering(const Board& board);
+		/*
+			Stops the pondering thread (if running) and waits for it to finish.
+		*/
+		void StopPondering();
 		/*
 			Sets the start time used for the Generate(...)-function.
 		*/
@@ -42,13 +288,20 @@ class Minimax
 			time = The time spent in this function. When time becomes greater than the set time limit, the expansion of the tree stops.
 			alpha = The minimum utility value max (us) is assured of. Initial value set to lowest possible for data type.
 			beta = The maximum utility value min (opponent) is assured of. Initial value set to highest possible for data type.
+			isRoot = Set to false for all recursive calls. The root is never cut off by the transposition table.
 			
 			returns the best propagated utility value of child nodes.
 		*/		
-		char Generate(Node* currentNode, unsigned char maxDepth, bool minTurn, unsigned short int time = 0, char alpha = SCHAR_MIN, char beta = SCHAR_MAX);
+		char Generate(Node* currentNode, unsigned char maxDepth, bool minTurn, unsigned short int time = 0, char alpha = SCHAR_MIN, char beta = SCHAR_MAX, bool isRoot = true);
 		/*
 			De-allocates the memory of currentNode and its children using depth-first search.
 		*/
 		void DeAllocate(Node* currentNode);
 };
 
+/*
+	Applies the search settings of the config to an engine, so that every engine of the client searches the same way: 
+	the extra turns, the quiescence and selective search, the evaluation weights, the transposition table and the share 
+	of the memory budget (of nrOfEngines engines together). The time limits and the solver are only set when playing.
+*/
+void ConfigureMinimax(Minimax& minimax, const Config& config, unsigned int nrOfEngines = 1);
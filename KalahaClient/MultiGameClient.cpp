@@ -0,0 +1,380 @@
+#include "MultiGameClient.h"
+#include "SpanTrace.h"
+
+#include <winsock.h>
+#include <iostream>
+#include <sstream>
+#include <string.h>
+#include <limits.h>
+
+MultiGameClient::MultiGameClient(const Config& config, Logger& logger, Metrics& metrics) : config(config), logger(logger), metrics(metrics)
+{
+	this->enginePool = new EnginePool(config);
+	this->enginePool->SetMetrics(&metrics);
+}
+
+MultiGameClient::~MultiGameClient()
+{
+	// Stop the workers before the jobs of the games are deleted.
+	delete this->enginePool;
+	for(unsigned int i = 0; i < this->games.size(); i++)
+	{
+		if(this->games[i]->state != GAME_STATE_FINISHED)
+		{
+			closesocket(this->games[i]->server->GetSocket());
+		}
+		delete this->games[i]->server;
+		delete this->games[i];
+	}
+}
+
+unsigned int MultiGameClient::Connect()
+{
+	struct sockaddr_in peer; 
+	peer.sin_family = AF_INET;
+	peer.sin_port = htons((u_short)this->config.port);
+	peer.sin_addr.s_addr = inet_addr(this->config.address.c_str());
+
+	for(unsigned int i = 0; i < this->config.nrOfConnections; i++)
+	{
+		int mySocket = socket(AF_INET, SOCK_STREAM, 0);
+		if(connect(mySocket, (struct sockaddr*)&peer, sizeof(peer)) != 0)
+		{
+			cout << "Connection " << i + 1 << ": Failed to connect to the Kalaha server." << endl;
+			closesocket(mySocket);
+			continue;
+		}
+		ServerConnection* server = new ServerConnection(mySocket);
+
+		// Check which player we are.
+		unsigned short inputLength = 0;
+		const char* input = server->Request("HELLO\n", inputLength);
+		if (!input || inputLength < 7 || (input[6] != '1' && input[6] != '2'))  
+		{
+			cout << "Connection " << i + 1 << ": Error connecting to Kalaha server, reason: ";
+			cout << ErrorCodeToString((ERROR_CODE)(input ? ParseErrorCode(input, inputLength) : -1)) << endl;
+			closesocket(mySocket);
+			delete server;
+			continue;
+		}
+
+		GameSession* game = new GameSession();
+		game->id = (unsigned int)this->games.size() + 1;
+		game->server = server;
+		game->player = input[6] - '0';
+		game->state = GAME_STATE_WAITING;
+		game->nextPollTime = timeGetTime();
+		game->movePending = false;
+		game->nrOfPollResponses = 0;
+		game->winner = -1;
+		game->nextToMove = -1;
+		game->validBoard = false;
+		game->pollStartTime = 0;
+		game->nrOfVictories[0] = 0;
+		game->nrOfVictories[1] = 0;
+		game->nrOfDraws = 0;
+		game->nrOfMoves = 0;
+		game->started = false;
+		game->timeManager.SetMoveTime(this->config.timeLimit);
+		game->timeManager.SetGameTime(this->config.gameTime);
+		game->job.timeManager = &game->timeManager;
+		this->games.push_back(game);
+		cout << "Game " << game->id << ": Connected to Kalaha server as player " << game->player << endl;
+	}
+
+	return (unsigned int)this->games.size();
+}
+
+void MultiGameClient::Run()
+{
+	ostringstream out;
+	out << "Playing " << this->games.size() << " games with " << this->enginePool->GetNrOfWorkers() << " search threads." << endl;
+	this->logger.Print(out.str());
+	DWORD startTime = timeGetTime();
+	unsigned int nrOfActiveGames = (unsigned int)this->games.size();
+	while(nrOfActiveGames > 0)
+	{
+		DWORD now = timeGetTime();
+		DWORD waitTime = this->config.sleepTime;
+		bool searching = false;
+		fd_set readSet;
+		FD_ZERO(&readSet);
+		int maxSocket = -1;
+
+		// Advance the games that don't wait for the server.
+		for(unsigned int i = 0; i < this->games.size(); i++)
+		{
+			GameSession* game = this->games[i];
+			if(game->state == GAME_STATE_SEARCHING && game->job.done)
+			{
+				this->SendMove(game);
+			}
+			if(game->state == GAME_STATE_WAITING && (int)(game->nextPollTime - now) <= 0)
+			{
+				this->Poll(game);
+			}
+
+			if(game->state == GAME_STATE_POLLING || game->state == GAME_STATE_NEW_ROUND)
+			{
+				FD_SET(game->server->GetSocket(), &readSet);
+				maxSocket = max(maxSocket, game->server->GetSocket());
+			}
+			else if(game->state == GAME_STATE_SEARCHING)
+			{
+				searching = true;
+			}
+			else if(game->state == GAME_STATE_WAITING)
+			{
+				waitTime = min(waitTime, game->nextPollTime - now);
+			}
+		}
+		if(searching)
+		{
+			waitTime = 1; // Check for finished searches often.
+		}
+
+		// Wait for responses, or until a game needs attention.
+		if(maxSocket >= 0)
+		{
+			timeval timeout;
+			timeout.tv_sec = waitTime / 1000;
+			timeout.tv_usec = (waitTime % 1000) * 1000;
+			int nrOfReadySockets;
+			{
+				ScopedSpan span("Wait");
+				nrOfReadySockets = select(maxSocket + 1, &readSet, nullptr, nullptr, &timeout);
+			}
+			if(nrOfReadySockets > 0)
+			{
+				for(unsigned int i = 0; i < this->games.size(); i++)
+				{
+					GameSession* game = this->games[i];
+					if((game->state != GAME_STATE_POLLING && game->state != GAME_STATE_NEW_ROUND) || !FD_ISSET(game->server->GetSocket(), &readSet))
+					{
+						continue;
+					}
+					if(!game->server->ReceiveAvailable())
+					{
+						this->Finish(game, "Lost the connection to the server.");
+						continue;
+					}
+					unsigned short length = 0;
+					const char* response = nullptr;
+					while((game->state == GAME_STATE_POLLING || game->state == GAME_STATE_NEW_ROUND) && 
+						(response = game->server->NextReceived(length)) != nullptr)
+					{
+						this->HandleResponse(game, response, length);
+					}
+				}
+			}
+		}
+		else if(waitTime > 0)
+		{
+			ScopedSpan span("Sleep");
+			Sleep(waitTime);
+		}
+
+		nrOfActiveGames = 0;
+		for(unsigned int i = 0; i < this->games.size(); i++)
+		{
+			if(this->games[i]->state != GAME_STATE_FINISHED)
+			{
+				nrOfActiveGames++;
+			}
+		}
+	}
+
+	// Summary.
+	DWORD timeElapsed = max(timeGetTime() - startTime, (DWORD)1);
+	unsigned int nrOfRounds = 0;
+	unsigned int nrOfWins = 0;
+	unsigned int nrOfDraws = 0;
+	unsigned int nrOfMoves = 0;
+	for(unsigned int i = 0; i < this->games.size(); i++)
+	{
+		GameSession* game = this->games[i];
+		nrOfWins += game->nrOfVictories[game->player - 1];
+		nrOfDraws += game->nrOfDraws;
+		nrOfRounds += game->nrOfVictories[0] + game->nrOfVictories[1] + game->nrOfDraws;
+		nrOfMoves += game->nrOfMoves;
+	}
+	out.str("");
+	out << endl;
+	out << "Played " << nrOfRounds << " rounds (won " << nrOfWins << ", draw " << nrOfDraws << ", lost " << nrOfRounds - nrOfWins - nrOfDraws << ") ";
+	out << "in " << timeElapsed / 1000.0f << " s, " << (unsigned int)(3600000.0 * nrOfRounds / timeElapsed) << " rounds/hour, ";
+	out << nrOfMoves << " moves." << endl;
+	this->logger.Print(out.str());
+}
+
+void MultiGameClient::Poll(GameSession* game)
+{
+	// Ask who has won, whose turn it is and for the board in a single round trip.
+	game->server->Queue("WINNER\n");
+	game->server->Queue("PLAYER\n");
+	game->server->Queue("BOARD\n");
+	game->nrOfPollResponses = 0;
+	game->state = GAME_STATE_POLLING;
+	game->pollStartTime = this->metrics.GetTime();
+	if(!game->server->Flush())
+	{
+		this->Finish(game, "Lost the connection to the server.");
+	}
+}
+
+void MultiGameClient::HandleResponse(GameSession* game, const char* response, unsigned short length)
+{
+	if(game->state == GAME_STATE_NEW_ROUND)
+	{
+		game->state = GAME_STATE_WAITING;
+		game->nextPollTime = timeGetTime();
+		return;
+	}
+
+	int errorCode = ParseErrorCode(response, length);
+	if(game->movePending)
+	{
+		// The response to our last move.
+		game->movePending = false;
+		if(errorCode != -1)
+		{
+			this->logger.Print("Game " + to_string(game->id) + ": " + ErrorCodeToString((ERROR_CODE)errorCode) + "\n");
+		}
+		return;
+	}
+
+	switch(game->nrOfPollResponses++)
+	{
+		case 0: // WINNER
+			game->winner = (errorCode != -1 || response[0] == '-') ? -1 : response[0] - '0';
+		break;
+		case 1: // PLAYER
+			game->nextToMove = (errorCode != -1) ? -1 : response[0] - '0';
+		break;
+		case 2: // BOARD
+			game->validBoard = ParseBoard(response, length, game->ambos);
+			this->metrics.RecordRoundTrip(game->pollStartTime);
+			if(!game->started)
+			{
+				GameRecordStart record = {GAME_RECORD_START, (unsigned short)game->id, (unsigned char)game->player, this->logger.GetTime()};
+				this->logger.Record(&record, sizeof(record));
+				game->started = true;
+			}
+			this->HandlePoll(game);
+		break;
+	}
+	if(errorCode != -1)
+	{
+		this->logger.Print("Game " + to_string(game->id) + ": " + ErrorCodeToString((ERROR_CODE)errorCode) + "\n");
+	}
+}
+
+void MultiGameClient::HandlePoll(GameSession* game)
+{
+	if(game->winner == -1)
+	{
+		// The opponent's move may end the game after the winner was polled, then the next poll tells the winner.
+		if(game->nextToMove == game->player && game->validBoard && Board(game->ambos).IsTerminalState() == -1)
+		{
+			// Max (us) is always assumed to be the first player.
+			game->job.board = Board(game->ambos);
+			if(game->player == 2)
+			{
+				game->job.board.Swap();
+			}
+			this->enginePool->Submit(&game->job);
+			game->state = GAME_STATE_SEARCHING;
+		}
+		else
+		{
+			game->state = GAME_STATE_WAITING;
+			game->nextPollTime = timeGetTime() + this->config.sleepTime;
+		}
+		return;
+	}
+
+	string winnerStr = "";
+	if(game->winner == game->player)
+	{
+		winnerStr = "you";
+		game->nrOfVictories[game->player - 1]++;
+	}
+	else if(game->winner == 0)
+	{
+		winnerStr = "none";
+		game->nrOfDraws++;
+	}
+	else
+	{
+		winnerStr = "opponent";
+		game->nrOfVictories[2 - game->player]++;
+	}
+	ostringstream out;
+	out << "Game " << game->id << ": Player " << (int)game->winner << "(" << winnerStr << ") won this round! ";
+	if(game->validBoard)
+	{
+		out << "Score " << (int)game->ambos[AMBO_PLAYER_COUNT] << " - " << (int)game->ambos[AMBO_COUNT - 1] << ".";
+	}
+	out << endl;
+	this->logger.Print(out.str());
+
+	GameRecordEnd record = {GAME_RECORD_END, (unsigned short)game->id, game->winner, {0, 0}, this->logger.GetTime()};
+	if(game->validBoard)
+	{
+		record.score[0] = game->ambos[AMBO_PLAYER_COUNT];
+		record.score[1] = game->ambos[AMBO_COUNT - 1];
+	}
+	this->logger.Record(&record, sizeof(record));
+	game->started = false;
+
+	if(game->nrOfVictories[0] + game->nrOfVictories[1] < this->config.nrOfGames)
+	{
+		// Play again.
+		game->timeManager.StartGame();
+		game->server->Queue("NEW\n");
+		game->state = GAME_STATE_NEW_ROUND;
+		if(!game->server->Flush())
+		{
+			this->Finish(game, "Lost the connection to the server.");
+		}
+	}
+	else
+	{
+		this->Finish(game, "All rounds played.");
+	}
+}
+
+void MultiGameClient::SendMove(GameSession* game)
+{
+	char output[10];
+	output[0] = 'M';
+	output[1] = 'O';
+	output[2] = 'V';
+	output[3] = 'E';
+	output[4] = ' ';
+	output[5] = game->job.move + '1';
+	output[6] = ' ';
+	output[7] = (char)game->player + '0';
+	output[8] = '\n';
+	output[9] = '\0';
+	game->server->Queue(output);
+	game->movePending = true;
+	game->nrOfMoves++;
+
+	GameRecordMove record = {GAME_RECORD_MOVE, (unsigned short)game->id};
+	memcpy(record.ambos, game->ambos, AMBO_COUNT);
+	record.amboIndex = (unsigned char)game->job.move;
+	record.searchTime = (unsigned short)min(game->job.searchTime, (unsigned int)USHRT_MAX);
+	record.depth = game->job.depth;
+	record.nrOfNodes = game->job.nrOfNodes;
+	this->logger.Record(&record, sizeof(record));
+
+	// Poll right away, it may be our turn again. The move is sent together with the poll.
+	this->Poll(game);
+}
+
+void MultiGameClient::Finish(GameSession* game, const char* reason)
+{
+	this->logger.Print("Game " + to_string(game->id) + ": " + reason + "\n");
+	closesocket(game->server->GetSocket());
+	game->state = GAME_STATE_FINISHED;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Config.h"
+#include "EnginePool.h"
+#include "Logger.h"
+#include "Protocol.h"
+#include "Metrics.h"
+
+enum GAME_STATE
+{
+	GAME_STATE_WAITING		= 0, // Waiting until it is time to poll the server again.
+	GAME_STATE_POLLING		= 1, // Waiting for the responses to WINNER, PLAYER and BOARD.
+	GAME_STATE_SEARCHING	= 2, // Waiting for the engine pool to find our move.
+	GAME_STATE_NEW_ROUND	= 3, // Waiting for the response to NEW.
+	GAME_STATE_FINISHED		= 4
+};
+
+/*
+	A game played on one connection to the server.
+*/
+struct GameSession
+{
+	unsigned int id;
+	ServerConnection* server;
+	int player;
+	GAME_STATE state;
+	DWORD nextPollTime;
+	bool movePending; // The response to our last move comes before the responses of the poll.
+	unsigned char nrOfPollResponses; // Received responses of the current poll.
+	char winner;
+	int nextToMove;
+	unsigned char ambos[AMBO_COUNT];
+	bool validBoard;
+	unsigned long long pollStartTime; // For the round-trip time of the poll.
+	SearchJob job;
+	TimeManager timeManager;
+	unsigned int nrOfVictories[2];
+	unsigned int nrOfDraws;
+	unsigned int nrOfMoves;
+	bool started; // The start of the current round has been recorded.
+};
+
+/*
+	Plays several games at the same time from one thread, one connection per game.
+	The sockets are multiplexed with select(...), and the searches are handed to a shared EnginePool.
+*/
+class MultiGameClient
+{
+	private:
+		const Config& config;
+		Logger& logger;
+		Metrics& metrics;
+		std::vector<GameSession*> games;
+		EnginePool* enginePool;
+
+		void Poll(GameSession* game);
+		void HandleResponse(GameSession* game, const char* response, unsigned short length);
+		void HandlePoll(GameSession* game);
+		void SendMove(GameSession* game);
+		void Finish(GameSession* game, const char* reason);
+
+	public:
+		MultiGameClient(const Config& config, Logger& logger, Metrics& metrics);
+		virtual ~MultiGameClient();
+
+		/*
+			Opens config.nrOfConnections connections to the server.
+			Returns the number of games that could be joined.
+		*/
+		unsigned int Connect();
+		/*
+			Plays config.nrOfGames rounds on every connection, then prints a summary.
+		*/
+		void Run();
+};
@@ -5,9 +5,10 @@
 
 Node::Node()
 {
-	this->board = nullptr;
 	this->utility = 0;	
 	this->nrOfChildren = 0;	
+	this->expanded = false;
+	this->extraTurnChildren = 0;
 	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
 	{
 		this->children[i] = nullptr;
@@ -15,40 +16,16 @@ Node::Node()
 }
 Node::Node(const Board& board)
 {
-	this->board = new Board(board);
+	this->board = board;
 	this->utility = 0;	
 	this->nrOfChildren = 0;	
+	this->expanded = false;
+	this->extraTurnChildren = 0;
 	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
 	{
 		this->children[i] = nullptr;
 	}
 }
-Node::Node(const Node& node)
-{
-	this->board = new Board(*node.board);
-	this->utility = node.utility;	
-	this->nrOfChildren = node.nrOfChildren;	
-	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
-	{
-		this->children[i] = node.children[i];
-	}
-}
-Node::~Node()
-{
-	if(this->board)
-	{
-		delete this->board;
-		this->board = nullptr;
-	}
-	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
-	{
-		if(this->children[i])
-		{
-			// Don't invoke the destructor of the children as they are deleted externally.
-			this->children[i] = nullptr;
-		}
-	}
-}
 
 bool Node::IsLeaf() const
 {
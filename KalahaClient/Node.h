@@ -2,23 +2,28 @@
 
 #include "Board.h"
 
+/*
+	A node of the game tree. Trivially copyable, the board is stored in the node instead of in an allocation of its own.
+*/
 class Node
 {
 	public: 
-		Board*			board;		
+		Board			board;		
 		char			utility;	
 		unsigned char	nrOfChildren;	
 		Node*			children[AMBO_PLAYER_COUNT];
+		bool			expanded;			// True once the children have been generated. Kept nodes are not generated again by later searches.
+		unsigned char	extraTurnChildren;	// Bit i is set if the move to child i gives the player an extra turn.
 																		
 	public:
 		Node();
 		Node(const Board& board);
-		Node(const Node& node);
-		virtual~Node();
 
 		/*
 			Checks whether or not this node has any children.
 			Returns true if node is a parent, else false.
 		*/
 		bool IsLeaf() const;
-};
\ No newline at end of file
+};
+
+static_assert(std::is_trivially_copyable<Node>::value, "Node is copied as plain memory.");
\ No newline at end of file
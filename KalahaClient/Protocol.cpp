@@ -0,0 +1,323 @@
+#include "Protocol.h"
+#include "SpanTrace.h"
+
+#include <winsock.h>
+#include <string.h>
+#include <limits.h>
+
+LineReader::LineReader()
+{
+	this->Clear();
+}
+
+char* LineReader::GetWritePointer(unsigned short& size)
+{
+	// Move the unread bytes to the front to make room.
+	if(this->start > 0)
+	{
+		memmove(this->buffer, this->buffer + this->start, this->end - this->start);
+		this->end -= this->start;
+		this->scanned -= this->start;
+		this->start = 0;
+	}
+	size = PROTOCOL_BUFFER_SIZE - this->end;
+	return this->buffer + this->end;
+}
+
+void LineReader::Commit(unsigned short nrOfBytes)
+{
+	this->end += nrOfBytes;
+}
+
+unsigned short LineReader::Feed(const char* data, unsigned short size)
+{
+	unsigned short freeSize = 0;
+	char* writePointer = this->GetWritePointer(freeSize);
+	if(size > freeSize)
+	{
+		size = freeSize;
+	}
+	memcpy(writePointer, data, size);
+	this->Commit(size);
+	return size;
+}
+
+const char* LineReader::NextLine(unsigned short& length)
+{
+	char* lineEnd = (char*)memchr(this->buffer + this->scanned, '\n', this->end - this->scanned);
+	if(!lineEnd)
+	{
+		this->scanned = this->end;
+		if(this->start > 0 || this->end < PROTOCOL_BUFFER_SIZE)
+		{
+			return nullptr; // Wait for more bytes.
+		}
+		// The buffer is full of one line without an ending, return it as it is.
+		lineEnd = this->buffer + this->end;
+	}
+
+	char* line = this->buffer + this->start;
+	length = (unsigned short)(lineEnd - line);
+	this->start = (unsigned short)(lineEnd - this->buffer);
+	if(this->start < this->end)
+	{
+		this->start++; // Skip the '\n'.
+	}
+	this->scanned = this->start;
+	if(length > 0 && line[length - 1] == '\r')
+	{
+		length--;
+	}
+	line[length] = '\0';
+	return line;
+}
+
+void LineReader::Clear()
+{
+	this->start = 0;
+	this->end = 0;
+	this->scanned = 0;
+	this->buffer[0] = '\0';
+}
+
+bool ParseBoard(const char* line, unsigned short length, unsigned char ambos[AMBO_COUNT])
+{
+	// The first value is player 2's kalah, the rest are in the same order as in Board.
+	unsigned char amboIndex = AMBO_COUNT - 1;
+	unsigned char nrOfValues = 0;
+	unsigned short value = 0;
+	unsigned char nrOfDigits = 0;
+	for(unsigned short i = 0; i <= length; i++)
+	{
+		char c = (i < length) ? line[i] : ';'; // The trailing ';' is optional.
+		if(c >= '0' && c <= '9')
+		{
+			value = value * 10 + (c - '0');
+			if(++nrOfDigits > 3 || value > UCHAR_MAX)
+			{
+				return false;
+			}
+		}
+		else if(c == ';')
+		{
+			if(nrOfDigits == 0)
+			{
+				if(i == length && nrOfValues == AMBO_COUNT)
+				{
+					break; // The board ended with a ';'.
+				}
+				return false;
+			}
+			if(nrOfValues == AMBO_COUNT)
+			{
+				return false; // Too many values.
+			}
+			ambos[amboIndex] = (unsigned char)value;
+			amboIndex = (nrOfValues == 0) ? 0 : amboIndex + 1;
+			nrOfValues++;
+			value = 0;
+			nrOfDigits = 0;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return nrOfValues == AMBO_COUNT;
+}
+
+int ParseErrorCode(const char* line, unsigned short length)
+{
+	static const char prefix[] = "ERROR ";
+	static const unsigned short prefixLength = sizeof(prefix) - 1;
+	if(length <= prefixLength || memcmp(line, prefix, prefixLength) != 0)
+	{
+		return -1;
+	}
+
+	// Select the only possible code from a few characters, then verify it with one comparison.
+	const char* code = line + prefixLength;
+	unsigned short codeLength = length - prefixLength;
+	int errorCode = -1;
+	const char* expected = "";
+	switch(code[0])
+	{
+		case 'G':
+			errorCode = (codeLength > 5 && code[5] == 'N') ? ERROR_GAME_NOT_FULL : ERROR_GAME_FULL;
+			expected = (errorCode == ERROR_GAME_FULL) ? "GAME_FULL" : "GAME_NOT_FULL";
+		break;
+		case 'A':
+			if(codeLength > 1 && code[1] == 'M')
+			{
+				errorCode = ERROR_AMBO_EMPTY;
+				expected = "AMBO_EMPTY";
+			}
+			else
+			{
+				errorCode = (codeLength > 3 && code[3] == 'L') ? ERROR_ARGLENGTH_NOT_VALID : ERROR_ARGTYPE_NOT_VALID;
+				expected = (errorCode == ERROR_ARGLENGTH_NOT_VALID) ? "ARGLENGTH_NOT_VALID" : "ARGTYPE_NOT_VALID";
+			}
+		break;
+		case 'P':
+			errorCode = ERROR_PLAYER_OUT_OF_TURN;
+			expected = "PLAYER_OUT_OF_TURN";
+		break;
+		case 'C':
+			errorCode = ERROR_CMD_NOT_FOUND;
+			expected = "CMD_NOT_FOUND";
+		break;
+		default: 
+			return -1;
+		break;
+	}
+
+	// Anything after the code (e.g. whitespace) is ignored.
+	unsigned short expectedLength = (unsigned short)strlen(expected);
+	if(codeLength < expectedLength || memcmp(code, expected, expectedLength) != 0)
+	{
+		return -1;
+	}
+	return errorCode;
+}
+
+string ErrorCodeToString(ERROR_CODE errorCode)
+{
+	switch (errorCode)
+	{
+		case ERROR_GAME_FULL: 
+			return "Can't connect to server: Game is full."; 
+		break;
+		case ERROR_GAME_NOT_FULL: 
+			return "Can't make a move: Only one client connected."; 
+		break;
+		case ERROR_ARGLENGTH_NOT_VALID: 
+			return "Invalid command format. Too few or too many arguments."; 
+		break;
+		case ERROR_ARGTYPE_NOT_VALID: 
+			return "Invalid command format. Usually caused by expecting an integer but received a string."; 
+		break;
+		case ERROR_PLAYER_OUT_OF_TURN:
+			return "Not your turn!"; 
+		break;
+		case ERROR_CMD_NOT_FOUND:
+			return "Unknown command."; 
+		break;
+		case ERROR_AMBO_EMPTY: 
+			return "Can't make a move from an empty ambo!"; 
+		break;
+		default: return "Unknown. Maybe the server is dead."; break;
+	}
+}
+
+const char* ReceiveLine(int socket, LineReader& reader, unsigned short& length)
+{
+	const char* line = reader.NextLine(length);
+	while(!line)
+	{
+		unsigned short size = 0;
+		char* writePointer = reader.GetWritePointer(size);
+		int nrOfBytes = recv(socket, writePointer, size, 0);
+		if(nrOfBytes <= 0)
+		{
+			return nullptr;
+		}
+		reader.Commit((unsigned short)nrOfBytes);
+		line = reader.NextLine(length);
+	}
+
+	return line;
+}
+
+ServerConnection::ServerConnection(int socket)
+{
+	this->socket = socket;
+	this->sendLength = 0;
+	this->nrOfPendingResponses = 0;
+}
+
+bool ServerConnection::Queue(const char* command)
+{
+	unsigned short commandLength = (unsigned short)strlen(command);
+	if(this->sendLength + commandLength > PROTOCOL_BUFFER_SIZE)
+	{
+		return false;
+	}
+	memcpy(this->sendBuffer + this->sendLength, command, commandLength);
+	this->sendLength += commandLength;
+	this->nrOfPendingResponses++;
+	return true;
+}
+
+bool ServerConnection::Flush()
+{
+	if(this->sendLength == 0)
+	{
+		return true;
+	}
+	ScopedSpan span("Send");
+	unsigned short sent = 0;
+	while(sent < this->sendLength)
+	{
+		int nrOfBytes = send(this->socket, this->sendBuffer + sent, this->sendLength - sent, 0);
+		if(nrOfBytes <= 0)
+		{
+			return false;
+		}
+		sent += (unsigned short)nrOfBytes;
+	}
+	this->sendLength = 0;
+	return true;
+}
+
+const char* ServerConnection::Receive(unsigned short& length)
+{
+	if(this->nrOfPendingResponses == 0 || !this->Flush())
+	{
+		return nullptr;
+	}
+	ScopedSpan span("Receive");
+	const char* line = ReceiveLine(this->socket, this->reader, length);
+	if(line)
+	{
+		this->nrOfPendingResponses--;
+	}
+	return line;
+}
+
+bool ServerConnection::ReceiveAvailable()
+{
+	ScopedSpan span("Receive");
+	unsigned short size = 0;
+	char* writePointer = this->reader.GetWritePointer(size);
+	int nrOfBytes = recv(this->socket, writePointer, size, 0);
+	if(nrOfBytes <= 0)
+	{
+		return false;
+	}
+	this->reader.Commit((unsigned short)nrOfBytes);
+	return true;
+}
+
+const char* ServerConnection::NextReceived(unsigned short& length)
+{
+	if(this->nrOfPendingResponses == 0)
+	{
+		return nullptr;
+	}
+	const char* line = this->reader.NextLine(length);
+	if(line)
+	{
+		this->nrOfPendingResponses--;
+	}
+	return line;
+}
+
+const char* ServerConnection::Request(const char* command, unsigned short& length)
+{
+	if(!this->Queue(command))
+	{
+		return nullptr;
+	}
+	return this->Receive(length);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Board.h"
+
+static const unsigned short PROTOCOL_BUFFER_SIZE = 256; // Bytes buffered per connection. A response line never comes close to this.
+
+enum ERROR_CODE
+{
+	ERROR_GAME_FULL				= 0,
+	ERROR_GAME_NOT_FULL			= 1,
+	ERROR_ARGLENGTH_NOT_VALID	= 2,
+	ERROR_ARGTYPE_NOT_VALID		= 3,
+	ERROR_PLAYER_OUT_OF_TURN	= 4,
+	ERROR_CMD_NOT_FOUND			= 5,
+	ERROR_AMBO_EMPTY			= 6
+};
+
+/*
+	Splits the byte stream of a connection into lines without allocating memory.
+	A line ends with '\n', a '\r' before it is removed. A response split over several reads is put together,
+	and several responses received in one read are returned one at a time.
+*/
+class LineReader
+{
+	private:
+		char buffer[PROTOCOL_BUFFER_SIZE + 1]; // + 1 for the terminating null of a line filling the whole buffer.
+		unsigned short start;	// Index of the first byte not yet returned as (part of) a line.
+		unsigned short end;		// Index after the last received byte.
+		unsigned short scanned;	// Index of the first byte not yet searched for a line ending.
+
+	public:
+		LineReader();
+
+		/*
+			Returns where the next received bytes should be written, size is set to the number of bytes that fit.
+			Call Commit(...) with the number of bytes actually written.
+		*/
+		char* GetWritePointer(unsigned short& size);
+		void Commit(unsigned short nrOfBytes);
+		/*
+			Copies received bytes into the buffer. Returns the number of bytes that fit.
+		*/
+		unsigned short Feed(const char* data, unsigned short size);
+		/*
+			Returns the next complete line, null-terminated and without the line ending, or nullptr if there is none yet.
+			A full buffer without a line ending is returned as one line, so that a malformed response can't block the reader.
+			The line is valid until the next call to a non-const function of the reader.
+		*/
+		const char* NextLine(unsigned short& length);
+		/*
+			Discards all buffered bytes.
+		*/
+		void Clear();
+};
+
+/*
+	Parses a BOARD response in place ("kalah2;player1 ambos 1-6;kalah1;player2 ambos 1-6;") into the ambos array 
+	(same order as in Board). 
+	Returns false, leaving ambos unspecified, if the line is not a valid board.
+*/
+bool ParseBoard(const char* line, unsigned short length, unsigned char ambos[AMBO_COUNT]);
+/*
+	Classifies an "ERROR <code>" response in a single pass.
+	Returns one of ERROR_CODE, or -1 if the line is not an error response.
+*/
+int ParseErrorCode(const char* line, unsigned short length);
+/*
+	Returns a description of the error.
+*/
+string ErrorCodeToString(ERROR_CODE errorCode);
+/*
+	Receives from the socket until the reader has a complete line.
+	Returns the line (see LineReader::NextLine(...)), or nullptr if the connection was closed or failed.
+*/
+const char* ReceiveLine(int socket, LineReader& reader, unsigned short& length);
+
+/*
+	A connection to the server that pipelines commands. 
+	Queued commands are sent together in one send call, and their responses are received in the same order.
+*/
+class ServerConnection
+{
+	private:
+		int socket;
+		LineReader reader;
+		char sendBuffer[PROTOCOL_BUFFER_SIZE];
+		unsigned short sendLength;
+		unsigned char nrOfPendingResponses; // Commands sent or queued, whose response has not been received yet.
+
+	public:
+		ServerConnection(int socket);
+
+		/*
+			Adds a command (ending with '\n') to be sent with the next Flush().
+			Returns false if there is no room for it.
+		*/
+		bool Queue(const char* command);
+		/*
+			Sends all queued commands. Returns false if the connection failed.
+		*/
+		bool Flush();
+		/*
+			Returns the response to the oldest command, sending queued commands first if needed. 
+			Returns nullptr if the connection was closed or failed, or if no command is waiting for a response.
+			The response is valid until the next call to a non-const function.
+		*/
+		const char* Receive(unsigned short& length);
+		/*
+			Receives the bytes that are available on the socket, without waiting for more (call when select(...) reports the socket as readable).
+			Returns false if the connection was closed or failed.
+		*/
+		bool ReceiveAvailable();
+		/*
+			Like Receive(...), but only returns a response that has already been received, otherwise nullptr.
+		*/
+		const char* NextReceived(unsigned short& length);
+		/*
+			Queues a command and returns its response. Responses to earlier commands must have been received.
+		*/
+		const char* Request(const char* command, unsigned short& length);
+
+		unsigned char GetNrOfPendingResponses() const { return this->nrOfPendingResponses; }
+		int GetSocket() const { return this->socket; }
+};
@@ -0,0 +1,296 @@
+#include "ProtocolBenchmark.h"
+
+#include <Windows.h>
+#include <iostream>
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+// Responses that must not be accepted as a board.
+static const char* MALFORMED_BOARDS[] = 
+{
+	"",
+	";",
+	"0;6;6;6;6;6;6;0;6;6;6;6;6",				// Too few values.
+	"0;6;6;6;6;6;6;0;6;6;6;6;6;6;6;",			// Too many values.
+	"0;6;6;6;6;6;6;0;6;6;6;6;;6;",				// Empty value.
+	"0;6;6;6;6;6;6;0;6;6;6;6;6;6;;",			// Empty value at the end.
+	";0;6;6;6;6;6;6;0;6;6;6;6;6;6",				// Empty first value.
+	"0;6;6;6;6;6;6;0;6;6;6;6;6;256;",			// Value out of range.
+	"0;6;6;6;6;6;6;0;6;6;6;6;6;0006;",			// Too many digits.
+	"0;6;6;6;6;-6;6;0;6;6;6;6;6;6;",			// Sign.
+	"0;6;6;6;6;6;6;0;6;6;6;6;6;6; ",			// Trailing whitespace.
+	"0 ;6;6;6;6;6;6;0;6;6;6;6;6;6;",			// Whitespace.
+	"0;6;6;6;6;6;6;0;6;6;6;6;6;6;\x01",			// Control character.
+	"ERROR CMD_NOT_FOUND",
+	"1",
+	"GAME_FULL"
+};
+
+// Responses that must not be accepted as an error, or be parsed as a different one.
+static const char* ERROR_RESPONSES[] = 
+{
+	"ERROR GAME_FULL",
+	"ERROR GAME_NOT_FULL",
+	"ERROR ARGLENGTH_NOT_VALID",
+	"ERROR ARGTYPE_NOT_VALID",
+	"ERROR PLAYER_OUT_OF_TURN",
+	"ERROR CMD_NOT_FOUND",
+	"ERROR AMBO_EMPTY"
+};
+static const char* NON_ERROR_RESPONSES[] = 
+{
+	"",
+	"ERROR",
+	"ERROR ",
+	"ERROR G",
+	"ERROR GAME_",
+	"ERROR GAME_NOT",
+	"ERROR ARG",
+	"ERROR AMBO",
+	"ERROR XYZ",
+	"ERROR game_full",
+	"error GAME_FULL",
+	" ERROR GAME_FULL",
+	"0;6;6;6;6;6;6;0;6;6;6;6;6;6;",
+	"-1",
+	"1"
+};
+
+static unsigned int Fail(const char* what, const char* line)
+{
+	cout << "Protocol fuzz test failed: " << what << " \"" << line << "\"" << endl;
+	return 1;
+}
+
+// The string based parsing the client used before the Protocol functions.
+static void LegacyParseBoard(const char input[], unsigned char* ambos)
+{
+	string tmpStr = input;
+	unsigned char amboIndex = 0;
+	unsigned char stringStartIndex = 0;
+	while(input[stringStartIndex] != ';')
+	{
+		stringStartIndex++;
+		if(input[stringStartIndex] == ';')
+		{
+			ambos[AMBO_COUNT - 1] = (unsigned char)atoi(tmpStr.substr(0, stringStartIndex).c_str());
+		}
+	}
+	stringStartIndex++;
+	for(unsigned char i = stringStartIndex; input[i] != '\0'; i++)
+	{
+		if(input[i] == ';')
+		{
+			ambos[amboIndex++] = (unsigned char)atoi(tmpStr.substr(stringStartIndex, i - stringStartIndex).c_str());
+			stringStartIndex = i + 1;
+		}
+	}
+}
+static int LegacyErrorCode(const char input[])
+{
+	string tmp = input;
+	for(int i = 0; i < sizeof(ERROR_RESPONSES) / sizeof(ERROR_RESPONSES[0]); i++)
+	{
+		if(tmp.find(ERROR_RESPONSES[i]) != -1)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+// Writes a BOARD response for ambos, without line ending. Returns its length.
+static unsigned short MakeBoardResponse(const unsigned char ambos[AMBO_COUNT], char* out)
+{
+	int length = sprintf(out, "%d;", ambos[AMBO_COUNT - 1]);
+	for(unsigned char i = 0; i < AMBO_COUNT - 1; i++)
+	{
+		length += sprintf(out + length, "%d;", ambos[i]);
+	}
+	return (unsigned short)length;
+}
+
+static double ElapsedMS(const LARGE_INTEGER& start, const LARGE_INTEGER& frequency)
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return (double)(now.QuadPart - start.QuadPart) * 1000.0 / (double)frequency.QuadPart;
+}
+
+void RunProtocolBenchmark(unsigned int nrOfIterations)
+{
+	static const unsigned char NR_OF_BOARDS = 64;
+	char boards[NR_OF_BOARDS][PROTOCOL_BUFFER_SIZE];
+	unsigned short lengths[NR_OF_BOARDS];
+	srand(0);
+	for(unsigned char i = 0; i < NR_OF_BOARDS; i++)
+	{
+		unsigned char ambos[AMBO_COUNT];
+		for(unsigned char j = 0; j < AMBO_COUNT; j++)
+		{
+			ambos[j] = (unsigned char)(rand() % 30);
+		}
+		lengths[i] = MakeBoardResponse(ambos, boards[i]);
+	}
+
+	LARGE_INTEGER frequency, start;
+	QueryPerformanceFrequency(&frequency);
+	unsigned int checksum = 0;
+	unsigned char ambos[AMBO_COUNT];
+
+	QueryPerformanceCounter(&start);
+	for(unsigned int i = 0; i < nrOfIterations; i++)
+	{
+		LegacyParseBoard(boards[i % NR_OF_BOARDS], ambos);
+		checksum += ambos[i % AMBO_COUNT];
+	}
+	double legacyBoardTime = ElapsedMS(start, frequency);
+
+	QueryPerformanceCounter(&start);
+	for(unsigned int i = 0; i < nrOfIterations; i++)
+	{
+		ParseBoard(boards[i % NR_OF_BOARDS], lengths[i % NR_OF_BOARDS], ambos);
+		checksum += ambos[i % AMBO_COUNT];
+	}
+	double boardTime = ElapsedMS(start, frequency);
+
+	// Most responses to PLAYER, WINNER and MOVE are not errors, so mix both.
+	static const char* responses[] = {"1", "2", "-1", "ERROR AMBO_EMPTY", "0", "ERROR PLAYER_OUT_OF_TURN"};
+	static const unsigned char nrOfResponses = sizeof(responses) / sizeof(responses[0]);
+	unsigned short responseLengths[nrOfResponses];
+	for(unsigned char i = 0; i < nrOfResponses; i++)
+	{
+		responseLengths[i] = (unsigned short)strlen(responses[i]);
+	}
+
+	QueryPerformanceCounter(&start);
+	for(unsigned int i = 0; i < nrOfIterations; i++)
+	{
+		checksum += LegacyErrorCode(responses[i % nrOfResponses]);
+	}
+	double legacyErrorTime = ElapsedMS(start, frequency);
+
+	QueryPerformanceCounter(&start);
+	for(unsigned int i = 0; i < nrOfIterations; i++)
+	{
+		checksum += ParseErrorCode(responses[i % nrOfResponses], responseLengths[i % nrOfResponses]);
+	}
+	double errorTime = ElapsedMS(start, frequency);
+
+	cout << "Parsed " << nrOfIterations << " responses of each kind (checksum " << checksum << ")." << endl;
+	cout << "BOARD: string based " << legacyBoardTime << " ms, ParseBoard " << boardTime << " ms" << endl;
+	cout << "ERROR: string based " << legacyErrorTime << " ms, ParseErrorCode " << errorTime << " ms" << endl;
+}
+
+unsigned int RunProtocolFuzzTest(unsigned int nrOfIterations)
+{
+	unsigned int nrOfFailures = 0;
+	unsigned short length = 0;
+	unsigned char ambos[AMBO_COUNT];
+
+	// Fixed corpus.
+	for(unsigned char i = 0; i < sizeof(MALFORMED_BOARDS) / sizeof(MALFORMED_BOARDS[0]); i++)
+	{
+		if(ParseBoard(MALFORMED_BOARDS[i], (unsigned short)strlen(MALFORMED_BOARDS[i]), ambos))
+		{
+			nrOfFailures += Fail("accepted malformed board", MALFORMED_BOARDS[i]);
+		}
+	}
+	for(unsigned char i = 0; i < sizeof(ERROR_RESPONSES) / sizeof(ERROR_RESPONSES[0]); i++)
+	{
+		if(ParseErrorCode(ERROR_RESPONSES[i], (unsigned short)strlen(ERROR_RESPONSES[i])) != i)
+		{
+			nrOfFailures += Fail("wrong error code for", ERROR_RESPONSES[i]);
+		}
+	}
+	for(unsigned char i = 0; i < sizeof(NON_ERROR_RESPONSES) / sizeof(NON_ERROR_RESPONSES[0]); i++)
+	{
+		if(ParseErrorCode(NON_ERROR_RESPONSES[i], (unsigned short)strlen(NON_ERROR_RESPONSES[i])) != -1)
+		{
+			nrOfFailures += Fail("accepted as error", NON_ERROR_RESPONSES[i]);
+		}
+	}
+
+	// A line without an ending that fills the buffer must not block the reader.
+	LineReader reader;
+	char garbage[PROTOCOL_BUFFER_SIZE];
+	memset(garbage, '7', sizeof(garbage));
+	reader.Feed(garbage, sizeof(garbage));
+	const char* line = reader.NextLine(length);
+	if(!line || length != PROTOCOL_BUFFER_SIZE || ParseBoard(line, length, ambos))
+	{
+		nrOfFailures += Fail("full buffer not returned as a rejected line", "7777...");
+	}
+
+	// Random boards and malformed responses, split and joined at random positions, with random line endings.
+	srand(1);
+	reader.Clear();
+	char stream[PROTOCOL_BUFFER_SIZE * 4];
+	for(unsigned int i = 0; i < nrOfIterations; i++)
+	{
+		unsigned short streamLength = 0;
+		unsigned char expected[4][AMBO_COUNT];
+		bool valid[4];
+		unsigned char nrOfLines = 1 + rand() % 4;
+		for(unsigned char j = 0; j < nrOfLines; j++)
+		{
+			valid[j] = (rand() % 4) != 0;
+			if(valid[j])
+			{
+				for(unsigned char k = 0; k < AMBO_COUNT; k++)
+				{
+					expected[j][k] = (unsigned char)(rand() % 256);
+				}
+				streamLength += MakeBoardResponse(expected[j], stream + streamLength);
+				if(rand() % 2)
+				{
+					streamLength--; // Without the trailing ';'.
+				}
+			}
+			else
+			{
+				const char* malformed = MALFORMED_BOARDS[rand() % (sizeof(MALFORMED_BOARDS) / sizeof(MALFORMED_BOARDS[0]))];
+				unsigned short malformedLength = (unsigned short)strlen(malformed);
+				memcpy(stream + streamLength, malformed, malformedLength);
+				streamLength += malformedLength;
+			}
+			if(rand() % 2)
+			{
+				stream[streamLength++] = '\r';
+			}
+			stream[streamLength++] = '\n';
+		}
+
+		unsigned char lineIndex = 0;
+		unsigned short streamIndex = 0;
+		while(streamIndex < streamLength)
+		{
+			unsigned short chunkSize = 1 + rand() % (streamLength - streamIndex);
+			streamIndex += reader.Feed(stream + streamIndex, chunkSize);
+			while((line = reader.NextLine(length)) != nullptr)
+			{
+				if(lineIndex >= nrOfLines)
+				{
+					nrOfFailures += Fail("too many lines, last", line);
+					break;
+				}
+				bool parsed = ParseBoard(line, length, ambos);
+				if(parsed != valid[lineIndex] || (parsed && memcmp(ambos, expected[lineIndex], AMBO_COUNT) != 0))
+				{
+					nrOfFailures += Fail(valid[lineIndex] ? "rejected or misparsed board" : "accepted malformed board", line);
+				}
+				lineIndex++;
+			}
+		}
+		if(lineIndex != nrOfLines)
+		{
+			nrOfFailures += Fail("lines lost in stream", "");
+			reader.Clear();
+		}
+	}
+
+	cout << "Protocol fuzz test: " << nrOfIterations << " streams, " << nrOfFailures << " failures." << endl;
+	return nrOfFailures;
+}
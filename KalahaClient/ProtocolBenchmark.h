@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Protocol.h"
+
+/*
+	Compares the time it takes to parse BOARD and ERROR responses with the Protocol functions 
+	against the string based parsing previously used by the client, and prints the result.
+*/
+void RunProtocolBenchmark(unsigned int nrOfIterations);
+/*
+	Feeds valid and malformed responses to a LineReader, split and joined in random ways, 
+	and checks that the Protocol functions accept exactly the valid ones.
+	Returns the number of failed checks.
+*/
+unsigned int RunProtocolFuzzTest(unsigned int nrOfIterations);
@@ -0,0 +1,60 @@
+#pragma once
+
+/*
+	The rule variants of Kalah, as compile-time policies of BasicBoard (see Board.h). Each policy is a struct of static
+	inline functions, so the compiler removes the checks of the default rules entirely and a variant costs nothing
+	when it isn't used.
+*/
+
+/*
+	Capture policies: whether the last seed, landing in an empty own ambo, captures given the seeds in the opposite ambo.
+*/
+struct CaptureNonEmptyOpposite
+{
+	static bool Captures(unsigned char nrOfOppositeSeeds) { return nrOfOppositeSeeds > 0; }
+	static const char* GetName() { return "capture non-empty opposite"; }
+};
+
+/*
+	The last seed is put in the kalah even if the opposite ambo is empty.
+*/
+struct CaptureAlways
+{
+	static bool Captures(unsigned char) { return true; }
+	static const char* GetName() { return "capture always"; }
+};
+
+/*
+	Sweep policies: what happens to the seeds left on the board when a side is empty at the end of the game.
+*/
+struct SweepToOwner
+{
+	static const bool SWEEP = true; // The seeds are put in the kalah of the player whose side they are on.
+	static const char* GetName() { return "sweep to owner"; }
+};
+
+struct NoSweep
+{
+	static const bool SWEEP = false; // The seeds stay on the board and don't count.
+	static const char* GetName() { return "no sweep"; }
+};
+
+template<class CapturePolicy, class SweepPolicy>
+struct KalahRules
+{
+	typedef CapturePolicy Capture;
+	typedef SweepPolicy Sweep;
+};
+
+typedef KalahRules<CaptureNonEmptyOpposite, SweepToOwner> StandardRules; // The rules of the Kalaha server.
+typedef KalahRules<CaptureAlways, SweepToOwner> EmptyCaptureRules;
+typedef KalahRules<CaptureNonEmptyOpposite, NoSweep> NoSweepRules;
+typedef KalahRules<CaptureAlways, NoSweep> EmptyCaptureNoSweepRules;
+
+/*
+	The rules the client (its Board and so every search) plays by, chosen at compile time,
+	e.g. with KALAHA_RULES=EmptyCaptureRules in the preprocessor definitions of a tournament build.
+*/
+#ifndef KALAHA_RULES
+	#define KALAHA_RULES StandardRules
+#endif
@@ -0,0 +1,205 @@
+#include "RulesBenchmark.h"
+#include "Minimax.h"
+#include "Solver.h"
+
+#include <Windows.h>
+#include <limits.h>
+#include <string.h>
+
+/*
+	The counts of a rule variant: the perft of the start position at RULES_PERFT_DEPTH, the nodes and utility of its
+	alpha-beta search at RULES_SEARCH_DEPTH and the utility and nodes of the search of RULES_ENDGAME. A change to the board that changes them changes the rules.
+*/
+struct RulesBaseline
+{
+	unsigned long long nrOfPerftNodes;
+	unsigned long long nrOfSearchNodes;
+	int utility;
+	int endgameUtility;
+	unsigned long long nrOfEndgameNodes;
+};
+
+/*
+	Counts the positions reached by all move sequences of the given number of plies (game over ends a sequence).
+	The moves are made and taken back on the board.
+*/
+template<class Rules>
+static unsigned long long Perft(BasicBoard<Rules>& board, bool minTurn, unsigned char depth)
+{
+	if(depth == 0 || board.IsTerminalState() != -1)
+	{
+		return 1;
+	}
+	unsigned long long nrOfNodes = 0;
+	MoveUndo undo;
+	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+	{
+		MoveOutcome outcome = board.MoveSeeds(i, minTurn, undo);
+		if(outcome.IsValid())
+		{
+			nrOfNodes += Perft(board, outcome.extraTurn && !outcome.terminal ? minTurn : !minTurn, depth - 1);
+			board.UndoMove(undo);
+		}
+	}
+	return nrOfNodes;
+}
+
+/*
+	Alpha-beta of the kalah difference (max's - min's seeds), with the same move generation as Minimax.
+	finalScore = Use the utility of Minimax instead: the winner's seeds, negative if min won, 0 for a draw.
+*/
+template<class Rules>
+static int AlphaBeta(BasicBoard<Rules>& board, bool minTurn, unsigned char depth, int alpha, int beta, unsigned long long& nrOfNodes, 
+	bool finalScore = false)
+{
+	nrOfNodes++;
+	if(depth == 0 || board.IsTerminalState() != -1)
+	{
+		int difference = (int)board.GetNrOfSeedsInKalah(0) - board.GetNrOfSeedsInKalah(1);
+		if(!finalScore || difference == 0)
+		{
+			return difference;
+		}
+		return difference > 0 ? board.GetNrOfSeedsInKalah(0) : -board.GetNrOfSeedsInKalah(1);
+	}
+	MoveUndo undo;
+	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT && alpha < beta; i++)
+	{
+		MoveOutcome outcome = board.MoveSeeds(i, minTurn, undo);
+		if(!outcome.IsValid())
+		{
+			continue;
+		}
+		int utility = AlphaBeta(board, outcome.extraTurn && !outcome.terminal ? minTurn : !minTurn, depth - 1, alpha, beta, nrOfNodes, finalScore);
+		board.UndoMove(undo);
+		if(minTurn)
+		{
+			beta = min(beta, utility);
+		}
+		else
+		{
+			alpha = max(alpha, utility);
+		}
+	}
+	return minTurn ? beta : alpha;
+}
+
+/*
+	Runs the perft and the search of a rule variant and prints them. Returns 1 if they differ from the baseline.
+*/
+template<class Rules>
+static unsigned int BenchmarkRules(unsigned char perftDepth, const RulesBaseline& baseline, ostream& out)
+{
+	BasicBoard<Rules> board;
+	BasicBoard<Rules> startBoard = board;
+	out << Rules::Capture::GetName() << ", " << Rules::Sweep::GetName() << ":" << endl;
+
+	LARGE_INTEGER frequency, start, end;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+	unsigned long long nrOfPerftNodes = Perft(board, false, perftDepth);
+	QueryPerformanceCounter(&end);
+	double seconds = (double)(end.QuadPart - start.QuadPart) / frequency.QuadPart;
+	out << "  perft " << (int)perftDepth << ": " << nrOfPerftNodes << " positions in " << (unsigned int)(seconds * 1000) << " ms (";
+	out << (unsigned int)(nrOfPerftNodes / max(seconds, 1e-9) / 1000) << " kpositions/s)" << endl;
+
+	unsigned long long nrOfSearchNodes = 0;
+	QueryPerformanceCounter(&start);
+	int utility = AlphaBeta(board, false, RULES_SEARCH_DEPTH, INT_MIN, INT_MAX, nrOfSearchNodes);
+	QueryPerformanceCounter(&end);
+	seconds = (double)(end.QuadPart - start.QuadPart) / frequency.QuadPart;
+	out << "  alpha-beta " << (int)RULES_SEARCH_DEPTH << ": utility " << utility << ", " << nrOfSearchNodes << " nodes in ";
+	out << (unsigned int)(seconds * 1000) << " ms (" << (unsigned int)(nrOfSearchNodes / max(seconds, 1e-9) / 1000) << " knodes/s)" << endl;
+
+	unsigned char endgameAmbos[AMBO_COUNT];
+	memcpy(endgameAmbos, RULES_ENDGAME, sizeof(endgameAmbos));
+	BasicBoard<Rules> endgame(endgameAmbos);
+	unsigned long long nrOfEndgameNodes = 0;
+	int endgameUtility = AlphaBeta(endgame, false, RULES_ENDGAME_DEPTH, INT_MIN, INT_MAX, nrOfEndgameNodes);
+	out << "  endgame: utility " << endgameUtility << ", " << nrOfEndgameNodes << " nodes" << endl;
+
+	unsigned int nrOfFailures = 0;
+	if(!(board == startBoard))
+	{
+		out << "  The moves were not taken back correctly." << endl;
+		nrOfFailures = 1;
+	}
+	if(perftDepth == RULES_PERFT_DEPTH && (nrOfPerftNodes != baseline.nrOfPerftNodes || nrOfSearchNodes != baseline.nrOfSearchNodes
+		|| utility != baseline.utility || endgameUtility != baseline.endgameUtility
+		|| nrOfEndgameNodes != baseline.nrOfEndgameNodes))
+	{
+		out << "  Differs from the baseline: perft " << baseline.nrOfPerftNodes << ", alpha-beta utility " << baseline.utility;
+		out << ", " << baseline.nrOfSearchNodes << " nodes, endgame utility " << baseline.endgameUtility;
+		out << ", " << baseline.nrOfEndgameNodes << " nodes." << endl;
+		nrOfFailures = 1;
+	}
+	return nrOfFailures;
+}
+
+/*
+	Searches the endgame (as sent by the server) to the end with Minimax (Analyze(...) and Search(...)) and the Solver, which play by the rules 
+	the client is compiled for (KALAHA_RULES), and compares them with the alpha-beta of the same rules.
+	Returns 1 if they differ.
+*/
+static unsigned int CheckEngines(const unsigned char ambos[AMBO_COUNT], ostream& out)
+{
+	out << "Engines, " << KALAHA_RULES::Capture::GetName() << ", " << KALAHA_RULES::Sweep::GetName() << ":" << endl;
+	unsigned char endgameAmbos[AMBO_COUNT];
+	memcpy(endgameAmbos, ambos, sizeof(endgameAmbos));
+	Board endgame(endgameAmbos);
+	unsigned long long nrOfNodes = 0;
+	int expected = AlphaBeta(endgame, false, RULES_ENDGAME_DEPTH, INT_MIN, INT_MAX, nrOfNodes, true);
+	// The utilities of the moves, to check the move of the search.
+	int moveUtilities[AMBO_PLAYER_COUNT];
+	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+	{
+		Board child = endgame;
+		MoveOutcome outcome = child.MoveSeeds(i, 0);
+		moveUtilities[i] = outcome.IsValid() ? AlphaBeta(child, outcome.extraTurn && !outcome.terminal ? false : true, 
+			RULES_ENDGAME_DEPTH - 1, INT_MIN, INT_MAX, nrOfNodes, true) : INT_MIN;
+	}
+
+	Minimax minimax;
+	minimax.SetTimeLimit(SHRT_MAX);
+	int utility = minimax.Analyze(endgame, false, MAX_SEARCH_DEPTH - 1);
+	char move = minimax.Search(endgame, 1);
+	Solver solver;
+	solver.Resize(1);
+	char winningMove;
+	char drawingMove;
+	SOLVER_RESULT win = solver.Solve(endgame, SOLVER_WIN_THRESHOLD, SHRT_MAX, winningMove);
+	SOLVER_RESULT draw = solver.Solve(endgame, SOLVER_DRAW_THRESHOLD, SHRT_MAX, drawingMove);
+	out << "  utility " << expected << ", Minimax " << utility << ", move " << (int)move + 1 << " (" << (move >= 0 ? moveUtilities[move] : 0) << ")";
+	out << ", solver win " << (win == SOLVER_PROVEN ? "proven" : (win == SOLVER_DISPROVEN ? "disproven" : "unknown"));
+	out << ", draw " << (draw == SOLVER_PROVEN ? "proven" : (draw == SOLVER_DISPROVEN ? "disproven" : "unknown")) << endl;
+
+	// The solver proves that max wins (or draws), and then plays a move that keeps it.
+	bool solverCorrect = win == (expected > 0 ? SOLVER_PROVEN : SOLVER_DISPROVEN) && draw == (expected >= 0 ? SOLVER_PROVEN : SOLVER_DISPROVEN)
+		&& (win != SOLVER_PROVEN || moveUtilities[winningMove] > 0) && (draw != SOLVER_PROVEN || moveUtilities[drawingMove] >= 0);
+	if(utility != expected || move < 0 || moveUtilities[move] != expected || !solverCorrect)
+	{
+		out << "  The engines don't follow the rules." << endl;
+		return 1;
+	}
+	return 0;
+}
+
+unsigned int RunRulesBenchmark(unsigned char perftDepth, ostream& out)
+{
+	if(perftDepth == 0)
+	{
+		perftDepth = RULES_PERFT_DEPTH;
+	}
+	const RulesBaseline standardBaseline = {5197521, 2124524, 3, 2, 417};
+	const RulesBaseline emptyCaptureBaseline = {5194136, 2116581, 3, 4, 247};
+	const RulesBaseline noSweepBaseline = {5197521, 2124524, 3, 2, 835};
+	const RulesBaseline emptyCaptureNoSweepBaseline = {5194136, 2116581, 3, 5, 312};
+	unsigned int nrOfFailures = 0;
+	nrOfFailures += BenchmarkRules<StandardRules>(perftDepth, standardBaseline, out);
+	nrOfFailures += BenchmarkRules<EmptyCaptureRules>(perftDepth, emptyCaptureBaseline, out);
+	nrOfFailures += BenchmarkRules<NoSweepRules>(perftDepth, noSweepBaseline, out);
+	nrOfFailures += BenchmarkRules<EmptyCaptureNoSweepRules>(perftDepth, emptyCaptureNoSweepBaseline, out);
+	nrOfFailures += CheckEngines(RULES_ENDGAME, out);
+	nrOfFailures += CheckEngines(RULES_EMPTY_SIDE_ENDGAME, out);
+	return nrOfFailures;
+}
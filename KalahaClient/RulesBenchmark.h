@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Board.h"
+#include <iostream>
+
+static const unsigned char RULES_PERFT_DEPTH = 9; // Plies of the perft baselines, every move (also an extra turn) is a ply.
+static const unsigned char RULES_SEARCH_DEPTH = 12; // Plies of the alpha-beta benchmark.
+// An endgame searched to the end, where the capture and the sweep rules decide the result. As sent by the server.
+static const unsigned char RULES_ENDGAME[AMBO_COUNT] = {0, 0, 1, 0, 1, 1, 33, 2, 1, 0, 3, 0, 1, 29};
+// An endgame where max's side runs empty while min still has seeds, which only count for min with the sweep rule.
+static const unsigned char RULES_EMPTY_SIDE_ENDGAME[AMBO_COUNT] = {0, 1, 0, 1, 0, 3, 31, 0, 0, 0, 1, 1, 0, 34};
+static const unsigned char RULES_ENDGAME_DEPTH = 40;
+
+/*
+	Counts the positions of the perft and times a fixed-depth alpha-beta search from the start position, and solves
+	RULES_ENDGAME, for every rule variant the board is compiled for. The counts are compared to the recorded baselines.
+	Then checks that Minimax and the Solver, compiled for KALAHA_RULES only, solve RULES_ENDGAME and 
+	RULES_EMPTY_SIDE_ENDGAME like the alpha-beta of those rules.
+	perftDepth = 0 uses RULES_PERFT_DEPTH, the only depth with baselines.
+	Returns the number of variants whose counts differ from their baseline.
+*/
+unsigned int RunRulesBenchmark(unsigned char perftDepth, ostream& out);
@@ -0,0 +1,462 @@
+#include "SearchTrace.h"
+#include "GameRecord.h"
+
+#include <iomanip>
+
+SearchTraceWriter::SearchTraceWriter()
+{
+	this->bufferSize = 0;
+	this->nrOfBytes = 0;
+}
+
+SearchTraceWriter::~SearchTraceWriter()
+{
+	this->Close();
+}
+
+bool SearchTraceWriter::Open(const char* fileName)
+{
+	this->Close();
+	this->out.open(fileName, ios::out | ios::binary | ios::trunc);
+	if(!this->out)
+	{
+		return false;
+	}
+	this->nrOfBytes = 0;
+	SearchTraceFile record;
+	record.type = SEARCH_TRACE_FILE;
+	memcpy(record.magic, SEARCH_TRACE_MAGIC, sizeof(SEARCH_TRACE_MAGIC));
+	record.version = SEARCH_TRACE_VERSION;
+	this->Write(record);
+	return true;
+}
+
+void SearchTraceWriter::Flush()
+{
+	if(this->bufferSize > 0 && this->out.is_open())
+	{
+		this->out.write((const char*)this->buffer, this->bufferSize);
+	}
+	this->bufferSize = 0;
+}
+
+bool SearchTraceWriter::Close()
+{
+	if(!this->out.is_open())
+	{
+		return true;
+	}
+	this->Flush();
+	bool written = (bool)this->out;
+	this->out.close();
+	return written;
+}
+
+void SearchTraceWriter::StartIteration(const Board& board, bool minTurn, unsigned char depth)
+{
+	SearchTraceIteration record;
+	record.type = SEARCH_TRACE_ITERATION;
+	memcpy(record.ambos, board.GetAmbos(), sizeof(record.ambos));
+	record.minTurn = minTurn;
+	record.depth = depth;
+	this->Write(record);
+}
+
+void SearchTraceWriter::EnterNode(unsigned char move, unsigned char depth, bool minTurn, char alpha, char beta, bool quiescence)
+{
+	SearchTraceEnter record;
+	record.type = SEARCH_TRACE_ENTER;
+	record.move = move;
+	record.depth = depth;
+	record.alpha = alpha;
+	record.beta = beta;
+	record.flags = (minTurn ? SEARCH_TRACE_MIN_TURN : 0) | (quiescence ? SEARCH_TRACE_QUIESCENCE : 0);
+	this->Write(record);
+}
+
+void SearchTraceWriter::ExitNode(char utility, SEARCH_EXIT reason)
+{
+	SearchTraceExit record;
+	record.type = SEARCH_TRACE_EXIT;
+	record.reason = (unsigned char)reason;
+	record.utility = utility;
+	this->Write(record);
+}
+
+void SearchTraceWriter::Score(unsigned char move, char utility)
+{
+	SearchTraceScore record;
+	record.type = SEARCH_TRACE_SCORE;
+	record.move = move;
+	record.utility = utility;
+	this->Write(record);
+}
+
+void SearchTraceWriter::Cutoff(unsigned char move, unsigned char moveNumber)
+{
+	SearchTraceCutoff record;
+	record.type = SEARCH_TRACE_CUTOFF;
+	record.move = move;
+	record.moveNumber = moveNumber;
+	this->Write(record);
+}
+
+/*
+	Any record of a search trace file.
+*/
+union SearchTraceRecord
+{
+	unsigned char type;
+	SearchTraceFile file;
+	SearchTraceIteration iteration;
+	SearchTraceEnter enter;
+	SearchTraceExit exit;
+	SearchTraceScore score;
+	SearchTraceCutoff cutoff;
+};
+
+/*
+	Reads the next record of the file and checks that the enter and exit records are nested.
+	ply = The number of entered nodes that have not been exited, updated by the record.
+	Returns false at the end of the file or if the file is corrupt (error is then set).
+*/
+static bool ReadTraceRecord(ifstream& in, SearchTraceRecord& record, unsigned int& ply, string& error)
+{
+	char type = 0;
+	if(!in.get(type))
+	{
+		if(ply != 0)
+		{
+			error = "The file ends inside an iteration.";
+		}
+		return false;
+	}
+	unsigned int size = 0;
+	switch(type)
+	{
+		case SEARCH_TRACE_FILE: size = sizeof(SearchTraceFile); break;
+		case SEARCH_TRACE_ITERATION: size = sizeof(SearchTraceIteration); break;
+		case SEARCH_TRACE_ENTER: size = sizeof(SearchTraceEnter); break;
+		case SEARCH_TRACE_EXIT: size = sizeof(SearchTraceExit); break;
+		case SEARCH_TRACE_SCORE: size = sizeof(SearchTraceScore); break;
+		case SEARCH_TRACE_CUTOFF: size = sizeof(SearchTraceCutoff); break;
+		default:
+			error = "Unknown record type " + to_string((int)type) + " at byte " + to_string((long long)in.tellg() - 1) + ".";
+			return false;
+		break;
+	}
+	record.type = (unsigned char)type;
+	in.read((char*)&record + 1, size - 1);
+	if(in.gcount() != (streamsize)(size - 1))
+	{
+		error = "Truncated record.";
+		return false;
+	}
+
+	switch(type)
+	{
+		case SEARCH_TRACE_FILE:
+			if(memcmp(record.file.magic, SEARCH_TRACE_MAGIC, sizeof(SEARCH_TRACE_MAGIC)) != 0 || record.file.version != SEARCH_TRACE_VERSION)
+			{
+				error = "Corrupt or unsupported file header.";
+				return false;
+			}
+		break;
+		case SEARCH_TRACE_ITERATION:
+			if(ply != 0)
+			{
+				error = "An iteration starts inside the previous one.";
+				return false;
+			}
+		break;
+		case SEARCH_TRACE_ENTER:
+			ply++;
+		break;
+		case SEARCH_TRACE_EXIT:
+			if(ply == 0 || record.exit.reason >= SEARCH_EXIT_COUNT)
+			{
+				error = "Exit without a node.";
+				return false;
+			}
+			ply--;
+		break;
+		case SEARCH_TRACE_SCORE:
+		case SEARCH_TRACE_CUTOFF:
+			if(ply == 0)
+			{
+				error = "Event outside of a node.";
+				return false;
+			}
+		break;
+	}
+	return true;
+}
+
+static bool OpenTrace(ifstream& in, const char* fileName, ostream& out)
+{
+	in.open(fileName, ios::in | ios::binary);
+	if(!in)
+	{
+		out << "Failed to open " << fileName << endl;
+		return false;
+	}
+	return true;
+}
+
+/*
+	The counts of the nodes of one ply of an iteration.
+*/
+struct TracePlyStats
+{
+	unsigned long long nrOfNodes;
+	unsigned long long nrOfQuiescenceNodes;
+	unsigned long long nrOfCutoffs;
+	unsigned long long nrOfFirstMoveCutoffs;
+	unsigned long long nrOfExits[SEARCH_EXIT_COUNT];
+};
+
+static void PrintIterationStats(const std::vector<TracePlyStats>& plies, ostream& out)
+{
+	out << "  ply        nodes   quiescence   cutoffs  first  ";
+	for(unsigned char r = 0; r < SEARCH_EXIT_COUNT; r++)
+	{
+		out << setw(14) << SEARCH_EXIT_NAMES[r];
+	}
+	out << endl;
+	for(unsigned int p = 0; p < plies.size(); p++)
+	{
+		const TracePlyStats& ply = plies[p];
+		unsigned int firstMovePercent = ply.nrOfCutoffs > 0 ? (unsigned int)(100 * ply.nrOfFirstMoveCutoffs / ply.nrOfCutoffs) : 0;
+		out << setw(5) << p << setw(13) << ply.nrOfNodes << setw(13) << ply.nrOfQuiescenceNodes << setw(10) << ply.nrOfCutoffs;
+		out << setw(6) << firstMovePercent << "% ";
+		for(unsigned char r = 0; r < SEARCH_EXIT_COUNT; r++)
+		{
+			out << setw(14) << ply.nrOfExits[r];
+		}
+		out << endl;
+	}
+}
+
+bool PrintSearchTraceStats(const char* fileName, ostream& out)
+{
+	ifstream in;
+	if(!OpenTrace(in, fileName, out))
+	{
+		return false;
+	}
+
+	// The statistics are only kept per ply, so the memory used doesn't depend on the size of the tree.
+	std::vector<TracePlyStats> plies;
+	unsigned int nrOfIterations = 0;
+	unsigned long long nrOfNodes = 0;
+	unsigned char depth = 0;
+	char utility = 0;
+	unsigned int ply = 0;
+	string error;
+	SearchTraceRecord record;
+	while(ReadTraceRecord(in, record, ply, error))
+	{
+		switch(record.type)
+		{
+			case SEARCH_TRACE_ITERATION:
+				if(nrOfIterations > 0)
+				{
+					out << "Iteration " << nrOfIterations << " (depth " << (int)depth << "): " << nrOfNodes << " nodes, utility " << (int)utility << "." << endl;
+				}
+				nrOfIterations++;
+				depth = record.iteration.depth;
+				nrOfNodes = 0;
+				plies.clear();
+			break;
+			case SEARCH_TRACE_ENTER:
+				if(plies.size() < ply)
+				{
+					plies.resize(ply, TracePlyStats());
+				}
+				nrOfNodes++;
+				if(record.enter.flags & SEARCH_TRACE_QUIESCENCE)
+				{
+					plies[ply - 1].nrOfQuiescenceNodes++;
+				}
+				else
+				{
+					plies[ply - 1].nrOfNodes++;
+				}
+			break;
+			case SEARCH_TRACE_EXIT:
+				plies[ply].nrOfExits[record.exit.reason]++;
+				if(ply == 0)
+				{
+					utility = record.exit.utility;
+				}
+			break;
+			case SEARCH_TRACE_CUTOFF:
+				plies[ply - 1].nrOfCutoffs++;
+				if(record.cutoff.moveNumber == 1)
+				{
+					plies[ply - 1].nrOfFirstMoveCutoffs++;
+				}
+			break;
+		}
+	}
+	if(nrOfIterations > 0)
+	{
+		out << "Iteration " << nrOfIterations << " (depth " << (int)depth << "): " << nrOfNodes << " nodes, utility " << (int)utility << "." << endl;
+		out << endl << "Last iteration by ply:" << endl;
+		PrintIterationStats(plies, out);
+	}
+	if(!error.empty())
+	{
+		out << error << endl;
+		return false;
+	}
+	return true;
+}
+
+/*
+	A node of a subtree rebuilt from a search trace file.
+*/
+struct TraceNode
+{
+	SearchTraceEnter enter;
+	SearchTraceExit exit;
+	char bestMove; // The latest move that improved the utility, -1 if none.
+	unsigned char cutoffMoveNumber; // 0 if there was no cutoff.
+	std::vector<TraceNode> children; // In the order they were searched, a child searched again is added again.
+};
+
+static void PrintTraceNode(const TraceNode& node, unsigned int indent, ostream& out)
+{
+	out << string(indent * 2, ' ');
+	if(node.enter.move == SEARCH_TRACE_NO_MOVE)
+	{
+		out << "root";
+	}
+	else
+	{
+		out << "move " << (int)node.enter.move;
+	}
+	out << ((node.enter.flags & SEARCH_TRACE_MIN_TURN) ? " min" : " max");
+	if(node.enter.flags & SEARCH_TRACE_QUIESCENCE)
+	{
+		out << " quiescence";
+	}
+	out << " depth " << (int)node.enter.depth << " [" << (int)node.enter.alpha << ", " << (int)node.enter.beta << "]: ";
+	out << (int)node.exit.utility << " (" << SEARCH_EXIT_NAMES[node.exit.reason];
+	if(node.bestMove != -1)
+	{
+		out << ", best " << (int)node.bestMove;
+	}
+	if(node.cutoffMoveNumber != 0)
+	{
+		out << ", cutoff by move " << (int)node.cutoffMoveNumber << " of the order";
+	}
+	out << ")" << endl;
+	for(unsigned int i = 0; i < node.children.size(); i++)
+	{
+		PrintTraceNode(node.children[i], indent + 1, out);
+	}
+}
+
+bool PrintSearchTraceTree(const char* fileName, const string& moves, unsigned char maxPlies, ostream& out)
+{
+	ifstream in;
+	if(!OpenTrace(in, fileName, out))
+	{
+		return false;
+	}
+	for(unsigned int i = 0; i < moves.size(); i++)
+	{
+		if(moves[i] < '0' || moves[i] >= '0' + AMBO_PLAYER_COUNT)
+		{
+			out << "Invalid moves: " << moves << endl;
+			return false;
+		}
+	}
+
+	// Only the nodes of the subtree are kept, rebuilt again for every iteration. path[p] is the node entered at ply p + 1
+	// if it is in the subtree, else nullptr. onPath[p] is set if the moves to it so far are the given ones.
+	unsigned int subtreePly = (unsigned int)moves.size() + 1;
+	TraceNode subtree;
+	bool found = false;
+	unsigned char depth = 0;
+	SearchTraceIteration iteration;
+	std::vector<TraceNode*> path;
+	std::vector<bool> onPath;
+	unsigned int ply = 0;
+	string error;
+	SearchTraceRecord record;
+	while(ReadTraceRecord(in, record, ply, error))
+	{
+		switch(record.type)
+		{
+			case SEARCH_TRACE_ITERATION:
+				iteration = record.iteration;
+				depth = iteration.depth;
+				found = false;
+			break;
+			case SEARCH_TRACE_ENTER:
+			{
+				path.resize(ply);
+				onPath.resize(ply);
+				bool parentOnPath = ply == 1 || onPath[ply - 2];
+				onPath[ply - 1] = parentOnPath && (ply == 1 || ply > subtreePly || record.enter.move == moves[ply - 2] - '0');
+				path[ply - 1] = nullptr;
+				TraceNode* node = nullptr;
+				if(onPath[ply - 1] && ply == subtreePly)
+				{
+					// A node searched again replaces its earlier search.
+					subtree = TraceNode();
+					node = &subtree;
+					found = true;
+				}
+				else if(ply > subtreePly && ply <= subtreePly + maxPlies && path[ply - 2])
+				{
+					path[ply - 2]->children.push_back(TraceNode());
+					node = &path[ply - 2]->children.back();
+				}
+				if(node)
+				{
+					node->enter = record.enter;
+					node->bestMove = -1;
+					node->cutoffMoveNumber = 0;
+					path[ply - 1] = node;
+				}
+			}
+			break;
+			case SEARCH_TRACE_EXIT:
+				if(path[ply])
+				{
+					path[ply]->exit = record.exit;
+				}
+			break;
+			case SEARCH_TRACE_SCORE:
+				if(path[ply - 1])
+				{
+					path[ply - 1]->bestMove = record.score.move;
+				}
+			break;
+			case SEARCH_TRACE_CUTOFF:
+				if(path[ply - 1])
+				{
+					path[ply - 1]->cutoffMoveNumber = record.cutoff.moveNumber;
+				}
+			break;
+		}
+	}
+	if(!error.empty())
+	{
+		out << error << endl;
+		return false;
+	}
+	if(!found)
+	{
+		out << "The moves " << moves << " were not searched in the last iteration." << endl;
+		return false;
+	}
+
+	out << "Last iteration (depth " << (int)depth << "), root position with " << (iteration.minTurn ? "min" : "max") << " to move:";
+	out << makeBoardStr(iteration.ambos) << endl;
+	PrintTraceNode(subtree, 0, out);
+	return true;
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "Board.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string.h>
+
+static const char SEARCH_TRACE_MAGIC[3] = {'K', 'S', 'T'};
+static const unsigned char SEARCH_TRACE_VERSION = 1;
+static const char* const SEARCH_TRACE_FILE_NAME = "Search.kst";
+static const unsigned int SEARCH_TRACE_BUFFER_SIZE = 1 << 16; // Bytes of records collected before they are written to the file.
+static const unsigned char SEARCH_TRACE_NO_MOVE = 0xFF; // The move of the root.
+
+/*
+	Why the search of a node ended.
+*/
+enum SEARCH_EXIT
+{
+	EXIT_SEARCHED		= 0, // The children were searched (possibly until a cutoff).
+	EXIT_TERMINAL		= 1, // The game is over in the node.
+	EXIT_EVALUATION		= 2, // Evaluated at the horizon (or at the end of the quiescence search).
+	EXIT_STAND_PAT		= 3, // The quiescence search stood pat outside of the bounds.
+	EXIT_TRANSPOSITION	= 4, // Cut off by the transposition table.
+	EXIT_SEED_BOUND		= 5, // Cut off by the seeds in the kalahs.
+	EXIT_TIME_UP		= 6, // Evaluated because the time limit was reached.
+	SEARCH_EXIT_COUNT	= 7
+};
+
+static const char* const SEARCH_EXIT_NAMES[SEARCH_EXIT_COUNT] =
+{
+	"searched", "terminal", "evaluation", "stand pat", "transposition", "seed bound", "time up"
+};
+
+/*
+	Receives the events of a Minimax search as they happen, see Minimax::SetSearchVisitor(...).
+	Every EnterNode(...) is followed by the events of the node's children and then by the ExitNode(...) of the node,
+	so the order of the events is a depth-first walk of the searched tree. Called by the thread searching.
+*/
+class SearchVisitor
+{
+	public:
+		virtual ~SearchVisitor() {}
+
+		/*
+			An iteration of the iterative deepening starts at the board, followed by the EnterNode(...) of the root.
+		*/
+		virtual void StartIteration(const Board& board, bool minTurn, unsigned char depth) = 0;
+		/*
+			The search enters the child reached by move (SEARCH_TRACE_NO_MOVE for the root) with the given depth left and bounds.
+			quiescence is set for the nodes of the quiescence search.
+		*/
+		virtual void EnterNode(unsigned char move, unsigned char depth, bool minTurn, char alpha, char beta, bool quiescence) = 0;
+		virtual void ExitNode(char utility, SEARCH_EXIT reason) = 0;
+		/*
+			The child reached by move improved the best utility of the node.
+		*/
+		virtual void Score(unsigned char move, char utility) = 0;
+		/*
+			The child reached by move caused a cutoff. moveNumber = The place of the move in the search order, starting at 1.
+		*/
+		virtual void Cutoff(unsigned char move, unsigned char moveNumber) = 0;
+};
+
+/*
+	The records of a search trace file. Every record starts with its type.
+*/
+enum SEARCH_TRACE_TYPE
+{
+	SEARCH_TRACE_FILE		= 1,
+	SEARCH_TRACE_ITERATION	= 2,
+	SEARCH_TRACE_ENTER		= 3,
+	SEARCH_TRACE_EXIT		= 4,
+	SEARCH_TRACE_SCORE		= 5,
+	SEARCH_TRACE_CUTOFF		= 6
+};
+
+enum SEARCH_TRACE_FLAG
+{
+	SEARCH_TRACE_MIN_TURN	= 1,
+	SEARCH_TRACE_QUIESCENCE	= 2
+};
+
+#pragma pack(push, 1)
+struct SearchTraceFile
+{
+	unsigned char type;
+	char magic[3];
+	unsigned char version;
+};
+
+struct SearchTraceIteration
+{
+	unsigned char type;
+	unsigned char ambos[AMBO_COUNT];
+	bool minTurn;
+	unsigned char depth;
+};
+
+struct SearchTraceEnter
+{
+	unsigned char type;
+	unsigned char move;
+	unsigned char depth;
+	char alpha;
+	char beta;
+	unsigned char flags; // SEARCH_TRACE_FLAGs.
+};
+
+struct SearchTraceExit
+{
+	unsigned char type;
+	unsigned char reason; // One of SEARCH_EXIT.
+	char utility;
+};
+
+struct SearchTraceScore
+{
+	unsigned char type;
+	unsigned char move;
+	char utility;
+};
+
+struct SearchTraceCutoff
+{
+	unsigned char type;
+	unsigned char move;
+	unsigned char moveNumber;
+};
+#pragma pack(pop)
+
+/*
+	Streams the events of a search to a search trace file in a few bytes per event,
+	so that the searched tree can be analysed afterwards without the engine keeping it in memory.
+*/
+class SearchTraceWriter : public SearchVisitor
+{
+	private:
+		ofstream out;
+		unsigned char buffer[SEARCH_TRACE_BUFFER_SIZE];
+		unsigned int bufferSize;
+		unsigned long long nrOfBytes; // Written to the file, including the buffer.
+
+		template<typename T> void Write(const T& record)
+		{
+			if(this->bufferSize + sizeof(T) > SEARCH_TRACE_BUFFER_SIZE)
+			{
+				this->Flush();
+			}
+			memcpy(this->buffer + this->bufferSize, &record, sizeof(T));
+			this->bufferSize += sizeof(T);
+			this->nrOfBytes += sizeof(T);
+		}
+		void Flush();
+
+	public:
+		SearchTraceWriter();
+		virtual ~SearchTraceWriter();
+
+		/*
+			Creates the file, returns false if it could not be opened.
+		*/
+		bool Open(const char* fileName);
+		/*
+			Writes the buffered records and closes the file. Returns false if writing failed.
+		*/
+		bool Close();
+		unsigned long long GetNrOfBytes() const { return this->nrOfBytes; }
+
+		virtual void StartIteration(const Board& board, bool minTurn, unsigned char depth);
+		virtual void EnterNode(unsigned char move, unsigned char depth, bool minTurn, char alpha, char beta, bool quiescence);
+		virtual void ExitNode(char utility, SEARCH_EXIT reason);
+		virtual void Score(unsigned char move, char utility);
+		virtual void Cutoff(unsigned char move, unsigned char moveNumber);
+};
+
+/*
+	Prints statistics of the iterations in a search trace file: the nodes, exits and cutoffs per ply.
+	Returns false if the file could not be read or is corrupt.
+*/
+bool PrintSearchTraceStats(const char* fileName, ostream& out);
+/*
+	Rebuilds the subtree below the given moves (e.g. "25" = move 2, then move 5) of the last iteration in a search trace file,
+	at most maxPlies deep, and prints it. Only the subtree is kept in memory while the file is read.
+	Returns false if the file could not be read or is corrupt.
+*/
+bool PrintSearchTraceTree(const char* fileName, const string& moves, unsigned char maxPlies, ostream& out);
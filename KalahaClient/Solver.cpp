@@ -0,0 +1,243 @@
+#include "Solver.h"
+#include "TranspositionTable.h"
+#include "SpanTrace.h"
+
+#include <string.h>
+
+Solver::Solver()
+{
+	this->entries = nullptr;
+	this->nrOfEntries = 0;
+	this->threshold = SOLVER_WIN_THRESHOLD;
+	this->startTime = 0;
+	this->timeLimitMS = 0;
+	this->stopped = false;
+	this->nrOfNodes = 0;
+}
+
+Solver::~Solver()
+{
+	if(this->entries)
+	{
+		delete[] this->entries;
+		this->entries = nullptr;
+	}
+}
+
+void Solver::Resize(unsigned int sizeMB)
+{
+	ScopedSpan span("Resize solver table");
+	if(this->entries)
+	{
+		delete[] this->entries;
+		this->entries = nullptr;
+	}
+	this->nrOfEntries = 0;
+
+	unsigned long long maxNrOfEntries = (unsigned long long)sizeMB * 1024 * 1024 / sizeof(SolverEntry);
+	if(maxNrOfEntries == 0)
+	{
+		return;
+	}
+	this->nrOfEntries = 1;
+	while((unsigned long long)this->nrOfEntries * 2 <= maxNrOfEntries)
+	{
+		this->nrOfEntries *= 2;
+	}
+	this->entries = new SolverEntry[this->nrOfEntries];
+	memset(this->entries, 0, this->nrOfEntries * sizeof(SolverEntry));
+}
+
+unsigned long long Solver::GetKey(const Board& board, bool minTurn) const
+{
+	// The results depend on whose turn it is and on the threshold, so both are part of the key.
+	unsigned long long key = TranspositionTable::GetKey(board, minTurn);
+	key ^= (minTurn ? 0x9E3779B97F4A7C15ULL : 0) ^ (this->threshold * 0xC2B2AE3D27D4EB4FULL);
+	return key ? key : 1;
+}
+
+void Solver::Evaluate(const Board& board, bool minTurn, unsigned int& proofNumber, unsigned int& disproofNumber) const
+{
+	// The kalahs only grow, so the result is known as soon as one of them passes the threshold.
+	// This also covers the end of the game, when all seeds are in the kalahs.
+	if(board.GetNrOfSeedsInKalah(0) >= this->threshold)
+	{
+		proofNumber = 0;
+		disproofNumber = SOLVER_INFINITY;
+		return;
+	}
+	if(board.GetNrOfSeedsInKalah(1) > SOLVER_TOTAL_SEEDS - this->threshold)
+	{
+		proofNumber = SOLVER_INFINITY;
+		disproofNumber = 0;
+		return;
+	}
+	// Without the sweep rule the game can end with seeds on the board, which don't count. Then the threshold 
+	// (more than half of the seeds to win, half of them for a draw) is reached by leading by threshold - half.
+	if(board.IsTerminalState() != -1)
+	{
+		bool proven = (int)board.GetNrOfSeedsInKalah(0) - board.GetNrOfSeedsInKalah(1) >= (int)this->threshold - SOLVER_TOTAL_SEEDS / 2;
+		proofNumber = proven ? 0 : SOLVER_INFINITY;
+		disproofNumber = proven ? SOLVER_INFINITY : 0;
+		return;
+	}
+
+	unsigned long long key = this->GetKey(board, minTurn);
+	const SolverEntry& entry = this->entries[key & (this->nrOfEntries - 1)];
+	if(entry.key == key)
+	{
+		proofNumber = entry.proofNumber;
+		disproofNumber = entry.disproofNumber;
+		return;
+	}
+	proofNumber = 1;
+	disproofNumber = 1;
+}
+
+void Solver::Store(const Board& board, bool minTurn, unsigned int proofNumber, unsigned int disproofNumber)
+{
+	unsigned long long key = this->GetKey(board, minTurn);
+	SolverEntry& entry = this->entries[key & (this->nrOfEntries - 1)];
+	// Keep solved positions, they are the most expensive to find again.
+	if(entry.key != key && entry.key != 0 && (entry.proofNumber == 0 || entry.disproofNumber == 0) && proofNumber != 0 && disproofNumber != 0)
+	{
+		return;
+	}
+	entry.key = key;
+	entry.proofNumber = proofNumber;
+	entry.disproofNumber = disproofNumber;
+}
+
+void Solver::MultipleIterativeDeepening(Board& board, bool minTurn, unsigned int proofThreshold, unsigned int disproofThreshold)
+{
+	this->nrOfNodes++;
+	if((this->nrOfNodes & (SOLVER_TIME_CHECK_INTERVAL - 1)) == 0 && timeGetTime() - this->startTime >= this->timeLimitMS)
+	{
+		this->stopped = true;
+	}
+
+	// Max chooses one move that proves the position (an OR node), min has to be disproven on all moves (an AND node).
+	MoveUndo undo;
+	while(true)
+	{
+		unsigned int proofNumber = minTurn ? 0 : SOLVER_INFINITY;
+		unsigned int disproofNumber = minTurn ? SOLVER_INFINITY : 0;
+		unsigned int secondBest = SOLVER_INFINITY; // The second smallest proof (max) or disproof (min) number.
+		unsigned int bestProofNumber = 0;
+		unsigned int bestDisproofNumber = 0;
+		char bestMove = -1;
+		bool bestMinTurn = false;
+		for(unsigned char i = 0; i < AMBO_PLAYER_COUNT; i++)
+		{
+			MoveOutcome outcome = board.MoveSeeds(i, minTurn, undo);
+			if(!outcome.IsValid())
+			{
+				continue;
+			}
+			bool childMinTurn = (outcome.extraTurn && !outcome.terminal) ? minTurn : !minTurn;
+			unsigned int childProofNumber;
+			unsigned int childDisproofNumber;
+			this->Evaluate(board, childMinTurn, childProofNumber, childDisproofNumber);
+			board.UndoMove(undo);
+
+			unsigned int childNumber = minTurn ? childDisproofNumber : childProofNumber;
+			if(bestMove == -1 || childNumber < (minTurn ? bestDisproofNumber : bestProofNumber))
+			{
+				if(bestMove != -1)
+				{
+					secondBest = minTurn ? bestDisproofNumber : bestProofNumber;
+				}
+				bestMove = i;
+				bestMinTurn = childMinTurn;
+				bestProofNumber = childProofNumber;
+				bestDisproofNumber = childDisproofNumber;
+			}
+			else if(childNumber < secondBest)
+			{
+				secondBest = childNumber;
+			}
+			if(minTurn)
+			{
+				proofNumber = min(proofNumber + childProofNumber, SOLVER_INFINITY);
+				disproofNumber = min(disproofNumber, childDisproofNumber);
+			}
+			else
+			{
+				proofNumber = min(proofNumber, childProofNumber);
+				disproofNumber = min(disproofNumber + childDisproofNumber, SOLVER_INFINITY);
+			}
+		}
+
+		if(proofNumber >= proofThreshold || disproofNumber >= disproofThreshold || this->stopped)
+		{
+			this->Store(board, minTurn, proofNumber, disproofNumber);
+			return;
+		}
+
+		// Search the most promising move until it is no longer the most promising one.
+		unsigned int childProofThreshold;
+		unsigned int childDisproofThreshold;
+		if(minTurn)
+		{
+			childProofThreshold = proofThreshold - proofNumber + bestProofNumber;
+			childDisproofThreshold = min(disproofThreshold, secondBest + 1);
+		}
+		else
+		{
+			childProofThreshold = min(proofThreshold, secondBest + 1);
+			childDisproofThreshold = disproofThreshold - disproofNumber + bestDisproofNumber;
+		}
+		board.MoveSeeds(bestMove, minTurn, undo);
+		this->MultipleIterativeDeepening(board, bestMinTurn, childProofThreshold, childDisproofThreshold);
+		board.UndoMove(undo);
+	}
+}
+
+SOLVER_RESULT Solver::Solve(const Board& board, unsigned char threshold, unsigned int timeLimitMS, char& move)
+{
+	move = -1;
+	if(!this->IsEnabled())
+	{
+		return SOLVER_UNKNOWN;
+	}
+	this->threshold = threshold;
+	this->startTime = timeGetTime();
+	this->timeLimitMS = timeLimitMS;
+	this->stopped = false;
+	this->nrOfNodes = 0;
+
+	Board rootBoard = board;
+	unsigned int proofNumber;
+	unsigned int disproofNumber;
+	this->Evaluate(rootBoard, false, proofNumber, disproofNumber);
+	if(proofNumber != 0 && disproofNumber != 0)
+	{
+		this->MultipleIterativeDeepening(rootBoard, false, SOLVER_INFINITY, SOLVER_INFINITY);
+		this->Evaluate(rootBoard, false, proofNumber, disproofNumber);
+	}
+	if(proofNumber != 0)
+	{
+		return disproofNumber == 0 ? SOLVER_DISPROVEN : SOLVER_UNKNOWN;
+	}
+
+	// Find the move that keeps the proof.
+	MoveUndo undo;
+	for(unsigned char i = 0; i < AMBO_PLAYER_COUNT && move == -1; i++)
+	{
+		MoveOutcome outcome = rootBoard.MoveSeeds(i, 0, undo);
+		if(!outcome.IsValid())
+		{
+			continue;
+		}
+		unsigned int childProofNumber;
+		unsigned int childDisproofNumber;
+		this->Evaluate(rootBoard, outcome.extraTurn && !outcome.terminal ? false : true, childProofNumber, childDisproofNumber);
+		rootBoard.UndoMove(undo);
+		if(childProofNumber == 0)
+		{
+			move = i;
+		}
+	}
+	// The proof of a child may have been replaced in the table, then the position is not known to be solved.
+	return move == -1 ? SOLVER_UNKNOWN : SOLVER_PROVEN;
+}
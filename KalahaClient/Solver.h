@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Board.h"
+#include <Windows.h>
+
+static const unsigned int SOLVER_INFINITY = 1 << 28; // Proof and disproof numbers are capped here.
+static const unsigned char SOLVER_TOTAL_SEEDS = AMBO_SEED_COUNT * AMBO_PLAYER_COUNT * 2;
+static const unsigned char SOLVER_WIN_THRESHOLD = SOLVER_TOTAL_SEEDS / 2 + 1; // More than half of the seeds.
+static const unsigned char SOLVER_DRAW_THRESHOLD = SOLVER_TOTAL_SEEDS / 2;
+static const unsigned char SOLVER_MAX_SEEDS = 24; // The solver is only tried when at most this many seeds are left in the ambos.
+static const unsigned int SOLVER_TIME_CHECK_INTERVAL = 1024; // Nodes between checks of the time, a power of 2.
+
+enum SOLVER_RESULT
+{
+	SOLVER_UNKNOWN		= 0, // Not solved within the time limit.
+	SOLVER_PROVEN		= 1, // Max can get at least the threshold.
+	SOLVER_DISPROVEN	= 2  // Min can keep max below the threshold.
+};
+
+struct SolverEntry
+{
+	unsigned long long	key;	// 0 if the entry is empty.
+	unsigned int		proofNumber;
+	unsigned int		disproofNumber;
+};
+
+/*
+	Proves or disproves that max (us) can get at least a given number of seeds in the kalah, using depth-first
+	proof-number search (df-pn). Unlike the heuristic search it gives exact results, so decided endgames are played
+	without searching and won positions are not thrown away.
+	The seeds in the kalahs never go back to the ambos, so the search stops as soon as either kalah passes the threshold.
+	The proof and disproof numbers are kept in a table of fixed size, also between searches.
+*/
+class Solver
+{
+	private:
+		SolverEntry* entries;
+		unsigned int nrOfEntries; // Always a power of 2, 0 = disabled.
+		unsigned char threshold;
+		DWORD startTime;
+		unsigned int timeLimitMS;
+		bool stopped;
+		unsigned int nrOfNodes;
+
+		unsigned long long GetKey(const Board& board, bool minTurn) const;
+		/*
+			Sets the proof and disproof numbers of a position from its kalahs (also at the end of the game), the table or (if unknown) to 1.
+		*/
+		void Evaluate(const Board& board, bool minTurn, unsigned int& proofNumber, unsigned int& disproofNumber) const;
+		void Store(const Board& board, bool minTurn, unsigned int proofNumber, unsigned int disproofNumber);
+		/*
+			Searches the position until its proof number reaches proofThreshold or its disproof number reaches disproofThreshold.
+			The moves are made and taken back on the board.
+		*/
+		void MultipleIterativeDeepening(Board& board, bool minTurn, unsigned int proofThreshold, unsigned int disproofThreshold);
+
+	public:
+		Solver();
+		virtual~Solver();
+
+		/*
+			Allocates the table, 0 disables the solver. Any previous content is lost.
+		*/
+		void Resize(unsigned int sizeMB);
+		bool IsEnabled() const { return this->nrOfEntries > 0; }
+		unsigned long long GetMemoryUsage() const { return (unsigned long long)this->nrOfEntries * sizeof(SolverEntry); }
+		/*
+			Tries to prove that max, to move, can get at least threshold seeds in the kalah.
+			If proven, move is set to a move that keeps the proof.
+		*/
+		SOLVER_RESULT Solve(const Board& board, unsigned char threshold, unsigned int timeLimitMS, char& move);
+		unsigned int GetNrOfNodes() const { return this->nrOfNodes; }
+};
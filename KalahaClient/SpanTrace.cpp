@@ -0,0 +1,131 @@
+#include "SpanTrace.h"
+
+#include <fstream>
+#include <iomanip>
+
+std::atomic<bool> SpanTracer::enabled(false);
+std::mutex SpanTracer::mutex;
+std::vector<SpanBuffer*> SpanTracer::buffers;
+LARGE_INTEGER SpanTracer::frequency;
+long long SpanTracer::startTime = 0;
+
+/*
+	Gives the buffer of a thread back when the thread ends.
+*/
+struct SpanBufferOwner
+{
+	SpanBuffer* buffer;
+
+	SpanBufferOwner() : buffer(nullptr) {}
+	~SpanBufferOwner()
+	{
+		if(this->buffer)
+		{
+			SpanTracer::ReleaseBuffer(this->buffer);
+		}
+	}
+};
+
+static thread_local SpanBufferOwner bufferOwner;
+
+void SpanTracer::Enable()
+{
+	QueryPerformanceFrequency(&frequency);
+	startTime = GetTime();
+	enabled = true;
+}
+
+SpanBuffer* SpanTracer::GetBuffer()
+{
+	if(bufferOwner.buffer)
+	{
+		return bufferOwner.buffer;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	for(unsigned int i = 0; i < buffers.size() && !bufferOwner.buffer; i++)
+	{
+		if(!buffers[i]->inUse)
+		{
+			bufferOwner.buffer = buffers[i];
+		}
+	}
+	if(!bufferOwner.buffer)
+	{
+		bufferOwner.buffer = new SpanBuffer();
+		bufferOwner.buffer->nrOfSpans = 0;
+		bufferOwner.buffer->threadId = (unsigned int)buffers.size() + 1;
+		bufferOwner.buffer->threadName = "Thread " + to_string(bufferOwner.buffer->threadId);
+		buffers.push_back(bufferOwner.buffer);
+	}
+	bufferOwner.buffer->inUse = true;
+	return bufferOwner.buffer;
+}
+
+void SpanTracer::ReleaseBuffer(SpanBuffer* buffer)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	buffer->inUse = false;
+}
+
+void SpanTracer::Record(const char* name, long long start, int argument)
+{
+	long long end = GetTime();
+	SpanBuffer* buffer = GetBuffer();
+	unsigned long long nrOfSpans = buffer->nrOfSpans.load(std::memory_order_relaxed);
+	Span& span = buffer->spans[nrOfSpans & (SPAN_BUFFER_SIZE - 1)];
+	span.name = name;
+	span.start = start;
+	span.duration = end - start;
+	span.argument = argument;
+	buffer->nrOfSpans.store(nrOfSpans + 1, std::memory_order_release);
+}
+
+void SpanTracer::NameThread(const char* name)
+{
+	if(!IsEnabled())
+	{
+		return;
+	}
+	SpanBuffer* buffer = GetBuffer();
+	std::lock_guard<std::mutex> lock(mutex);
+	buffer->threadName = name;
+}
+
+bool SpanTracer::Write(const char* fileName)
+{
+	ofstream file(fileName);
+	if(!file)
+	{
+		return false;
+	}
+	// Microseconds, as expected by the viewers.
+	double unit = 1000000.0 / (double)(frequency.QuadPart ? frequency.QuadPart : 1);
+	file << fixed << setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	std::lock_guard<std::mutex> lock(mutex);
+	for(unsigned int b = 0; b < buffers.size(); b++)
+	{
+		const SpanBuffer* buffer = buffers[b];
+		file << (first ? "\n" : ",\n");
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId;
+		file << ",\"args\":{\"name\":\"" << buffer->threadName << "\"}}";
+		first = false;
+
+		unsigned long long nrOfSpans = buffer->nrOfSpans.load(std::memory_order_acquire);
+		unsigned long long firstSpan = nrOfSpans > SPAN_BUFFER_SIZE ? nrOfSpans - SPAN_BUFFER_SIZE : 0;
+		for(unsigned long long s = firstSpan; s < nrOfSpans; s++)
+		{
+			const Span& span = buffer->spans[s & (SPAN_BUFFER_SIZE - 1)];
+			file << ",\n{\"name\":\"" << span.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId;
+			file << ",\"ts\":" << (span.start - startTime) * unit << ",\"dur\":" << span.duration * unit;
+			if(span.argument != SPAN_NO_ARGUMENT)
+			{
+				file << ",\"args\":{\"value\":" << span.argument << "}";
+			}
+			file << "}";
+		}
+	}
+	file << "\n]}\n";
+	return (bool)file;
+}
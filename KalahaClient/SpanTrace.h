@@ -0,0 +1,112 @@
+#pragma once
+
+#include <Windows.h>
+#include <limits.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <string>
+
+using namespace std;
+
+static const unsigned int SPAN_BUFFER_SIZE = 1 << 15; // Spans kept per thread (a power of 2), older ones are overwritten.
+static const int SPAN_NO_ARGUMENT = INT_MIN;
+static const char* const SPAN_TRACE_FILE_NAME = "Trace.json";
+
+/*
+	A timed section of a thread, e.g. a search iteration or a receive from the server.
+*/
+struct Span
+{
+	const char* name; // Only the pointer is kept, so it must be a string literal.
+	long long start; // Performance counter ticks.
+	long long duration;
+	int argument; // E.g. the depth of an iteration, SPAN_NO_ARGUMENT if there is none.
+};
+
+/*
+	The ring buffer of the spans of a thread. Only the thread writes to it. When the thread ends, the buffer (and the spans
+	in it) is handed to the next thread that records spans, so that the threads started per move (e.g. pondering) don't
+	need a buffer each.
+*/
+struct SpanBuffer
+{
+	Span spans[SPAN_BUFFER_SIZE];
+	std::atomic<unsigned long long> nrOfSpans; // Recorded in total, only the last SPAN_BUFFER_SIZE are kept.
+	unsigned int threadId; // The buffer's number in the trace, the threads sharing it are shown as one.
+	string threadName;
+	bool inUse;
+};
+
+/*
+	Records spans of the client into a ring buffer per thread and writes them in the Chrome trace event format (JSON),
+	which can be opened in chrome://tracing or Perfetto.
+	Tracing is off until it is enabled. A disabled span only reads a flag, and the buffers are only allocated when a
+	thread records its first span.
+*/
+class SpanTracer
+{
+	friend struct SpanBufferOwner;
+
+	private:
+		static std::atomic<bool> enabled;
+		static std::mutex mutex; // Guards the list of buffers.
+		static std::vector<SpanBuffer*> buffers;
+		static LARGE_INTEGER frequency;
+		static long long startTime; // Of the trace, the time stamps are written relative to it.
+
+		/*
+			Returns the buffer of the calling thread, taking a free one or allocating one on the first call.
+		*/
+		static SpanBuffer* GetBuffer();
+		static void ReleaseBuffer(SpanBuffer* buffer);
+
+	public:
+		static void Enable();
+		static bool IsEnabled() { return enabled.load(std::memory_order_relaxed); }
+		static long long GetTime()
+		{
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			return now.QuadPart;
+		}
+
+		/*
+			Records a span of the calling thread that started at the given time (GetTime()) and ends now.
+		*/
+		static void Record(const char* name, long long start, int argument);
+		/*
+			Names the calling thread in the trace (e.g. "Ponder"). Does nothing if tracing is disabled.
+		*/
+		static void NameThread(const char* name);
+
+		/*
+			Writes the spans of all threads as trace events. Spans recorded while writing may be written partially,
+			so it should be called when the threads have stopped. Returns false if the file could not be written.
+		*/
+		static bool Write(const char* fileName);
+};
+
+/*
+	Records a span from its construction to the end of its scope.
+*/
+class ScopedSpan
+{
+	private:
+		const char* name;
+		long long start; // 0 if tracing is disabled.
+		int argument;
+
+	public:
+		ScopedSpan(const char* name, int argument = SPAN_NO_ARGUMENT) : name(name), argument(argument)
+		{
+			this->start = SpanTracer::IsEnabled() ? SpanTracer::GetTime() : 0;
+		}
+		~ScopedSpan()
+		{
+			if(this->start != 0)
+			{
+				SpanTracer::Record(this->name, this->start, this->argument);
+			}
+		}
+};
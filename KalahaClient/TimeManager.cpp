@@ -0,0 +1,153 @@
+#include "TimeManager.h"
+
+TimeManager::TimeManager()
+{
+	this->moveTimeMS = 3000;
+	this->gameTimeMS = 0;
+	this->remainingTimeMS = 0;
+	this->softLimitMS = this->moveTimeMS;
+	this->hardLimitMS = this->moveTimeMS;
+	this->lastIterationNodes = 0;
+	this->nrOfNodes = 0;
+	this->branchingFactor = 0.0f;
+	this->lastBestMove = -1;
+	this->nrOfStableIterations = 0;
+	this->previousIterationNodes = 0;
+	this->previousBranchingFactor = TIME_DEFAULT_BRANCHING_FACTOR;
+	this->msPerNode = 0.0f;
+}
+
+void TimeManager::SetMoveTime(unsigned short moveTimeMS)
+{
+	this->moveTimeMS = min(moveTimeMS, MAX_MOVE_TIME_MS);
+}
+
+void TimeManager::SetGameTime(unsigned int gameTimeMS)
+{
+	this->gameTimeMS = gameTimeMS;
+	this->StartGame();
+}
+
+void TimeManager::StartGame()
+{
+	this->remainingTimeMS = (int)this->gameTimeMS;
+}
+
+void TimeManager::StartMove(const Board& board)
+{
+	this->previousIterationNodes = this->lastIterationNodes;
+	if(this->branchingFactor > 0.0f)
+	{
+		this->previousBranchingFactor = this->branchingFactor;
+	}
+	this->lastIterationNodes = 0;
+	this->nrOfNodes = 0;
+	this->branchingFactor = 0.0f;
+	this->lastBestMove = -1;
+	this->nrOfStableIterations = 0;
+
+	if(this->gameTimeMS == 0)
+	{
+		this->softLimitMS = this->moveTimeMS;
+		this->hardLimitMS = this->moveTimeMS;
+		return;
+	}
+
+	// Divide the time left evenly over the moves predicted to be left.
+	unsigned char seedsInPlay = board.GetNrOfSeedsInAmbos(0) + board.GetNrOfSeedsInAmbos(1);
+	unsigned int remaining = (unsigned int)max(this->remainingTimeMS, 0);
+	unsigned int movesLeft = max((unsigned int)(seedsInPlay / TIME_SEEDS_PER_MOVE), (unsigned int)TIME_MIN_MOVES_LEFT);
+	float moveTime = (float)remaining / movesLeft;
+
+	// Spend more time where the game is decided: the middlegame, tactical positions and close scores.
+	// The opening is shallow in consequences and the endgame is solved quickly anyway.
+	unsigned char totalSeeds = AMBO_SEED_COUNT * AMBO_COUNT - 2 * AMBO_SEED_COUNT;
+	if(seedsInPlay > totalSeeds * 5 / 6)
+	{
+		moveTime *= 0.8f;
+	}
+	else if(seedsInPlay > totalSeeds / 3)
+	{
+		moveTime *= 1.3f;
+	}
+	if(board.CanGetOpponentSeeds(0) > 0 || board.CanGetExtraTurn(0))
+	{
+		moveTime *= 1.25f;
+	}
+	int scoreDifference = (int)board.GetNrOfSeedsInKalah(0) - (int)board.GetNrOfSeedsInKalah(1);
+	if(abs(scoreDifference) <= AMBO_SEED_COUNT)
+	{
+		moveTime *= 1.2f;
+	}
+
+	// The hard limit allows an unstable search to go on, but never uses more than a quarter of the time left.
+	this->softLimitMS = (unsigned short)min(moveTime, (float)MAX_MOVE_TIME_MS);
+	this->hardLimitMS = (unsigned short)min(min(moveTime * 3.0f, remaining / 4.0f), (float)MAX_MOVE_TIME_MS);
+	this->hardLimitMS = max(this->hardLimitMS, (unsigned short)1);
+	this->softLimitMS = max(min(this->softLimitMS, this->hardLimitMS), (unsigned short)1);
+}
+
+void TimeManager::EndIteration(unsigned int iterationNodes, char bestMove)
+{
+	if(this->lastIterationNodes >= TIME_MIN_ITERATION_NODES)
+	{
+		this->branchingFactor = min(max((float)iterationNodes / this->lastIterationNodes, 1.0f), TIME_MAX_BRANCHING_FACTOR);
+	}
+	this->lastIterationNodes = max(iterationNodes, 1U);
+	this->nrOfNodes += iterationNodes;
+
+	if(bestMove == this->lastBestMove)
+	{
+		this->nrOfStableIterations++;
+	}
+	else
+	{
+		this->nrOfStableIterations = 0;
+	}
+	this->lastBestMove = bestMove;
+}
+
+bool TimeManager::StartNextIteration(unsigned int elapsedMS) const
+{
+	// Predict the cost of the next iteration from how much the last one grew. 
+	// The time per node is measured over the whole move, as a single iteration often takes less than a millisecond.
+	// An iteration answered by the transposition table says nothing about the next one, 
+	// which will then cost about as much as the last iteration of the previous move.
+	float branchingFactor = (this->branchingFactor > 0.0f) ? this->branchingFactor : this->previousBranchingFactor;
+	unsigned int iterationNodes = this->lastIterationNodes;
+	if(iterationNodes < TIME_MIN_ITERATION_NODES)
+	{
+		iterationNodes = max(iterationNodes, this->previousIterationNodes);
+	}
+	float msPerNode = (this->nrOfNodes >= TIME_MIN_ITERATION_NODES) ? (float)elapsedMS / this->nrOfNodes : this->msPerNode;
+	float predictedMS = iterationNodes * branchingFactor * msPerNode;
+	if(elapsedMS + predictedMS > this->hardLimitMS)
+	{
+		return false; // Would not finish, and a partial iteration doesn't change the move.
+	}
+
+	// With a game time, a stable best move saves time for later moves, and a changing one gets more.
+	float softLimit = this->softLimitMS;
+	if(this->gameTimeMS == 0)
+	{
+		return elapsedMS < softLimit;
+	}
+	if(this->nrOfStableIterations >= TIME_STABLE_ITERATIONS)
+	{
+		softLimit *= 0.7f;
+	}
+	else if(this->nrOfStableIterations == 0 && this->lastIterationNodes > 0)
+	{
+		softLimit = min(softLimit * 1.5f, (float)this->hardLimitMS);
+	}
+	return elapsedMS < softLimit;
+}
+
+void TimeManager::EndMove(unsigned int elapsedMS)
+{
+	this->remainingTimeMS -= (int)elapsedMS;
+	if(this->nrOfNodes >= TIME_MIN_ITERATION_NODES)
+	{
+		this->msPerNode = (float)elapsedMS / this->nrOfNodes;
+	}
+}
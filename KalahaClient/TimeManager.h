@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Board.h"
+#include <Windows.h>
+
+static const unsigned short MAX_MOVE_TIME_MS = 30000; // Upper limit of the hard limit of a move, so that it fits the search's time counters.
+static const unsigned char TIME_SEEDS_PER_MOVE = 3; // Average number of seeds leaving the ambos per move of ours, used to predict the number of moves left.
+static const unsigned char TIME_MIN_MOVES_LEFT = 4; // Never plan for fewer moves than this, the estimate is rough.
+static const unsigned char TIME_STABLE_ITERATIONS = 3; // Iterations with the same best move before the move is considered stable.
+static const unsigned int TIME_MIN_ITERATION_NODES = 1000; // Smaller iterations (e.g. answered by the transposition table) don't predict the branching factor.
+static const float TIME_DEFAULT_BRANCHING_FACTOR = 2.0f; // Used until the branching factor has been observed.
+static const float TIME_MAX_BRANCHING_FACTOR = 8.0f;
+
+/*
+	Decides how long to search each move.
+	With a fixed move time, every move gets that time as its hard limit.
+	With a game time, the time left is divided over the predicted number of moves left, 
+	with more time for tactical and close middlegame positions.
+	Within a move, an iteration of the iterative deepening is only started if it is predicted to finish before the hard limit.
+	With a game time, the search also stops early (at 70% of the soft limit) when the best move has been stable for a few iterations.
+*/
+class TimeManager
+{
+	private:
+		unsigned short moveTimeMS;		// Used when there is no game time.
+		unsigned int gameTimeMS;		// Total time of a game, 0 = use the fixed move time.
+		int remainingTimeMS;			// Time left of the game.
+		unsigned short softLimitMS;		// Time the current move should take.
+		unsigned short hardLimitMS;		// Time the current move must not exceed.
+		// Statistics of the current move.
+		unsigned int lastIterationNodes;
+		unsigned int nrOfNodes;			// Nodes visited by all iterations of the current move.
+		float branchingFactor;			// The effective branching factor between the last two iterations, 0 if unknown.
+		// Kept from earlier moves, for when the first iterations of a move are answered by the transposition table.
+		unsigned int previousIterationNodes;	// Nodes of the last iteration of the previous move.
+		float previousBranchingFactor;
+		float msPerNode;
+		char lastBestMove;
+		unsigned char nrOfStableIterations;
+
+	public:
+		TimeManager();
+
+		/*
+			Gives every move the same time.
+		*/
+		void SetMoveTime(unsigned short moveTimeMS);
+		/*
+			Divides the given time over the moves of a game. 0 = use the fixed move time instead.
+		*/
+		void SetGameTime(unsigned int gameTimeMS);
+		/*
+			Resets the time left to the full game time. Call at the start of each game.
+		*/
+		void StartGame();
+		/*
+			Sets the soft and hard limits of the move to be searched in the given position (max to move).
+		*/
+		void StartMove(const Board& board);
+		/*
+			Records the result of an iteration of the current move.
+			iterationNodes = The number of nodes the iteration visited.
+			bestMove = The best move found by the iteration.
+		*/
+		void EndIteration(unsigned int iterationNodes, char bestMove);
+		/*
+			Returns true if another iteration is predicted to finish within the limits.
+			The cost of the next iteration is predicted from the nodes of the last iteration, the branching factor
+			and the time per node so far. Until the move has done an iteration of its own, the previous move is used.
+			elapsedMS = Time spent on the move so far.
+		*/
+		bool StartNextIteration(unsigned int elapsedMS) const;
+		/*
+			Subtracts the time spent on the move from the time left of the game.
+		*/
+		void EndMove(unsigned int elapsedMS);
+
+		unsigned short GetSoftLimit() const { return this->softLimitMS; }
+		unsigned short GetHardLimit() const { return this->hardLimitMS; }
+		int GetRemainingTime() const { return this->remainingTimeMS; }
+		float GetBranchingFactor() const { return this->branchingFactor; }
+};
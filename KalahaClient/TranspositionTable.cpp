@@ -0,0 +1,219 @@
+#include "TranspositionTable.h"
+#include "SpanTrace.h"
+
+#include <string.h>
+#include <limits.h>
+
+#pragma comment(lib, "advapi32.lib") // Needed to enable the privilege of large pages.
+
+// The utility seen from the other player. SCHAR_MIN has no opposite and becomes SCHAR_MAX.
+static char FlipUtility(char utility)
+{
+	return utility == SCHAR_MIN ? SCHAR_MAX : -utility;
+}
+
+// A lower bound seen from one player is an upper bound seen from the other.
+static unsigned char FlipBound(unsigned char bound)
+{
+	return bound == BOUND_EXACT ? BOUND_EXACT : (bound == BOUND_LOWER ? BOUND_UPPER : BOUND_LOWER);
+}
+
+// Large pages need the "Lock pages in memory" privilege, which the user must have and the process must enable.
+static bool EnableLockMemoryPrivilege()
+{
+	HANDLE token;
+	if(!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+	{
+		return false;
+	}
+	TOKEN_PRIVILEGES privileges;
+	privileges.PrivilegeCount = 1;
+	privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+	bool enabled = LookupPrivilegeValue(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid) 
+		&& AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) && GetLastError() == ERROR_SUCCESS;
+	CloseHandle(token);
+	return enabled;
+}
+
+TranspositionTable::TranspositionTable()
+{
+	this->buckets = nullptr;
+	this->nrOfBuckets = 0;
+	this->largePages = false;
+	this->generation = 0;
+	this->ResetStats();
+}
+TranspositionTable::~TranspositionTable()
+{
+	if(this->buckets)
+	{
+		VirtualFree(this->buckets, 0, MEM_RELEASE);
+		this->buckets = nullptr;
+	}
+}
+
+void TranspositionTable::Resize(unsigned int sizeMB)
+{
+	ScopedSpan span("Resize transposition table");
+	if(this->buckets)
+	{
+		VirtualFree(this->buckets, 0, MEM_RELEASE);
+		this->buckets = nullptr;
+	}
+	this->nrOfBuckets = 0;
+	this->largePages = false;
+
+	unsigned long long maxNrOfBuckets = (unsigned long long)sizeMB * 1024 * 1024 / sizeof(TranspositionBucket);
+	if(maxNrOfBuckets == 0)
+	{
+		return;
+	}
+	unsigned int nrOfBuckets = 1;
+	while(nrOfBuckets * 2ULL <= maxNrOfBuckets)
+	{
+		nrOfBuckets *= 2;
+	}
+	SIZE_T size = (SIZE_T)nrOfBuckets * sizeof(TranspositionBucket);
+
+	// The size of a large page allocation must be a multiple of the large page size.
+	SIZE_T largePageSize = GetLargePageMinimum();
+	if(largePageSize > 0 && EnableLockMemoryPrivilege())
+	{
+		SIZE_T largePagesSize = (size + largePageSize - 1) / largePageSize * largePageSize;
+		this->buckets = (TranspositionBucket*)VirtualAlloc(nullptr, largePagesSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		this->largePages = this->buckets != nullptr;
+	}
+	if(!this->buckets)
+	{
+		// Normal pages, which are aligned to the cache lines as well.
+		this->buckets = (TranspositionBucket*)VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	}
+	if(!this->buckets)
+	{
+		return; // Out of memory, the table is disabled.
+	}
+	this->nrOfBuckets = nrOfBuckets;
+	this->Clear();
+}
+
+void TranspositionTable::Clear()
+{
+	if(this->buckets)
+	{
+		memset(this->buckets, 0, this->nrOfBuckets * sizeof(TranspositionBucket));
+	}
+}
+
+unsigned long long TranspositionTable::GetKey(const Board& board, bool minTurn)
+{
+	// Put the side of the player to move first, so that both colors of a position get the same key.
+	unsigned char ambos[AMBO_COUNT];
+	const unsigned char* sideToMove = board.GetAmbos() + (minTurn ? AMBO_PLAYER_COUNT + 1 : 0);
+	const unsigned char* otherSide = board.GetAmbos() + (minTurn ? 0 : AMBO_PLAYER_COUNT + 1);
+	memcpy(ambos, sideToMove, AMBO_PLAYER_COUNT + 1);
+	memcpy(ambos + AMBO_PLAYER_COUNT + 1, otherSide, AMBO_PLAYER_COUNT + 1);
+
+	// Pack the 14 ambos into two words and mix them (MurmurHash3 finalizer).
+	unsigned long long low = 0;
+	unsigned long long high = 0;
+	memcpy(&low, ambos, sizeof(low));
+	memcpy(&high, ambos + sizeof(low), AMBO_COUNT - sizeof(low));
+	unsigned long long key = low ^ (high * 0x9E3779B97F4A7C15ULL);
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDULL;
+	key ^= key >> 33;
+	key *= 0xC4CEB9FE1A85EC53ULL;
+	key ^= key >> 33;
+
+	// 0 marks an empty entry.
+	return key ? key : 1;
+}
+
+bool TranspositionTable::Probe(unsigned long long key, bool minTurn, TranspositionEntry& entry) const
+{
+	if(this->nrOfBuckets == 0)
+	{
+		return false;
+	}
+	// Only some probes are timed, timing all of them would cost more than the probes.
+	bool timed = (this->stats.nrOfProbes & (TRANSPOSITION_LATENCY_SAMPLE_INTERVAL - 1)) == 0;
+	unsigned long long startCycles = timed ? __rdtsc() : 0;
+	this->stats.nrOfProbes++;
+
+	const TranspositionBucket& bucket = this->buckets[key & (this->nrOfBuckets - 1)];
+	char way = -1;
+	for(unsigned char i = 0; i < TRANSPOSITION_BUCKET_SIZE; i++)
+	{
+		if(bucket.entries[i].key == key)
+		{
+			way = i;
+			entry = bucket.entries[i];
+			break;
+		}
+	}
+	if(timed)
+	{
+		this->stats.latencyCycles += __rdtsc() - startCycles;
+		this->stats.nrOfLatencySamples++;
+	}
+	if(way == -1)
+	{
+		return false;
+	}
+
+	this->stats.nrOfHits[way]++;
+	if(minTurn)
+	{
+		entry.utility = FlipUtility(entry.utility);
+		entry.bound = FlipBound(entry.bound);
+	}
+	return true;
+}
+
+void TranspositionTable::Store(unsigned long long key, bool minTurn, char utility, unsigned char depth, unsigned char bound, char bestMove)
+{
+	if(this->nrOfBuckets == 0)
+	{
+		return;
+	}
+	this->stats.nrOfStores++;
+	TranspositionBucket& bucket = this->buckets[key & (this->nrOfBuckets - 1)];
+	TranspositionEntry* stored = nullptr;
+	for(unsigned char i = 0; i < TRANSPOSITION_BUCKET_SIZE; i++)
+	{
+		if(bucket.entries[i].key == key)
+		{
+			stored = &bucket.entries[i];
+			break;
+		}
+	}
+	if(stored && stored->depth > depth)
+	{
+		return; // Keep the deeper result of the same position.
+	}
+	if(!stored)
+	{
+		// Replace an empty entry if there is one, else an entry of an earlier search, else the shallowest entry.
+		int lowestWorth = INT_MAX;
+		for(unsigned char i = 0; i < TRANSPOSITION_BUCKET_SIZE; i++)
+		{
+			const TranspositionEntry& candidate = bucket.entries[i];
+			int worth = candidate.key == 0 ? -1 : candidate.depth + (candidate.generation == this->generation ? UCHAR_MAX + 1 : 0);
+			if(worth < lowestWorth)
+			{
+				lowestWorth = worth;
+				stored = &bucket.entries[i];
+			}
+		}
+		if(stored->key != 0)
+		{
+			this->stats.nrOfReplacements++;
+		}
+	}
+	stored->key = key;
+	stored->utility = minTurn ? FlipUtility(utility) : utility;
+	stored->depth = depth;
+	stored->bound = minTurn ? FlipBound(bound) : bound;
+	stored->bestMove = bestMove;
+	stored->generation = this->generation;
+}
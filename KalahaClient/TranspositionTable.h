@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Board.h"
+#include <Windows.h>
+#include <intrin.h>
+#include <string.h>
+
+static const unsigned char TRANSPOSITION_BUCKET_SIZE = 4; // Entries of a bucket, one cache line together.
+static const unsigned int TRANSPOSITION_LATENCY_SAMPLE_INTERVAL = 64; // Probes between measurements of the probe time, a power of 2.
+
+enum BOUND_TYPE
+{
+	BOUND_EXACT = 0, // The stored utility is the exact utility of the position.
+	BOUND_LOWER = 1, // The utility of the position is at least the stored utility (beta cutoff).
+	BOUND_UPPER = 2  // The utility of the position is at most the stored utility (alpha cutoff).
+};
+
+struct TranspositionEntry
+{
+	unsigned long long	key;		// Hash key of the position, 0 if the entry is empty.
+	char				utility;	// Seen from the player to move.
+	unsigned char		depth;		// The depth the position was searched to.
+	unsigned char		bound;		// One of BOUND_TYPE.
+	char				bestMove;	// Index of the best ambo found, -1 if unknown.
+	unsigned char		generation;	// The search that stored the entry, older entries are replaced first.
+};
+
+/*
+	The entries a key may be stored in, aligned to a cache line so that a probe reads a single line.
+*/
+struct alignas(64) TranspositionBucket
+{
+	TranspositionEntry entries[TRANSPOSITION_BUCKET_SIZE];
+};
+static_assert(sizeof(TranspositionBucket) == 64, "A bucket should fill one cache line.");
+
+/*
+	Counters of the table, since the last call to ResetStats().
+*/
+struct TranspositionStats
+{
+	unsigned long long nrOfProbes;
+	unsigned long long nrOfHits[TRANSPOSITION_BUCKET_SIZE]; // Per way (entry index) of the bucket.
+	unsigned long long nrOfStores;
+	unsigned long long nrOfReplacements; // Stores that replaced an entry of another position.
+	unsigned long long nrOfLatencySamples;
+	unsigned long long latencyCycles; // The sum of the sampled probe times, in processor cycles.
+};
+
+/*
+	Stores search results of positions so that they can be reused when a position is reached again, 
+	either later in the same search or in a later search (e.g. after pondering).
+	Positions are stored with the player to move as player 1 (color-canonical): a board with min to move shares 
+	its entry with the swapped board with max to move, and the utility and bound are flipped on the way in and out.
+	A key can be stored in any entry of its bucket. When the bucket is full, the shallowest entry of the oldest search is replaced.
+	The table is allocated on large (2 MB) pages when the operating system permits it, which saves most of the TLB misses of the probes.
+*/
+class TranspositionTable
+{
+	private:
+		TranspositionBucket* buckets;
+		unsigned int nrOfBuckets; // Always a power of 2.
+		bool largePages; // The buckets are allocated on large pages.
+		unsigned char generation; // Of the current search.
+		mutable TranspositionStats stats;
+
+	public:
+		TranspositionTable();
+		virtual~TranspositionTable();
+
+		/*
+			Allocates the table. Any previous content is lost.
+			The number of buckets is rounded down to a power of 2 that fits in sizeMB megabytes.
+		*/
+		void Resize(unsigned int sizeMB);
+		bool UsesLargePages() const { return this->largePages; }
+		unsigned long long GetMemoryUsage() const { return (unsigned long long)this->nrOfBuckets * sizeof(TranspositionBucket); }
+		/*
+			Empties the table.
+		*/
+		void Clear();
+		/*
+			Call at the start of each search, so that the entries of earlier searches are replaced first.
+		*/
+		void NewSearch() { this->generation++; }
+		/*
+			Returns the hash key of a board with the given player to move. 
+			The key is the same for the swapped board with the other player to move.
+		*/
+		static unsigned long long GetKey(const Board& board, bool minTurn);
+		/*
+			Starts loading the bucket of the key into the cache, so that a following probe doesn't wait for memory.
+		*/
+		void Prefetch(unsigned long long key) const 
+		{ 
+			if(this->nrOfBuckets > 0)
+			{
+				_mm_prefetch((const char*)&this->buckets[key & (this->nrOfBuckets - 1)], _MM_HINT_T0);
+			}
+		}
+		/*
+			Looks up a position with the given player to move.
+			Returns true and fills in entry (with the utility seen from max) if the position is stored, else false.
+		*/
+		bool Probe(unsigned long long key, bool minTurn, TranspositionEntry& entry) const;
+		/*
+			Stores a search result, the utility seen from max. 
+			An entry of the same position is only replaced by a result of at least the same depth.
+		*/
+		void Store(unsigned long long key, bool minTurn, char utility, unsigned char depth, unsigned char bound, char bestMove);
+		const TranspositionStats& GetStats() const { return this->stats; }
+		void ResetStats() { memset(&this->stats, 0, sizeof(this->stats)); }
+};
@@ -0,0 +1,310 @@
+#include "WeightTuner.h"
+#include "GameRecord.h"
+
+#include <math.h>
+#include <thread>
+#include <Windows.h>
+
+WeightTuner::WeightTuner(unsigned int nrOfThreads)
+{
+	if(nrOfThreads == 0)
+	{
+		nrOfThreads = max(std::thread::hardware_concurrency(), 1U);
+	}
+	this->nrOfThreads = nrOfThreads;
+	this->nrOfPositions = 0;
+}
+
+void WeightTuner::AddPositions(const std::vector<TunerPosition>& positions)
+{
+	unsigned int first = this->nrOfPositions;
+	unsigned int nrOfPositions = (unsigned int)positions.size();
+	this->nrOfPositions += nrOfPositions;
+	unsigned int paddedSize = (this->nrOfPositions + TUNER_LANES - 1) / TUNER_LANES * TUNER_LANES;
+	for(unsigned char f = 0; f < EVALUATION_NR_OF_FEATURES; f++)
+	{
+		this->features[f].resize(paddedSize);
+	}
+	this->results.resize(paddedSize);
+	for(unsigned int i = this->nrOfPositions; i < paddedSize; i++)
+	{
+		for(unsigned char f = 0; f < EVALUATION_NR_OF_FEATURES; f++)
+		{
+			this->features[f][i] = 0;
+		}
+		this->results[i] = 1;
+	}
+
+	// Each thread fills its own part of the arrays.
+	std::vector<std::thread> threads;
+	unsigned int partSize = (nrOfPositions + this->nrOfThreads - 1) / this->nrOfThreads;
+	for(unsigned int t = 0; t < this->nrOfThreads; t++)
+	{
+		unsigned int begin = min(t * partSize, nrOfPositions);
+		unsigned int end = min(begin + partSize, nrOfPositions);
+		threads.push_back(std::thread([this, &positions, first, begin, end]()
+		{
+			short positionFeatures[EVALUATION_NR_OF_FEATURES];
+			for(unsigned int i = begin; i < end; i++)
+			{
+				TunerPosition position = positions[i];
+				Board board(position.ambos);
+				ExtractFeatures(board, position.minTurn, positionFeatures);
+				for(unsigned char f = 0; f < EVALUATION_NR_OF_FEATURES; f++)
+				{
+					this->features[f][first + i] = positionFeatures[f];
+				}
+				this->results[first + i] = position.result;
+			}
+		}));
+	}
+	for(unsigned int t = 0; t < threads.size(); t++)
+	{
+		threads[t].join();
+	}
+}
+
+bool WeightTuner::AddGames(const char* fileName, std::ostream& out)
+{
+	GameRecordReader reader;
+	if(!reader.Open(fileName))
+	{
+		out << reader.GetError() << endl;
+		return false;
+	}
+
+	unsigned int nrOfGames = 0;
+	std::vector<TunerPosition> positions;
+	positions.reserve(TUNER_READ_BATCH_SIZE);
+	RecordedGame game;
+	while(reader.NextGame(game))
+	{
+		nrOfGames++;
+		TunerPosition position;
+		position.minTurn = game.player == 2;
+		position.result = game.end.winner == 1 ? 2 : (game.end.winner == 0 ? 1 : 0);
+		for(unsigned int i = 0; i < game.moves.size(); i++)
+		{
+			memcpy(position.ambos, game.moves[i].ambos, sizeof(position.ambos));
+			positions.push_back(position);
+			if(positions.size() == TUNER_READ_BATCH_SIZE)
+			{
+				this->AddPositions(positions);
+				positions.clear();
+			}
+		}
+	}
+	this->AddPositions(positions);
+	out << "Read " << nrOfGames << " games from " << fileName << ", " << this->GetNrOfPositions() << " positions in total." << endl;
+	if(!reader.GetError().empty())
+	{
+		out << reader.GetError() << endl;
+		return false;
+	}
+	return true;
+}
+
+void WeightTuner::ComputeError(unsigned int begin, unsigned int end, const float weights[EVALUATION_NR_OF_FEATURES], float scale,
+	double& error, double* gradient) const
+{
+	// The weights scaled so that the sigmoid is taken directly of the weighted sum.
+	float scaledWeights[EVALUATION_NR_OF_FEATURES];
+	for(unsigned char f = 0; f < EVALUATION_NR_OF_FEATURES; f++)
+	{
+		scaledWeights[f] = weights[f] * scale / EVALUATION_WEIGHT_SCALE;
+	}
+
+	float values[TUNER_BATCH_SIZE];
+	for(unsigned int batch = begin; batch < end; batch += TUNER_BATCH_SIZE)
+	{
+		int size = (int)min(end - batch, TUNER_BATCH_SIZE); // Signed, the compiler only vectorizes the loops with signed counters.
+		const unsigned char* results = &this->results[batch];
+
+		// Every loop runs over contiguous arrays without branches, so that it is vectorized.
+		for(int i = 0; i < size; i++)
+		{
+			values[i] = 0.0f;
+		}
+		for(unsigned char f = 0; f < EVALUATION_NR_OF_FEATURES; f++)
+		{
+			const short* feature = &this->features[f][batch];
+			float weight = scaledWeights[f];
+			for(int i = 0; i < size; i++)
+			{
+				values[i] += weight * feature[i];
+			}
+		}
+		// The sums are split in TUNER_LANES partial sums, one per vector lane, since the compiler may not reorder the additions to one sum.
+		float errors[TUNER_LANES] = {};
+		for(int i = 0; i < size; i += TUNER_LANES)
+		{
+			for(int lane = 0; lane < TUNER_LANES; lane++)
+			{
+				float expectedScore = 1.0f / (1.0f + expf(-values[i + lane]));
+				float difference = expectedScore - 0.5f * results[i + lane];
+				errors[lane] += difference * difference;
+				// The derivative of the squared error with respect to the weighted sum, for the gradient.
+				values[i + lane] = 2.0f * difference * expectedScore * (1.0f - expectedScore);
+			}
+		}
+		for(int lane = 0; lane < TUNER_LANES; lane++)
+		{
+			error += errors[lane];
+		}
+
+		if(gradient)
+		{
+			for(unsigned char f = 0; f < EVALUATION_NR_OF_FEATURES; f++)
+			{
+				const short* feature = &this->features[f][batch];
+				float sums[TUNER_LANES] = {};
+				for(int i = 0; i < size; i += TUNER_LANES)
+				{
+					for(int lane = 0; lane < TUNER_LANES; lane++)
+					{
+						sums[lane] += values[i + lane] * feature[i + lane];
+					}
+				}
+				for(int lane = 0; lane < TUNER_LANES; lane++)
+				{
+					gradient[f] += sums[lane] * scale / EVALUATION_WEIGHT_SCALE;
+				}
+			}
+		}
+	}
+}
+
+double WeightTuner::ComputeMeanError(const float weights[EVALUATION_NR_OF_FEATURES], float scale, double* gradient) const
+{
+	if(this->nrOfPositions == 0)
+	{
+		return 0.0;
+	}
+
+	// The positions are split in parts of whole batches, each thread sums its own error and gradient.
+	unsigned int paddedSize = (unsigned int)this->results.size();
+	unsigned int nrOfBatches = (paddedSize + TUNER_BATCH_SIZE - 1) / TUNER_BATCH_SIZE;
+	unsigned int partSize = (nrOfBatches + this->nrOfThreads - 1) / this->nrOfThreads * TUNER_BATCH_SIZE;
+	std::vector<double> errors(this->nrOfThreads, 0.0);
+	std::vector<double> gradients(this->nrOfThreads * EVALUATION_NR_OF_FEATURES, 0.0);
+	std::vector<std::thread> threads;
+	for(unsigned int t = 0; t < this->nrOfThreads; t++)
+	{
+		unsigned int begin = min(t * partSize, paddedSize);
+		unsigned int end = min(begin + partSize, paddedSize);
+		double* threadGradient = gradient ? &gradients[t * EVALUATION_NR_OF_FEATURES] : nullptr;
+		threads.push_back(std::thread(&WeightTuner::ComputeError, this, begin, end, weights, scale, std::ref(errors[t]), threadGradient));
+	}
+
+	double error = 0.0;
+	if(gradient)
+	{
+		for(unsigned char f = 0; f < EVALUATION_NR_OF_FEATURES; f++)
+		{
+			gradient[f] = 0.0;
+		}
+	}
+	for(unsigned int t = 0; t < threads.size(); t++)
+	{
+		threads[t].join();
+		error += errors[t];
+		for(unsigned char f = 0; f < EVALUATION_NR_OF_FEATURES && gradient; f++)
+		{
+			gradient[f] += gradients[t * EVALUATION_NR_OF_FEATURES + f];
+		}
+	}
+	for(unsigned char f = 0; f < EVALUATION_NR_OF_FEATURES && gradient; f++)
+	{
+		gradient[f] /= this->nrOfPositions;
+	}
+	return error / this->nrOfPositions;
+}
+
+float WeightTuner::FitScale(const float weights[EVALUATION_NR_OF_FEATURES]) const
+{
+	// The error is unimodal in the scale, so the interval can be narrowed by golden sections.
+	const float ratio = 0.618034f;
+	float low = TUNER_MIN_SCALE;
+	float high = TUNER_MAX_SCALE;
+	float left = high - ratio * (high - low);
+	float right = low + ratio * (high - low);
+	double leftError = this->ComputeMeanError(weights, left, nullptr);
+	double rightError = this->ComputeMeanError(weights, right, nullptr);
+	for(unsigned int i = 0; i < 30; i++)
+	{
+		if(leftError < rightError)
+		{
+			high = right;
+			right = left;
+			rightError = leftError;
+			left = high - ratio * (high - low);
+			leftError = this->ComputeMeanError(weights, left, nullptr);
+		}
+		else
+		{
+			low = left;
+			left = right;
+			leftError = rightError;
+			right = low + ratio * (high - low);
+			rightError = this->ComputeMeanError(weights, right, nullptr);
+		}
+	}
+	return (low + high) / 2.0f;
+}
+
+void WeightTuner::Tune(EvaluationWeights& weights, unsigned int nrOfIterations, std::ostream& out) const
+{
+	if(this->GetNrOfPositions() == 0)
+	{
+		out << "No positions to tune on." << endl;
+		return;
+	}
+	DWORD startTime = timeGetTime();
+
+	float tuned[EVALUATION_NR_OF_FEATURES];
+	for(unsigned char f = 0; f < EVALUATION_NR_OF_FEATURES; f++)
+	{
+		tuned[f] = weights.weights[f];
+	}
+	float scale = this->FitScale(tuned);
+	double startError = this->ComputeMeanError(tuned, scale, nullptr);
+	out << "Sigmoid scale " << scale << ", error of the starting weights " << startError << "." << endl;
+
+	// Adam: the step of each weight is adapted to the size of its gradients, so features with large and small values
+	// (seed counts and flags) are tuned at the same pace.
+	const double beta1 = 0.9;
+	const double beta2 = 0.999;
+	double gradient[EVALUATION_NR_OF_FEATURES];
+	double moment[EVALUATION_NR_OF_FEATURES] = {};
+	double squaredMoment[EVALUATION_NR_OF_FEATURES] = {};
+	double error = startError;
+	for(unsigned int iteration = 1; iteration <= nrOfIterations; iteration++)
+	{
+		error = this->ComputeMeanError(tuned, scale, gradient);
+		for(unsigned char f = 0; f < EVALUATION_NR_OF_FEATURES; f++)
+		{
+			moment[f] = beta1 * moment[f] + (1.0 - beta1) * gradient[f];
+			squaredMoment[f] = beta2 * squaredMoment[f] + (1.0 - beta2) * gradient[f] * gradient[f];
+			double correctedMoment = moment[f] / (1.0 - pow(beta1, iteration));
+			double correctedSquaredMoment = squaredMoment[f] / (1.0 - pow(beta2, iteration));
+			tuned[f] -= (float)(TUNER_LEARNING_RATE * correctedMoment / (sqrt(correctedSquaredMoment) + 1e-12));
+		}
+		if(iteration % 50 == 0 || iteration == nrOfIterations)
+		{
+			out << "Iteration " << iteration << ": error " << error << " (" << timeGetTime() - startTime << " ms)." << endl;
+		}
+	}
+
+	// The evaluation uses whole weights.
+	for(unsigned char f = 0; f < EVALUATION_NR_OF_FEATURES; f++)
+	{
+		weights.weights[f] = (short)max(-SHRT_MAX, min((int)floorf(tuned[f] + 0.5f), SHRT_MAX));
+		tuned[f] = weights.weights[f];
+	}
+	out << "Error of the tuned weights " << this->ComputeMeanError(tuned, scale, nullptr) << " (" << this->GetNrOfPositions();
+	out << " positions, " << timeGetTime() - startTime << " ms)." << endl;
+	for(unsigned char f = 0; f < EVALUATION_NR_OF_FEATURES; f++)
+	{
+		out << EVALUATION_FEATURE_NAMES[f] << " " << weights.weights[f] << endl;
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Evaluation.h"
+#include <ostream>
+#include <vector>
+
+static const unsigned int TUNER_READ_BATCH_SIZE = 1 << 16; // Positions read from the game records before their features are extracted in parallel.
+static const unsigned int TUNER_BATCH_SIZE = 2048; // Positions evaluated at a time by a thread, small enough to stay in the cache.
+static const int TUNER_LANES = 8; // Partial sums of the error and the gradient, at least the floats of a vector register. Divides TUNER_BATCH_SIZE.
+static const unsigned int TUNER_NR_OF_ITERATIONS = 500;
+static const float TUNER_LEARNING_RATE = 2.0f; // The largest step of a weight per iteration (Adam), in 1/EVALUATION_WEIGHT_SCALE seeds.
+static const float TUNER_MIN_SCALE = 0.01f; // The range searched for the scale of the sigmoid.
+static const float TUNER_MAX_SCALE = 2.0f;
+
+/*
+	A position of a recorded game, before its features are extracted.
+*/
+struct TunerPosition
+{
+	unsigned char ambos[AMBO_COUNT]; // As received from the server, player 1 is max.
+	bool minTurn;
+	unsigned char result; // Half points of player 1: 2 = won, 1 = draw, 0 = lost.
+};
+
+/*
+	Fits the evaluation weights to the results of recorded games (Texel tuning). The sigmoid of the evaluation of a position,
+	1 / (1 + e^(-scale * evaluation)), is taken as the expected score of max, and the weights are changed by gradient descent
+	to minimize the mean squared error between it and the result of the game. The scale is fitted to the starting weights first.
+	The features of the positions are extracted once and stored one array per feature, so that the evaluation of a batch
+	is a few loops over contiguous arrays that the compiler vectorizes. The batches are evaluated by several threads.
+*/
+class WeightTuner
+{
+	private:
+		// The arrays are padded to a multiple of TUNER_LANES with draws without features, which have no error.
+		std::vector<short> features[EVALUATION_NR_OF_FEATURES]; // features[f][p] = feature f of position p.
+		std::vector<unsigned char> results; // As TunerPosition::result.
+		unsigned int nrOfPositions; // Without the padding.
+		unsigned int nrOfThreads;
+
+		/*
+			Extracts the features of the positions, in parallel, and adds them to the arrays.
+		*/
+		void AddPositions(const std::vector<TunerPosition>& positions);
+		/*
+			Sums the squared errors of the positions [begin, end) and, if gradient is not nullptr, adds the gradient
+			of the sum with respect to each weight to it.
+		*/
+		void ComputeError(unsigned int begin, unsigned int end, const float weights[EVALUATION_NR_OF_FEATURES], float scale,
+			double& error, double* gradient) const;
+		/*
+			Returns the mean squared error of all positions, split over the threads.
+			The mean gradient is written to gradient if it is not nullptr.
+		*/
+		double ComputeMeanError(const float weights[EVALUATION_NR_OF_FEATURES], float scale, double* gradient) const;
+		/*
+			Returns the scale of the sigmoid that minimizes the error of the weights (golden-section search).
+		*/
+		float FitScale(const float weights[EVALUATION_NR_OF_FEATURES]) const;
+
+	public:
+		/*
+			nrOfThreads = 0 uses one thread per core.
+		*/
+		WeightTuner(unsigned int nrOfThreads = 0);
+
+		/*
+			Reads our positions of the games in the game record file, labelled with the results of the games.
+			Returns false if the file could not be read or is corrupt (the positions read before the error are kept).
+		*/
+		bool AddGames(const char* fileName, std::ostream& out);
+		unsigned int GetNrOfPositions() const { return this->nrOfPositions; }
+		/*
+			Tunes the weights, starting from the given ones, and writes the progress to out.
+		*/
+		void Tune(EvaluationWeights& weights, unsigned int nrOfIterations, std::ostream& out) const;
+};